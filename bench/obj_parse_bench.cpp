@@ -0,0 +1,156 @@
+// Times ObjParser over 1, 2, 4, ... threads up to every hardware thread against single threaded tinyobjloader,
+// checks that every thread count produces identical bits and that they agree with tinyobjloader.
+//   ./obj_parse_bench [model.obj | megabytes] [iterations]
+// Without a model a synthetic one of the given size (default 256 MB) is written to the temp directory once.
+#include "obj_parser.hpp"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace blikaengine;
+
+namespace{
+
+	template<typename F>
+	double best_ms(uint32_t iterations, F&& f){
+		double best = 0.;
+		for(uint32_t i = 0; i < iterations; i++){
+			auto start = std::chrono::high_resolution_clock::now();
+			f();
+			auto end = std::chrono::high_resolution_clock::now();
+			double ms = std::chrono::duration<double, std::chrono::milliseconds::period>(end - start).count();
+			best = i == 0 ? ms : std::min(best, ms);
+		}
+		return best;
+	}
+
+	// a bumpy grid with normals and uvs, one quad per cell, until the file reaches megabytes
+	void write_grid(const std::string& filepath, size_t megabytes){
+		// roughly what one grid vertex with its v, vt, vn lines and quad takes
+		constexpr size_t BYTES_PER_VERTEX = 150;
+		const size_t side = static_cast<size_t>(std::sqrt(static_cast<double>(megabytes * 1024 * 1024 / BYTES_PER_VERTEX))) + 2;
+		FILE* file = std::fopen(filepath.c_str(), "wb");
+		if(file == nullptr){
+			throw std::runtime_error("could not open file: " + filepath);
+		}
+		std::mt19937 rng{42};
+		std::uniform_real_distribution<float> bump{-.05f, .05f};
+		std::fprintf(file, "# %zux%zu grid\no grid\n", side, side);
+		for(size_t y = 0; y < side; y++){
+			for(size_t x = 0; x < side; x++){
+				float u = static_cast<float>(x) / static_cast<float>(side - 1);
+				float v = static_cast<float>(y) / static_cast<float>(side - 1);
+				std::fprintf(file, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n", u * 100.f - 50.f, bump(rng), v * 100.f - 50.f, u, v, bump(rng), 1.f, bump(rng));
+			}
+		}
+		for(size_t y = 0; y + 1 < side; y++){
+			for(size_t x = 0; x + 1 < side; x++){
+				size_t a = y * side + x + 1, b = a + 1, c = a + side + 1, d = a + side;
+				std::fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, b, b, b, c, c, c, d, d, d);
+			}
+		}
+		std::fclose(file);
+	}
+
+	template<typename T>
+	bool same_bits(const std::vector<T>& a, const std::vector<T>& b){
+		return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+	}
+
+	bool close(float a, float b){
+		return std::abs(a - b) <= 1e-6f * std::max(1.f, std::abs(a));
+	}
+}
+
+int main(int argc, char** argv){
+	std::string filepath = argc > 1 ? argv[1] : "256";
+	const uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 3;
+	char* number_end = nullptr;
+	const size_t megabytes = std::strtoul(filepath.c_str(), &number_end, 10);
+	if(*number_end == '\0'){
+		filepath = (std::filesystem::temp_directory_path() / ("obj_parse_bench_" + filepath + "mb.obj")).string();
+		if(!std::filesystem::exists(filepath)){
+			std::cout << "writing " << filepath << '\n';
+			write_grid(filepath, megabytes);
+		}
+	}
+	const double file_megabytes = static_cast<double>(std::filesystem::file_size(filepath)) / (1024. * 1024.);
+
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	double tinyobj_ms = best_ms(1, [&]{
+		std::vector<tinyobj::material_t> materials;
+		std::string warn, err;
+		if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())){
+			throw std::runtime_error(warn + err);
+		}
+	});
+	std::cout << filepath << ", " << std::fixed << std::setprecision(1) << file_megabytes << " MB, best of " << iterations << '\n';
+	std::cout << std::left << "  " << std::setw(12) << "tinyobj" << ' ' << tinyobj_ms << " ms, " << file_megabytes / tinyobj_ms * 1000. << " MB/s\n";
+
+	const uint32_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<uint32_t> thread_counts{};
+	for(uint32_t threads = 1; threads < hardware_threads; threads *= 2){
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(hardware_threads);
+
+	int result = EXIT_SUCCESS;
+	ObjParser reference{1};
+	double single_ms = 0.;
+	for(uint32_t threads : thread_counts){
+		ObjParser parser{threads};
+		ObjParser& parsed = threads == 1 ? reference : parser;
+		double ms = best_ms(iterations, [&]{ parsed.parse(filepath); });
+		if(threads == 1){
+			single_ms = ms;
+		}
+		bool identical = same_bits(parsed.get_positions(), reference.get_positions()) && same_bits(parsed.get_colors(), reference.get_colors()) &&
+			same_bits(parsed.get_normals(), reference.get_normals()) && same_bits(parsed.get_texcoords(), reference.get_texcoords()) &&
+			parsed.get_corners().size() == reference.get_corners().size() &&
+			std::memcmp(parsed.get_corners().data(), reference.get_corners().data(), parsed.get_corners().size() * sizeof(ObjParser::Corner)) == 0;
+		std::cout << "  " << std::setw(12) << (std::to_string(threads) + " threads") << ' ' << ms << " ms, " << file_megabytes / ms * 1000. << " MB/s ("
+			<< single_ms / ms << "x one thread, " << tinyobj_ms / ms << "x tinyobj)" << (identical ? "" : "  MISMATCH") << '\n';
+		if(!identical){
+			result = EXIT_FAILURE;
+		}
+	}
+
+	// same triangles and values as tinyobjloader, up to float parsing rounding
+	bool agrees = reference.get_positions().size() * 3 == attrib.vertices.size() && reference.get_normals().size() * 3 == attrib.normals.size() &&
+		reference.get_texcoords().size() * 2 == attrib.texcoords.size();
+	for(size_t i = 0; agrees && i < attrib.vertices.size(); i++){
+		agrees = close(reference.get_positions()[i / 3][i % 3], attrib.vertices[i]) && close(reference.get_colors()[i / 3][i % 3], attrib.colors[i]);
+	}
+	for(size_t i = 0; agrees && i < attrib.normals.size(); i++){
+		agrees = close(reference.get_normals()[i / 3][i % 3], attrib.normals[i]);
+	}
+	for(size_t i = 0; agrees && i < attrib.texcoords.size(); i++){
+		agrees = close(reference.get_texcoords()[i / 2][i % 2], attrib.texcoords[i]);
+	}
+	size_t corner = 0;
+	for(const auto& shape : shapes){
+		for(size_t i = 0; agrees && i < shape.mesh.indices.size(); i++, corner++){
+			const tinyobj::index_t& index = shape.mesh.indices[i];
+			agrees = corner < reference.get_corners().size() && reference.get_corners()[corner].position == index.vertex_index &&
+				reference.get_corners()[corner].normal == index.normal_index && reference.get_corners()[corner].texcoord == index.texcoord_index;
+		}
+	}
+	agrees = agrees && corner == reference.get_corners().size();
+	std::cout << (agrees ? "  matches tinyobj\n" : "  DIFFERS FROM TINYOBJ\n");
+	return agrees ? result : EXIT_FAILURE;
+}
@@ -0,0 +1,77 @@
+// Compares TransformComponent::mat4() / normal_matrix() one by one against TransformBatch on every path
+// the cpu supports, and checks that all of them produce identical bits.
+//   ./transform_bench [transforms] [iterations]
+#include "components.hpp"
+#include "transform_batch.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace blikaengine;
+
+namespace{
+
+	template<typename F>
+	double time_ms(uint32_t iterations, F&& f){
+		auto start = std::chrono::high_resolution_clock::now();
+		for(uint32_t i = 0; i < iterations; i++){
+			f();
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::chrono::milliseconds::period>(end - start).count() / iterations;
+	}
+}
+
+int main(int argc, char** argv){
+	const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+	const uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 200;
+
+	std::mt19937 rng{42};
+	std::uniform_real_distribution<float> position{-100.f, 100.f};
+	std::uniform_real_distribution<float> angle{-10.f, 10.f};
+	std::uniform_real_distribution<float> scale{.05f, 4.f};
+	std::vector<TransformComponent> transforms(count);
+	TransformBatch batch{};
+	batch.reserve(count);
+	for(auto& transform : transforms){
+		transform.set_translation({position(rng), position(rng), position(rng)});
+		transform.set_rotation({angle(rng), angle(rng), angle(rng)});
+		transform.set_scale({scale(rng), scale(rng), scale(rng)});
+		batch.push_back(transform.get_translation(), transform.get_rotation(), transform.get_scale());
+	}
+
+	std::vector<glm::mat4> reference_models(count), models(count);
+	std::vector<glm::mat3> reference_normals(count), normals(count);
+	double reference_ms = time_ms(iterations, [&]{
+		for(size_t i = 0; i < count; i++){
+			reference_models[i] = transforms[i].mat4();
+			reference_normals[i] = transforms[i].normal_matrix();
+		}
+	});
+	std::cout << count << " transforms, " << iterations << " iterations\n";
+	std::cout << std::left << "  " << std::setw(10) << "component" << ' ' << reference_ms << " ms\n";
+
+	std::vector<TransformBatch::Path> paths{TransformBatch::Path::Scalar};
+	if(TransformBatch::get_best_path() != TransformBatch::Path::Scalar){
+		paths.push_back(TransformBatch::Path::SSE);
+	}
+	if(TransformBatch::get_best_path() == TransformBatch::Path::AVX2){
+		paths.push_back(TransformBatch::Path::AVX2);
+	}
+	int result = EXIT_SUCCESS;
+	for(auto path : paths){
+		double ms = time_ms(iterations, [&]{ batch.compute(models.data(), normals.data(), path); });
+		bool identical = std::memcmp(models.data(), reference_models.data(), count * sizeof(glm::mat4)) == 0 &&
+			std::memcmp(normals.data(), reference_normals.data(), count * sizeof(glm::mat3)) == 0;
+		std::cout << "  " << std::setw(10) << TransformBatch::get_path_name(path) << ' ' << ms << " ms (" << reference_ms / ms << "x)" << (identical ? "" : "  MISMATCH") << '\n';
+		if(!identical){
+			result = EXIT_FAILURE;
+		}
+	}
+	return result;
+}
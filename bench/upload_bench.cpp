@@ -0,0 +1,113 @@
+// Streams buffer uploads of random sizes through a small UploadManager staging ring, with earlier
+// batches still in flight, checks every byte arrived and prints the upload throughput. Covers uploads
+// larger than half the ring that don't fit before its end while the batch before them is in flight.
+// Needs a Vulkan device, runs headless.
+//   ./upload_bench [ring KiB] [uploads]
+#include "buffer.hpp"
+#include "device.hpp"
+#include "upload_manager.hpp"
+#include "window.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace blikaengine;
+
+namespace{
+
+	// orders the copies recorded so far, also those of earlier batches on the queue, before later copies
+	// and host reads of the destination, which the random uploads overlap
+	void order_writes(UploadManager& uploads){
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(uploads.transfer_commands(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void fill(std::vector<uint8_t>& data, uint32_t seed){
+		for(size_t i = 0; i < data.size(); i++){
+			data[i] = static_cast<uint8_t>((i * 2654435761u + seed) >> 13);
+		}
+	}
+
+	bool check(const Buffer& destination, const std::vector<uint8_t>& expected, const char* what){
+		if(std::memcmp(destination.getMappedMemory(), expected.data(), expected.size()) != 0){
+			std::cerr << what << ": uploaded bytes differ\n";
+			return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv){
+	const VkDeviceSize ring_size = (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1024) * 1024;
+	const uint32_t upload_count = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 500;
+
+	Window window{1, 1, "upload_bench", true};
+	Device device{window};
+	UploadManager uploads{device, ring_size};
+	// twice the ring, so uploads larger than it are streamed in chunks too
+	const VkDeviceSize destination_size = 2 * ring_size;
+	Buffer destination{device, destination_size, 1, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+	if(destination.map() != VK_SUCCESS){
+		std::cerr << "failed to map the destination buffer\n";
+		return EXIT_FAILURE;
+	}
+	std::vector<uint8_t> expected(destination_size, 0);
+	std::memset(destination.getMappedMemory(), 0, destination_size);
+	bool ok = true;
+
+	// 13/32 of the ring in flight, then 20/32 that only fits once the ring starts over
+	{
+		std::vector<uint8_t> first(ring_size * 13 / 32), second(ring_size * 20 / 32);
+		fill(first, 1);
+		fill(second, 2);
+		uploads.upload_buffer(first.data(), first.size(), destination.getBuffer(), 0);
+		order_writes(uploads);
+		uploads.flush();
+		uploads.upload_buffer(second.data(), second.size(), destination.getBuffer(), first.size());
+		order_writes(uploads);
+		uploads.wait(uploads.flush());
+		uploads.collect();
+		std::copy(first.begin(), first.end(), expected.begin());
+		std::copy(second.begin(), second.end(), expected.begin() + first.size());
+		ok = check(destination, expected, "upload past the end of the ring") && ok;
+	}
+
+	// random sizes up to the destination, flushed at random, most batches still in flight
+	std::mt19937 rng{42};
+	std::uniform_int_distribution<VkDeviceSize> size_distribution{1, destination_size};
+	std::vector<uint8_t> data{};
+	VkDeviceSize uploaded = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for(uint32_t i = 0; i < upload_count; i++){
+		// copies must be multiples of 4 bytes at 4 byte offsets
+		VkDeviceSize size = (size_distribution(rng) + 3) / 4 * 4;
+		VkDeviceSize offset = std::uniform_int_distribution<VkDeviceSize>{0, (destination_size - size) / 4}(rng) * 4;
+		data.resize(size);
+		fill(data, i);
+		uploads.upload_buffer(data.data(), size, destination.getBuffer(), offset);
+		std::copy(data.begin(), data.end(), expected.begin() + offset);
+		order_writes(uploads);
+		uploaded += size;
+		if(rng() % 3 == 0){
+			uploads.flush();
+			uploads.collect();
+		}
+	}
+	uploads.wait(uploads.flush());
+	double ms = std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+	uploads.collect();
+	ok = check(destination, expected, "random uploads") && ok;
+
+	std::cout << upload_count << " uploads, " << uploaded / (1024 * 1024) << " MiB through a " << ring_size / 1024 << " KiB ring in " << ms << " ms, "
+		<< uploaded / (ms * 1e6) << " GB/s\n";
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,140 @@
+// Welds the triangle corners of a mesh into an index buffer with VertexWelder and with the unordered_map
+// import it replaced, checks both produce the same vertices and indices and prints their throughput.
+//   ./weld_bench [model.obj | corners] [iterations]
+// Without a model the corners of a grid with a uv seam every 64 cells are welded (default 12M corners).
+#include "model.hpp"
+#include "obj_parser.hpp"
+#include "utils.hpp"
+#include "vertex_welder.hpp"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace blikaengine;
+using Vertex = Model::Vertex;
+
+namespace std{
+	template<>
+	struct hash<Vertex>{
+		size_t operator()(Vertex const& vertex) const{
+			size_t seed = 0;
+			blikaengine::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+			return seed;
+		}
+	};
+}
+
+namespace{
+
+	template<typename F>
+	double best_ms(uint32_t iterations, F&& f){
+		double best = 0.;
+		for(uint32_t i = 0; i < iterations; i++){
+			auto start = std::chrono::high_resolution_clock::now();
+			f();
+			auto end = std::chrono::high_resolution_clock::now();
+			double ms = std::chrono::duration<double, std::chrono::milliseconds::period>(end - start).count();
+			best = i == 0 ? ms : std::min(best, ms);
+		}
+		return best;
+	}
+
+	std::vector<Vertex> grid_corners(size_t corner_count){
+		constexpr size_t SEAM = 64;
+		const size_t side = static_cast<size_t>(std::sqrt(static_cast<double>(corner_count / 6))) + 2;
+		std::vector<Vertex> corners{};
+		corners.reserve(6 * (side - 1) * (side - 1));
+		auto vertex = [&](size_t x, size_t y, size_t cell_x){
+			Vertex v{};
+			float u = static_cast<float>(x) / static_cast<float>(side - 1);
+			float w = static_cast<float>(y) / static_cast<float>(side - 1);
+			v.position = {u * 100.f, std::sin(u * 40.f) * std::cos(w * 40.f), w * 100.f};
+			v.color = glm::vec3{1.f};
+			v.normal = glm::normalize(glm::vec3{-std::cos(u * 40.f), 1.f, std::sin(w * 40.f)});
+			// cells on either side of a seam map the shared edge to different uvs
+			v.uv = {static_cast<float>(x - cell_x / SEAM * SEAM) / SEAM, w};
+			return v;
+		};
+		for(size_t y = 0; y + 1 < side; y++){
+			for(size_t x = 0; x + 1 < side; x++){
+				Vertex a = vertex(x, y, x), b = vertex(x + 1, y, x), c = vertex(x + 1, y + 1, x), d = vertex(x, y + 1, x);
+				corners.insert(corners.end(), {a, b, c, a, c, d});
+			}
+		}
+		return corners;
+	}
+
+	std::vector<Vertex> model_corners(const std::string& filepath){
+		ObjParser parser{};
+		parser.parse(filepath);
+		std::vector<Vertex> corners{};
+		corners.reserve(parser.get_corners().size());
+		for(const auto& corner : parser.get_corners()){
+			Vertex vertex{};
+			vertex.position = parser.get_positions()[corner.position];
+			vertex.color = parser.get_colors()[corner.position];
+			if(corner.normal >= 0){
+				vertex.normal = parser.get_normals()[corner.normal];
+			}
+			if(corner.texcoord >= 0){
+				vertex.uv = parser.get_texcoords()[corner.texcoord];
+			}
+			corners.push_back(vertex);
+		}
+		return corners;
+	}
+}
+
+int main(int argc, char** argv){
+	const std::string input = argc > 1 ? argv[1] : "12000000";
+	const uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 5;
+	char* number_end = nullptr;
+	const size_t corner_count = std::strtoul(input.c_str(), &number_end, 10);
+	const std::vector<Vertex> corners = *number_end == '\0' ? grid_corners(corner_count) : model_corners(input);
+
+	std::vector<Vertex> reference_vertices{}, vertices{};
+	std::vector<uint32_t> reference_indices{}, indices{};
+	double reference_ms = best_ms(iterations, [&]{
+		reference_vertices.clear();
+		reference_indices.clear();
+		reference_indices.reserve(corners.size());
+		std::unordered_map<Vertex, uint32_t> unique_vertices{};
+		for(const Vertex& vertex : corners){
+			if(unique_vertices.count(vertex) == 0){
+				unique_vertices[vertex] = static_cast<uint32_t>(reference_vertices.size());
+				reference_vertices.push_back(vertex);
+			}
+			reference_indices.push_back(unique_vertices[vertex]);
+		}
+	});
+	double ms = best_ms(iterations, [&]{
+		vertices.clear();
+		indices.clear();
+		indices.reserve(corners.size());
+		VertexWelder<Vertex> welder{vertices, corners.size()};
+		for(const Vertex& vertex : corners){
+			indices.push_back(welder.weld(vertex));
+		}
+	});
+
+	// only +0 / -0 pairs can weld differently, the map compares floats, the welder bits
+	bool identical = vertices.size() == reference_vertices.size() && indices == reference_indices &&
+		std::memcmp(vertices.data(), reference_vertices.data(), vertices.size() * sizeof(Vertex)) == 0;
+	std::cout << corners.size() << " corners, " << vertices.size() << " unique vertices, best of " << iterations << '\n';
+	std::cout << std::left << std::fixed << std::setprecision(1);
+	std::cout << "  " << std::setw(14) << "unordered_map" << ' ' << reference_ms << " ms, " << corners.size() / reference_ms / 1000. << " M corners/s\n";
+	std::cout << "  " << std::setw(14) << "VertexWelder" << ' ' << ms << " ms, " << corners.size() / ms / 1000. << " M corners/s ("
+		<< reference_ms / ms << "x)" << (identical ? "" : "  MISMATCH") << '\n';
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
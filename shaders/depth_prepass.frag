@@ -0,0 +1,5 @@
+#version 450
+
+// depth only, nothing to write
+void main(){
+}
@@ -0,0 +1,43 @@
+#version 450
+
+// Depth only twin of master_shader.vert, fed by the mesh pool's position stream. Both compute
+// gl_Position with the same expression and declare it invariant, so the lit pass can test EQUAL
+// against the depth written here.
+
+layout(location = 0) in vec3 position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo{
+	mat4 projection_matrix;
+	mat4 view_matrix;
+	mat4 inv_view_matrix;
+	vec4 ambient_light_color;
+	uvec4 cluster_grid;
+	vec4 cluster_params;
+} ubo;
+
+struct ObjectData{
+	mat4 model_matrix;
+	mat4 normal_matrix;
+	vec4 bounds_min;
+	vec4 bounds_max;
+	vec4 position_decode;
+	uint batch;
+};
+
+layout(set = 1, binding = 0) readonly buffer ObjectBuffer{
+	ObjectData objects[];
+} object_buffer;
+
+layout(set = 1, binding = 1) readonly buffer InstanceBuffer{
+	uint objects[];
+} instance_buffer;
+
+invariant gl_Position;
+
+void main(){
+	uint object = instance_buffer.objects[gl_InstanceIndex];
+	mat4 model_matrix = object_buffer.objects[object].model_matrix;
+	vec4 position_decode = object_buffer.objects[object].position_decode;
+	vec4 position_world = model_matrix * vec4(position_decode.xyz + position_decode.w * position, 1.0f);
+	gl_Position = ubo.projection_matrix * (ubo.view_matrix * position_world);
+}
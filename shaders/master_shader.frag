@@ -8,8 +8,9 @@ layout(location = 3) in vec2 frag_UV;
 layout(location = 0) out vec4 out_color;
 
 struct PointLight{
-    vec4 position;
-    vec4 color;
+	// w is the range, nothing past it is lit
+	vec4 position;
+	vec4 color;
 };
 
 layout(set = 0, binding = 0) uniform GlobalUbo{
@@ -17,16 +18,81 @@ layout(set = 0, binding = 0) uniform GlobalUbo{
 	mat4 view_matrix;
 	mat4 inv_view_matrix;
 	vec4 ambient_light_color;
-    PointLight point_lights[10];
-    int lights;
+	// grid size xyz, light count
+	uvec4 cluster_grid;
+	// tile size in pixels, depth slice scale and bias
+	vec4 cluster_params;
 } ubo;
 
 layout(set = 0, binding = 1) uniform sampler2D image;
 
-layout(push_constant) uniform Push {
-	mat4 model_matrix;
-	mat4 normal_matrix;
-} push;
+layout(set = 2, binding = 0) readonly buffer LightBuffer{
+	PointLight lights[];
+} light_buffer;
+
+// offset and count into light_indices of every cluster
+layout(set = 2, binding = 1) readonly buffer ClusterBuffer{
+	uvec2 ranges[];
+} cluster_buffer;
+
+layout(set = 2, binding = 2) readonly buffer LightIndexBuffer{
+	uint indices[];
+} light_index_buffer;
+
+struct Shadow{
+	// per cube face: tile corner xy and size z in atlas uv
+	vec4 faces[6];
+	// near, far, one texel in tile uv, 1 when shadowed
+	vec4 params;
+};
+
+// indexed like the lights
+layout(set = 3, binding = 0) readonly buffer ShadowBuffer{
+	Shadow shadows[];
+} shadow_buffer;
+
+layout(set = 3, binding = 1) uniform sampler2DShadow shadow_atlas;
+
+// right and up of the cube faces +x, -x, +y, -y, +z, -z, as in ShadowSystem
+const vec3 FACE_RIGHT[6] = vec3[](vec3(0, 0, -1), vec3(0, 0, 1), vec3(1, 0, 0), vec3(1, 0, 0), vec3(1, 0, 0), vec3(-1, 0, 0));
+const vec3 FACE_UP[6] = vec3[](vec3(0, 1, 0), vec3(0, 1, 0), vec3(0, 0, -1), vec3(0, 0, 1), vec3(0, 1, 0), vec3(0, 1, 0));
+
+uint cluster_index(){
+	uvec2 tile = min(uvec2(gl_FragCoord.xy / ubo.cluster_params.xy), ubo.cluster_grid.xy - 1);
+	float depth = (ubo.view_matrix * vec4(frag_pos, 1.0)).z;
+	uint slice = uint(clamp(log(depth) * ubo.cluster_params.z + ubo.cluster_params.w, 0.0, float(ubo.cluster_grid.z - 1)));
+	return (slice * ubo.cluster_grid.y + tile.y) * ubo.cluster_grid.x + tile.x;
+}
+
+// 1 where the light reaches the fragment, to_fragment runs from the light to the surface
+float shadow_factor(uint light, vec3 to_fragment){
+	Shadow shadow = shadow_buffer.shadows[light];
+	if(shadow.params.w == 0.0){
+		return 1.0;
+	}
+	vec3 abs_direction = abs(to_fragment);
+	uint face;
+	float major;
+	if(abs_direction.x >= abs_direction.y && abs_direction.x >= abs_direction.z){
+		face = to_fragment.x >= 0.0 ? 0 : 1;
+		major = abs_direction.x;
+	}else if(abs_direction.y >= abs_direction.z){
+		face = to_fragment.y >= 0.0 ? 2 : 3;
+		major = abs_direction.y;
+	}else{
+		face = to_fragment.z >= 0.0 ? 4 : 5;
+		major = abs_direction.z;
+	}
+	vec2 ndc = vec2(dot(to_fragment, FACE_RIGHT[face]), dot(to_fragment, FACE_UP[face])) / major;
+	float near = shadow.params.x;
+	float far = shadow.params.y;
+	float depth = far / (far - near) - far * near / ((far - near) * major);
+	// half a texel in, so filtering never reaches into the neighbouring tile
+	float half_texel = 0.5 * shadow.params.z;
+	vec2 tile_uv = clamp(ndc * 0.5 + 0.5, vec2(half_texel), vec2(1.0 - half_texel));
+	vec4 rect = shadow.faces[face];
+	return texture(shadow_atlas, vec3(rect.xy + tile_uv * rect.z, depth));
+}
 
 void main(){
 	vec3 diffuse_light = ubo.ambient_light_color.xyz * ubo.ambient_light_color.w;
@@ -34,11 +100,27 @@ void main(){
 	vec3 surface_normal = normalize(frag_normal);
 	vec3 camera_pos_world = ubo.inv_view_matrix[3].xyz;
 	vec3 view_direction = normalize(camera_pos_world - frag_pos);
-	for(int i = 0; i < ubo.lights; i++){
-		PointLight light = ubo.point_lights[i];
+	uvec2 range = cluster_buffer.ranges[cluster_index()];
+	for(uint i = 0; i < range.y; i++){
+		uint light_index = light_index_buffer.indices[range.x + i];
+		PointLight light = light_buffer.lights[light_index];
 		vec3 direction_to_light = light.position.xyz - frag_pos;
-		float attenuation = 1.0 / dot(direction_to_light,direction_to_light);
+		float distance_squared = dot(direction_to_light, direction_to_light);
+		float range_squared = light.position.w * light.position.w;
+		if(distance_squared >= range_squared){
+			continue;
+		}
+		// inverse square, windowed to reach zero at the range
+		float window = distance_squared / range_squared;
+		window = clamp(1.0 - window * window, 0.0, 1.0);
+		float attenuation = window * window / max(distance_squared, 0.0001);
 		direction_to_light = normalize(direction_to_light);
+		// pushed off the surface by about a shadow map texel, which grows with the distance to the light
+		vec3 shadow_offset = surface_normal * (2.0 * sqrt(distance_squared) * shadow_buffer.shadows[light_index].params.z);
+		attenuation *= shadow_factor(light_index, frag_pos + shadow_offset - light.position.xyz);
+		if(attenuation <= 0.0){
+			continue;
+		}
 		float cos_angle_incidence =  max(dot(surface_normal, direction_to_light),0);
 		vec3 intensity = light.color.xyz * light.color.w * attenuation;
 		diffuse_light += intensity * cos_angle_incidence;
@@ -52,4 +134,4 @@ void main(){
 	}
 	vec3 image_color = texture(image, frag_UV).rgb;
 	out_color = vec4((diffuse_light * frag_color + specular_light * frag_color) * image_color, 1);
-}
\ No newline at end of file
+}
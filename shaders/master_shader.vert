@@ -10,30 +10,58 @@ layout(location = 1) out vec3 frag_pos;
 layout(location = 2) out vec3 frag_normal;
 layout(location = 3) out vec2 frag_UV;
 
-struct PointLight{
-    vec4 position;
-    vec4 color;
-};
+// VertexFormat: 0 full floats, 1 packed, 2 packed without colors
+layout(constant_id = 0) const uint VERTEX_FORMAT = 0;
 
 layout(set = 0, binding = 0) uniform GlobalUbo{
 	mat4 projection_matrix;
 	mat4 view_matrix;
 	mat4 inv_view_matrix;
 	vec4 ambient_light_color;
-    PointLight point_lights[10];
-    int lights;
+	uvec4 cluster_grid;
+	vec4 cluster_params;
 } ubo;
 
-layout(push_constant) uniform Push {
+struct ObjectData{
 	mat4 model_matrix;
 	mat4 normal_matrix;
-} push;
+	vec4 bounds_min;
+	vec4 bounds_max;
+	// object space position = xyz + w * stored position
+	vec4 position_decode;
+	uint batch;
+};
+
+layout(set = 1, binding = 0) readonly buffer ObjectBuffer{
+	ObjectData objects[];
+} object_buffer;
+
+// object index of every instance, grouped by draw
+layout(set = 1, binding = 1) readonly buffer InstanceBuffer{
+	uint objects[];
+} instance_buffer;
+
+// bit identical to depth_prepass.vert, which the depth test compares EQUAL against
+invariant gl_Position;
+
+// packed normals are a unit octahedron's upper half, with the lower half folded over it
+vec3 octahedral_decode(vec2 encoded){
+	vec3 normal = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -fold : fold;
+	normal.y += normal.y >= 0.0f ? -fold : fold;
+	return normal;
+}
 
 void main(){
-	vec4 position_world = push.model_matrix * vec4(position, 1.0f);
+	uint object = instance_buffer.objects[gl_InstanceIndex];
+	mat4 model_matrix = object_buffer.objects[object].model_matrix;
+	vec4 position_decode = object_buffer.objects[object].position_decode;
+	vec4 position_world = model_matrix * vec4(position_decode.xyz + position_decode.w * position, 1.0f);
 	gl_Position = ubo.projection_matrix * (ubo.view_matrix * position_world);
-	frag_normal = normalize(mat3(push.normal_matrix) * normal);
+	vec3 object_normal = VERTEX_FORMAT == 0 ? normal : octahedral_decode(normal.xy);
+	frag_normal = normalize(mat3(object_buffer.objects[object].normal_matrix) * object_normal);
 	frag_pos = position_world.xyz;
-	frag_color = color;
+	frag_color = VERTEX_FORMAT == 2 ? vec3(1.0f) : color;
   	frag_UV = uv;
 }
\ No newline at end of file
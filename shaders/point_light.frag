@@ -1,28 +1,20 @@
 #version 450
 
 layout(location=0) in vec2 frag_offset;
-layout(location=0) out vec4 out_color;
-
-struct PointLight{
-    vec4 position;
-    vec4 color;
-};
+layout(location=1) in vec4 frag_color;
+// weighted blended transparency targets
+layout(location=0) out vec4 out_accum;
+layout(location=1) out float out_revealage;
 
 layout(set = 0, binding = 0) uniform GlobalUbo{
 	mat4 projection_matrix;
 	mat4 view_matrix;
 	mat4 inv_view_matrix;
 	vec4 ambient_light_color;
-    PointLight point_lights[10];
-    int lights;
+	uvec4 cluster_grid;
+	vec4 cluster_params;
 } ubo;
 
-layout(push_constant) uniform Push{
-    vec4 position;
-    vec4 color;
-    float radius;
-} push;
-
 const float M_PI = 3.1415926538;
 
 void main(){
@@ -31,5 +23,10 @@ void main(){
         discard;
     }
     float cos_dis = 0.5 * (cos(dis * M_PI) + 1.0);
-    out_color = vec4(push.color.xyz + cos_dis, cos_dis);
+    vec3 color = frag_color.xyz + cos_dis;
+    float alpha = cos_dis;
+    // favours close, opaque fragments (McGuire and Bavoil, equation 7 with zero to one depth)
+    float weight = clamp(pow(min(1.0, alpha * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+    out_accum = vec4(color * alpha, alpha) * weight;
+    out_revealage = alpha;
 }
\ No newline at end of file
@@ -9,31 +9,34 @@ const vec2 OFFSETS[6] = vec2[](
     vec2(1.0, 1.0)
 );
 layout(location=0) out vec2 frag_offset;
-
-struct PointLight{
-    vec4 position;
-    vec4 color;
-};
+layout(location=1) out vec4 frag_color;
 
 layout(set = 0, binding = 0) uniform GlobalUbo{
 	mat4 projection_matrix;
 	mat4 view_matrix;
 	mat4 inv_view_matrix;
 	vec4 ambient_light_color;
-    PointLight point_lights[10];
-    int lights;
+	uvec4 cluster_grid;
+	vec4 cluster_params;
 } ubo;
 
-layout(push_constant) uniform Push{
+struct Billboard{
+    // w is the radius
     vec4 position;
     vec4 color;
-    float radius;
-} push;
+};
+
+// back to front, one instance each
+layout(set = 1, binding = 3) readonly buffer BillboardBuffer{
+    Billboard billboards[];
+} billboard_buffer;
 
 void main(){
+    Billboard billboard = billboard_buffer.billboards[gl_InstanceIndex];
     frag_offset = OFFSETS[gl_VertexIndex];
+    frag_color = billboard.color;
     vec3 camera_right_world = {ubo.view_matrix[0][0],ubo.view_matrix[1][0],ubo.view_matrix[2][0]};
     vec3 camera_up_world = {ubo.view_matrix[0][1],ubo.view_matrix[1][1],ubo.view_matrix[2][1]};
-    vec3 position_world = push.position.xyz + push.radius * frag_offset.x * camera_right_world + push.radius * frag_offset.y * camera_up_world;
+    vec3 position_world = billboard.position.xyz + billboard.position.w * frag_offset.x * camera_right_world + billboard.position.w * frag_offset.y * camera_up_world;
     gl_Position = ubo.projection_matrix * (ubo.view_matrix * vec4(position_world, 1.0));
 }
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+
+layout(push_constant) uniform Push{
+	// of the cube face being rendered
+	mat4 view_projection;
+	mat4 model_matrix;
+} push;
+
+void main(){
+	gl_Position = push.view_projection * (push.model_matrix * vec4(position, 1.0));
+}
@@ -0,0 +1,24 @@
+#version 450
+
+// Weighted blended order independent transparency resolve, blended over the opaque image with
+// src_alpha / one_minus_src_alpha.
+
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput accum_input;
+layout(input_attachment_index = 1, set = 0, binding = 1) uniform subpassInput revealage_input;
+
+layout(location = 0) out vec4 out_color;
+
+void main(){
+	float revealage = subpassLoad(revealage_input).r;
+	// nothing transparent covers this pixel
+	if(revealage >= 1.0){
+		discard;
+	}
+	vec4 accum = subpassLoad(accum_input);
+	// half floats overflow under many bright layers
+	if(any(isinf(accum.rgb))){
+		accum.rgb = vec3(accum.a);
+	}
+	vec3 average_color = accum.rgb / max(accum.a, 0.00001);
+	out_color = vec4(average_color, 1.0 - revealage);
+}
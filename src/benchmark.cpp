@@ -0,0 +1,139 @@
+#include "benchmark.hpp"
+#include "frame_info.hpp"
+#include "model.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+namespace blikaengine{
+
+	static Model::Data make_cube_data(){
+		// unit cube with per-face normals, centered on the origin
+		static const glm::vec3 normals[6] = {{1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f}};
+		Model::Data data{};
+		for(const auto& n : normals){
+			glm::vec3 u = glm::abs(n.x) > 0.f ? glm::vec3{0.f, 1.f, 0.f} : glm::vec3{1.f, 0.f, 0.f};
+			glm::vec3 v = glm::cross(n, u);
+			uint32_t base = static_cast<uint32_t>(data.vertices.size());
+			for(int i = 0; i < 4; i++){
+				glm::vec2 uv{i & 1 ? 1.f : 0.f, i & 2 ? 1.f : 0.f};
+				Model::Vertex vertex{};
+				vertex.position = .5f * n + (uv.x - .5f) * u + (uv.y - .5f) * v;
+				vertex.color = {1.f, 1.f, 1.f};
+				vertex.normal = n;
+				vertex.uv = uv;
+				data.vertices.push_back(vertex);
+			}
+			data.indices.insert(data.indices.end(), {base, base + 1, base + 2, base + 2, base + 1, base + 3});
+		}
+		return data;
+	}
+
+	static double percentile(std::vector<double> values, double p){
+		if(values.empty()){
+			return 0.0;
+		}
+		std::sort(values.begin(), values.end());
+		size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+		return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+	}
+
+	Benchmark::Benchmark(uint32_t objects, uint32_t lights, uint32_t frames, uint32_t warmup_frames): objects{objects}, lights{lights}, frames{frames}, warmup_frames{warmup_frames}{
+		samples.reserve(frames);
+	}
+
+	void Benchmark::load_scene(Device& device, Scene& scene){
+		std::shared_ptr<Model> cube = std::make_shared<Model>(device, make_cube_data());
+
+		// square grid of cubes on the XZ plane, each with a different but fixed orientation
+		const uint32_t columns = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(objects)))));
+		const float spacing = 1.5f;
+		scene_extent = .5f * columns * spacing;
+		scene.transforms.reserve(objects + lights);
+		scene.renderables.reserve(objects);
+		for(uint32_t i = 0; i < objects; i++){
+			Entity entity = scene.create_entity();
+			TransformComponent transform{};
+			transform.set_translation({(i % columns) * spacing - scene_extent, -.25f, (i / columns) * spacing - scene_extent});
+			transform.set_rotation({.0f, i * .37f, .0f});
+			transform.set_scale({.5f, .5f, .5f});
+			scene.transforms.add(entity, transform);
+			scene.renderables.add(entity, {cube});
+		}
+
+		// spread evenly over the grid (sunflower spiral), each reaching a few cubes around it
+		const float golden_angle = glm::pi<float>() * (3.f - std::sqrt(5.f));
+		for(uint32_t i = 0; i < lights; i++){
+			float angle = i * golden_angle;
+			float distance = scene_extent * std::sqrt((i + .5f) / lights);
+			Entity light = scene.create_point_light(.5f, .1f, {.5f + .5f * std::cos(angle), .5f + .5f * std::sin(angle), 1.f}, 3.f * spacing);
+			scene.transforms.get(light).set_translation({distance * std::cos(angle), -1.5f, distance * std::sin(angle)});
+		}
+	}
+
+	void Benchmark::camera_path(uint32_t frame, glm::vec3& position, glm::vec3& target) const{
+		// one full orbit around the grid over the recorded frames, slowly bobbing up and down (-y is up)
+		float t = static_cast<float>(frame) / std::max(1u, frames);
+		float angle = glm::two_pi<float>() * t;
+		float radius = scene_extent * .75f + 3.f;
+		position = {radius * std::cos(angle), -(scene_extent * .3f + 2.f) - std::sin(2.f * angle), radius * std::sin(angle)};
+		target = {0.f, 0.f, 0.f};
+	}
+
+	void Benchmark::add_frame(uint32_t frame, const FrameTimes& times){
+		if(frame < warmup_frames){
+			return;
+		}
+		samples.push_back(times);
+	}
+
+	void Benchmark::report(std::ostream& out) const{
+		if(samples.empty()){
+			out << "benchmark: no frames recorded" << '\n';
+			return;
+		}
+		struct Column{
+			const char* name;
+			double FrameTimes::* field;
+		};
+		const Column columns[] = {
+			{"acquire", &FrameTimes::acquire_ms},
+			{"update", &FrameTimes::update_ms},
+			{"record", &FrameTimes::record_ms},
+			{"submit", &FrameTimes::submit_ms},
+			{"frame", &FrameTimes::frame_ms}
+		};
+
+		out << "benchmark: " << objects << " objects, " << lights << " lights, " << samples.size() << " frames (" << warmup_frames << " warmup)" << '\n';
+		out << std::fixed << std::setprecision(3);
+		out << std::left << std::setw(10) << "cpu ms" << std::right << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "max" << '\n';
+		double total_ms = 0.0;
+		for(const auto& column : columns){
+			std::vector<double> values;
+			values.reserve(samples.size());
+			double sum = 0.0;
+			for(const auto& sample : samples){
+				values.push_back(sample.*column.field);
+				sum += sample.*column.field;
+			}
+			if(column.field == &FrameTimes::frame_ms){
+				total_ms = sum;
+			}
+			out << std::left << std::setw(10) << column.name << std::right
+				<< std::setw(10) << sum / values.size()
+				<< std::setw(10) << percentile(values, 50.0)
+				<< std::setw(10) << percentile(values, 95.0)
+				<< std::setw(10) << percentile(values, 99.0)
+				<< std::setw(10) << *std::max_element(values.begin(), values.end()) << '\n';
+		}
+		out << "throughput: " << std::setprecision(1) << 1000.0 * samples.size() / total_ms << " frames/s, "
+			<< static_cast<double>(objects) * samples.size() * 1000.0 / total_ms << " objects/s" << '\n';
+		out << std::defaultfloat;
+	}
+
+}
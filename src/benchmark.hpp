@@ -0,0 +1,55 @@
+#pragma once
+
+#include "device.hpp"
+#include "scene.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace blikaengine{
+
+	// Replays a fixed camera path over a synthetic scene and collects per-frame CPU timings.
+	// Everything is driven by the frame number (including the simulated frame time), so two
+	// runs with the same settings record exactly the same command streams.
+	class Benchmark{
+		public:
+			static constexpr float FRAME_TIME = 1.f / 60.f;
+
+			struct FrameTimes{
+				double acquire_ms = 0.0;
+				double update_ms = 0.0;
+				double record_ms = 0.0;
+				double submit_ms = 0.0;
+				double frame_ms = 0.0;
+			};
+
+			Benchmark(uint32_t objects, uint32_t lights, uint32_t frames, uint32_t warmup_frames);
+			Benchmark(const Benchmark&) = delete;
+			Benchmark& operator = (const Benchmark&) = delete;
+
+			void load_scene(Device& device, Scene& scene);
+			void camera_path(uint32_t frame, glm::vec3& position, glm::vec3& target) const;
+
+			// warmup frames are rendered but not recorded
+			void add_frame(uint32_t frame, const FrameTimes& times);
+			void report(std::ostream& out) const;
+
+			uint32_t get_frames() const{
+				return frames + warmup_frames;
+			}
+
+		private:
+			uint32_t objects;
+			uint32_t lights;
+			uint32_t frames;
+			uint32_t warmup_frames;
+			float scene_extent = 1.f;
+			std::vector<FrameTimes> samples;
+	};
+
+}
@@ -2,9 +2,12 @@
 #include "camera.hpp"
 #include "render/master_render_system.hpp"
 #include "render/point_light_system.hpp"
+#include "render/shadow_system.hpp"
 #include "keyboard_movement_controller.hpp"
 #include "buffer.hpp"
 #include "texture.hpp"
+#include "mesh_pool.hpp"
+#include "upload_manager.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -24,7 +27,11 @@ namespace blikaengine{
 	BlikaEngine* BlikaEngine::instance = nullptr;
 	std::default_random_engine BlikaEngine::rnd_eng(std::random_device{}());
 	
-	BlikaEngine::BlikaEngine(){
+	BlikaEngine::BlikaEngine(const EngineConfig& config): config{config}{
+		if(config.benchmark){
+			benchmark = std::make_unique<Benchmark>(config.benchmark_objects, config.benchmark_lights, config.frames > 0 ? config.frames : 1000, config.benchmark_warmup);
+			this->config.frames = benchmark->get_frames();
+		}
 		global_pool = DescriptorPool::Builder(device)
 			.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
 			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
@@ -64,64 +71,118 @@ namespace blikaengine{
 				.build(global_descriptor_sets[i]);
 		}
 
-		MasterRenderSystem master_render_system{device, renderer.get_swap_chain_render_pass(), global_set_layout->getDescriptorSetLayout()};
 		PointLightSystem point_light_system{device, renderer.get_swap_chain_render_pass(), global_set_layout->getDescriptorSetLayout()};
+		ShadowSystem shadow_system{device};
+		MasterRenderSystem master_render_system{device, renderer.get_swap_chain_render_pass(), global_set_layout->getDescriptorSetLayout(), point_light_system.get_light_set_layout(), shadow_system.get_shadow_set_layout(), config.depth_prepass};
 		Camera camera{};
-		auto viewer_object = GameObject::create_game_object();
-		viewer_object.transform.translation.y = -1.f;
-		viewer_object.transform.translation.z = -2.f;
+		TransformComponent viewer_transform{};
+		viewer_transform.set_translation({.0f, -1.f, -2.f});
 		KeyboardMovementController camera_controller{};
 		auto current_time = std::chrono::high_resolution_clock::now();
-		while(!window.should_close()){
-			glfwPollEvents();
+		auto start_time = current_time;
+		uint32_t frames_rendered = 0;
+		auto elapsed_ms = [](auto from, auto to){
+			return std::chrono::duration<double, std::chrono::milliseconds::period>(to - from).count();
+		};
+		while(!window.should_close() && (config.frames == 0 || frames_rendered < config.frames)){
 			auto new_time = std::chrono::high_resolution_clock::now();
 			float frame_time = std::chrono::duration<float, std::chrono::seconds::period>(new_time - current_time).count();
 			current_time = new_time;
-			camera_controller.move_in_plane_XZ(window.get_GLFWWindow(), frame_time, viewer_object);
-			camera.set_view_YXZ(viewer_object.transform.translation, viewer_object.transform.rotation);
+			if(!window.is_headless()){
+				glfwPollEvents();
+			}
+			if(benchmark){
+				frame_time = Benchmark::FRAME_TIME;
+				glm::vec3 position, target;
+				benchmark->camera_path(frames_rendered, position, target);
+				camera.set_view_target(position, target);
+			}else{
+				if(!window.is_headless()){
+					camera_controller.move_in_plane_XZ(window.get_GLFWWindow(), frame_time, viewer_transform);
+				}
+				camera.set_view_YXZ(viewer_transform.get_translation(), viewer_transform.get_rotation());
+			}
+			device.uploadManager().collect();
+			device.meshPool().collect();
 			float aspect = renderer.get_aspect_ratio();
 			camera.set_orthographic_projection(-aspect,aspect,-1,1,-1,1);
 			camera.set_perspective_projection(glm::radians(50.f), aspect, .1f, 100.f);
 			if(auto command_buffer = renderer.begin_frame()){
+				auto acquired_time = std::chrono::high_resolution_clock::now();
 				int frame_index = renderer.get_frame_index();
-				FrameInfo frame_info{frame_index,frame_time,command_buffer,camera,global_descriptor_sets[frame_index],game_objects};
+				FrameInfo frame_info{frame_index,frame_time,command_buffer,camera,global_descriptor_sets[frame_index],point_light_system.get_light_set(frame_index),shadow_system.get_shadow_set(frame_index),scene,renderer.get_depth_pyramid()};
 
 				//update
 				GlobalUbo ubo{};
 				ubo.projection = camera.get_projection();
 				ubo.view = camera.get_view();
 				ubo.inverse_view = camera.get_inverse_view();
-				point_light_system.update(frame_info,ubo);
+				point_light_system.update(frame_info);
+				scene.update_transforms();
+				scene.update_bounds();
+				point_light_system.write_lights(frame_info,ubo,renderer.get_swap_chain_extent());
+				shadow_system.update(frame_info,renderer.get_swap_chain_extent());
 				ubo_buffers[frame_index]->writeToBuffer(&ubo);
 				ubo_buffers[frame_index]->flush();
+				auto updated_time = std::chrono::high_resolution_clock::now();
 
 				//render
+				shadow_system.render(frame_info);
+				master_render_system.cull(frame_info);
 				renderer.begin_swap_chain_render_pass(command_buffer);
 
 				master_render_system.render_game_objects(frame_info);
+				renderer.begin_transparent_subpass(command_buffer);
 				point_light_system.render(frame_info);
 
 				renderer.end_swap_chain_render_pass(command_buffer);
+				renderer.build_depth_pyramid(command_buffer, ubo.projection * ubo.view);
+				auto recorded_time = std::chrono::high_resolution_clock::now();
+				// uploads recorded since the last frame, including models created while this one was
+				// updated and the copies of any mesh pool buffer it grew into, go out in one batch ahead of
+				// this frame's submit
+				device.uploadManager().flush();
 				renderer.end_frame();
+				if(benchmark){
+					auto submitted_time = std::chrono::high_resolution_clock::now();
+					Benchmark::FrameTimes times{};
+					times.acquire_ms = elapsed_ms(new_time, acquired_time);
+					times.update_ms = elapsed_ms(acquired_time, updated_time);
+					times.record_ms = elapsed_ms(updated_time, recorded_time);
+					times.submit_ms = elapsed_ms(recorded_time, submitted_time);
+					times.frame_ms = elapsed_ms(new_time, submitted_time);
+					benchmark->add_frame(frames_rendered, times);
+				}
+				frames_rendered++;
 			}
 		}
 		vkDeviceWaitIdle(device.device());
+
+		if(benchmark){
+			benchmark->report(std::cout);
+			device.memoryAllocator().print_stats(std::cout);
+		}else if(window.is_headless() && frames_rendered > 0){
+			float total = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start_time).count();
+			std::cout << "rendered " << frames_rendered << " headless frames in " << total << " ms (" << total / frames_rendered << " ms/frame)" << '\n';
+		}
 	}
 
 	void BlikaEngine::load_game_objects(){
+		if(benchmark){
+			benchmark->load_scene(device, scene);
+			return;
+		}
 		std::shared_ptr<Model> model_floor = Model::create_model_from_file(device, "models/quad.obj");
-		auto floor = GameObject::create_game_object();
-		floor.model = model_floor;
-		floor.transform.translation = {.0f, .0f, .0f};
-		floor.transform.scale = {5.f, 1.f, 5.f};
-		game_objects.emplace(floor.getId(), std::move(floor));
+		Entity floor = scene.create_entity();
+		auto& floor_transform = scene.transforms.add(floor);
+		floor_transform.set_scale({5.f, 1.f, 5.f});
+		scene.renderables.add(floor, {model_floor});
 
 		std::shared_ptr<Model> model_mei = Model::create_model_from_file(device, "models/raiden_mei.obj");
-		auto mei = GameObject::create_game_object();
-		mei.model = model_mei;
-		mei.transform.translation = {.0f, .0f, .0f};
-		mei.transform.scale = {.1f, .1f, .1f};
-		game_objects.emplace(mei.getId(), std::move(mei));
+		Entity mei = scene.create_entity();
+		auto& mei_transform = scene.transforms.add(mei);
+		mei_transform.set_scale({.1f, .1f, .1f});
+		scene.renderables.add(mei, {model_mei});
 
 		std::vector<glm::vec3> lightColors{
 			{1.f, .1f, .1f},
@@ -132,11 +193,9 @@ namespace blikaengine{
 			{1.f, 1.f, 1.f}
   		};
 		for(int i = 0; i < lightColors.size(); i++){
-			auto light = GameObject::make_point_light(0.1f);
-			light.color = lightColors[i];
+			Entity light = scene.create_point_light(0.1f, 0.1f, lightColors[i]);
 			auto rotate = glm::rotate(glm::mat4(1.f), (i * glm::two_pi<float>()) / lightColors.size(), {0.f, -1.f, 0.f});
-			light.transform.translation = glm::vec3(rotate * glm::vec4(-1.f, -1.f, -1.f, 1.f));
-			game_objects.emplace(light.getId(), std::move(light));
+			scene.transforms.get(light).set_translation(glm::vec3(rotate * glm::vec4(-1.f, -1.f, -1.f, 1.f)));
 		}
 	}
 }
\ No newline at end of file
@@ -1,9 +1,10 @@
 #pragma once
 
+#include "benchmark.hpp"
 #include "descriptors.hpp"
 #include "device.hpp"
-#include "game_object.hpp"
 #include "renderer.hpp"
+#include "scene.hpp"
 #include "window.hpp"
 
 #include <memory>
@@ -12,6 +13,25 @@
 
 namespace blikaengine{
 
+	struct EngineConfig{
+		// render into offscreen images instead of a window surface (no display needed)
+		bool headless = false;
+		// stop after this many rendered frames, 0 runs until the window is closed
+		uint32_t frames = 0;
+		// size of the persistently mapped ring all uploads are staged through, bigger assets are streamed in chunks
+		uint32_t staging_mb = 32;
+		// draw the opaque objects depth only first, then shade with an EQUAL depth test, no overdraw
+		bool depth_prepass = false;
+		// how every model's vertices are stored, the packed formats take half the bytes or less
+		VertexFormat vertex_format = VertexFormat::Full;
+
+		// benchmark mode: replay a fixed camera path over a synthetic scene and report frame timings
+		bool benchmark = false;
+		uint32_t benchmark_objects = 1000;
+		uint32_t benchmark_lights = 6;
+		uint32_t benchmark_warmup = 60;
+	};
+
 	class BlikaEngine{
 		public:
 			static constexpr int WIDTH = 1200;
@@ -19,7 +39,7 @@ namespace blikaengine{
 			static std::default_random_engine rnd_eng;
 			static BlikaEngine* instance;
 			
-			BlikaEngine();
+			BlikaEngine(const EngineConfig& config = EngineConfig{});
 			~BlikaEngine();
 			BlikaEngine(const BlikaEngine&) = delete;
 			BlikaEngine& operator = (const BlikaEngine&) = delete;
@@ -33,12 +53,14 @@ namespace blikaengine{
 		private:
 			void load_game_objects();
 
-			Window window{WIDTH, HEIGHT, "Blika Engine"};
-			Device device{window};
+			EngineConfig config;
+			std::unique_ptr<Benchmark> benchmark{};
+			Window window{WIDTH, HEIGHT, "Blika Engine", config.headless};
+			Device device{window, static_cast<VkDeviceSize>(config.staging_mb) * 1024 * 1024, config.vertex_format};
 			Renderer renderer{window,device};
 
 			std::unique_ptr<DescriptorPool> global_pool{};
-			GameObject::Map game_objects;
+			Scene scene;
 	};
 
 }
\ No newline at end of file
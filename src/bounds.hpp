@@ -0,0 +1,52 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace blikaengine{
+
+	// Axis aligned box, default constructed empty so the first expand() sets it
+	struct AABB{
+		glm::vec3 min{std::numeric_limits<float>::max()};
+		glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+		bool valid() const{ return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+		glm::vec3 center() const{ return .5f * (min + max); }
+		glm::vec3 extent() const{ return .5f * (max - min); }
+
+		void expand(const glm::vec3& point){
+			min = glm::min(min, point);
+			max = glm::max(max, point);
+		}
+
+		// smallest axis aligned box around the transformed box (Arvo)
+		AABB transformed(const glm::mat4& matrix) const{
+			const glm::vec3 new_center = glm::vec3(matrix * glm::vec4(center(), 1.f));
+			const glm::vec3 old_extent = extent();
+			glm::vec3 new_extent{0.f};
+			for(int column = 0; column < 3; column++){
+				new_extent += glm::abs(glm::vec3(matrix[column])) * old_extent[column];
+			}
+			return {new_center - new_extent, new_center + new_extent};
+		}
+	};
+
+	struct BoundingSphere{
+		glm::vec3 center{0.f};
+		float radius = 0.f;
+
+		// stays conservative under non uniform scale by taking the largest axis
+		BoundingSphere transformed(const glm::mat4& matrix) const{
+			const float scale_squared = std::max({
+				glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+				glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1])),
+				glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))
+			});
+			return {glm::vec3(matrix * glm::vec4(center, 1.f)), radius * glm::sqrt(scale_squared)};
+		}
+	};
+}
@@ -29,21 +29,24 @@ namespace blikaengine{
 		return instanceSize;
 	}
  
-	Buffer::Buffer(Device &device,VkDeviceSize instanceSize,uint32_t instanceCount,VkBufferUsageFlags usageFlags,VkMemoryPropertyFlags memoryPropertyFlags,VkDeviceSize minOffsetAlignment): device{device},instanceSize{instanceSize},instanceCount{instanceCount},usageFlags{usageFlags},memoryPropertyFlags{memoryPropertyFlags}{
+	Buffer::Buffer(Device &device,VkDeviceSize instanceSize,uint32_t instanceCount,VkBufferUsageFlags usageFlags,VkMemoryPropertyFlags memoryPropertyFlags,VkDeviceSize minOffsetAlignment,AllocationStrategy allocationStrategy): device{device},instanceSize{instanceSize},instanceCount{instanceCount},usageFlags{usageFlags},memoryPropertyFlags{memoryPropertyFlags}{
 		alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
 		bufferSize = alignmentSize * instanceCount;
-		device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+		device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory, allocationStrategy);
 	}
  
 	Buffer::~Buffer(){
 		unmap();
 		vkDestroyBuffer(device.device(), buffer, nullptr);
-		vkFreeMemory(device.device(), memory, nullptr);
+		device.freeMemory(memory);
 	}
  
 	/**
 	 * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
 	 *
+	 * @note Host visible memory blocks stay mapped by the allocator, so this only hands out a pointer
+	 * into that mapping
+	 *
 	 * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
 	 * buffer range.
 	 * @param offset (Optional) Byte offset from beginning
@@ -51,20 +54,21 @@ namespace blikaengine{
 	 * @return VkResult of the buffer mapping call
 	 */
 	VkResult Buffer::map(VkDeviceSize size, VkDeviceSize offset){
-		assert(buffer && memory && "Called map on buffer before create");
-		return vkMapMemory(device.device(), memory, offset, size, 0, &mapped);
+		assert(buffer && memory.memory && "Called map on buffer before create");
+		if(memory.mapped == nullptr){
+			return VK_ERROR_MEMORY_MAP_FAILED;
+		}
+		mapped = static_cast<char*>(memory.mapped) + offset;
+		return VK_SUCCESS;
 	}
  
 	/**
 	 * Unmap a mapped memory range
 	 *
-	 * @note Does not return a result as vkUnmapMemory can't fail
+	 * @note The underlying memory block stays mapped until it is freed
 	 */
 	void Buffer::unmap(){
-		if(mapped){
-			vkUnmapMemory(device.device(), memory);
-			mapped = nullptr;
-		}
+		mapped = nullptr;
 	}
  
 	/**
@@ -100,11 +104,7 @@ namespace blikaengine{
 	 * @return VkResult of the flush call
 	 */
 	VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset){
-		VkMappedMemoryRange mappedRange = {};
-		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = memory;
-		mappedRange.offset = offset;
-		mappedRange.size = size;
+		VkMappedMemoryRange mappedRange = device.memoryAllocator().mapped_range(memory, size, offset);
 		return vkFlushMappedMemoryRanges(device.device(), 1, &mappedRange);
 	}
  
@@ -120,11 +120,7 @@ namespace blikaengine{
 	 * @return VkResult of the invalidate call
 	 */
 	VkResult Buffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-		VkMappedMemoryRange mappedRange = {};
-		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = memory;
-		mappedRange.offset = offset;
-		mappedRange.size = size;
+		VkMappedMemoryRange mappedRange = device.memoryAllocator().mapped_range(memory, size, offset);
 		return vkInvalidateMappedMemoryRanges(device.device(), 1, &mappedRange);
 	}
  
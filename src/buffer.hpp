@@ -6,7 +6,7 @@ namespace blikaengine{
  
 	class Buffer{
 		public:
-			Buffer(Device& device,VkDeviceSize instanceSize,uint32_t instanceCount,VkBufferUsageFlags usageFlags,VkMemoryPropertyFlags memoryPropertyFlags,VkDeviceSize minOffsetAlignment = 1);
+			Buffer(Device& device,VkDeviceSize instanceSize,uint32_t instanceCount,VkBufferUsageFlags usageFlags,VkMemoryPropertyFlags memoryPropertyFlags,VkDeviceSize minOffsetAlignment = 1,AllocationStrategy allocationStrategy = AllocationStrategy::FREE_LIST);
 			~Buffer();
  
 			Buffer(const Buffer&) = delete;
@@ -40,7 +40,7 @@ namespace blikaengine{
 			Device& device;
 			void* mapped = nullptr;
 			VkBuffer buffer = VK_NULL_HANDLE;
-			VkDeviceMemory memory = VK_NULL_HANDLE;
+			Allocation memory{};
  
 			VkDeviceSize bufferSize;
 			uint32_t instanceCount;
@@ -0,0 +1,288 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace blikaengine{
+
+	namespace{
+		inline AABB merge(const AABB& a, const AABB& b){
+			return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+		}
+
+		float surface_area(const AABB& box){
+			glm::vec3 size = box.max - box.min;
+			return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+		}
+	}
+
+	int32_t Bvh::allocate_node(){
+		if(free_nodes.empty()){
+			nodes.emplace_back();
+			return static_cast<int32_t>(nodes.size() - 1);
+		}
+		int32_t node = free_nodes.back();
+		free_nodes.pop_back();
+		nodes[node] = Node{};
+		return node;
+	}
+
+	void Bvh::free_node(int32_t node){
+		nodes[node].free = true;
+		free_nodes.push_back(node);
+	}
+
+	int32_t Bvh::insert(const AABB& bounds, Entity entity){
+		assert(bounds.valid() && "bvh leaves need valid bounds");
+		int32_t leaf = allocate_node();
+		nodes[leaf].bounds = bounds;
+		nodes[leaf].entity = entity;
+		new_leaves.push_back(leaf);
+		leaf_count++;
+		changes_since_build++;
+		return leaf;
+	}
+
+	void Bvh::insert_leaf(int32_t leaf){
+		nodes[leaf].linked = true;
+		if(root == NULL_NODE){
+			root = leaf;
+			nodes[leaf].parent = NULL_NODE;
+			return;
+		}
+		// walk down to the cheapest sibling: the new parent costs the merged area, every node on the way grows too
+		const AABB leaf_bounds = nodes[leaf].bounds;
+		int32_t sibling = root;
+		while(!nodes[sibling].is_leaf()){
+			const Node& node = nodes[sibling];
+			float area = surface_area(node.bounds);
+			float merged_area = surface_area(merge(node.bounds, leaf_bounds));
+			float cost = 2.f * merged_area;
+			float inheritance_cost = 2.f * (merged_area - area);
+			float child_costs[2];
+			for(int i = 0; i < 2; i++){
+				const Node& child = nodes[node.children[i]];
+				float merged_child_area = surface_area(merge(child.bounds, leaf_bounds));
+				child_costs[i] = (child.is_leaf() ? merged_child_area : merged_child_area - surface_area(child.bounds)) + inheritance_cost;
+			}
+			if(cost < child_costs[0] && cost < child_costs[1]){
+				break;
+			}
+			sibling = node.children[child_costs[0] <= child_costs[1] ? 0 : 1];
+		}
+
+		int32_t old_parent = nodes[sibling].parent;
+		int32_t new_parent = allocate_node();
+		nodes[new_parent].parent = old_parent;
+		nodes[new_parent].bounds = merge(nodes[sibling].bounds, leaf_bounds);
+		nodes[new_parent].children[0] = sibling;
+		nodes[new_parent].children[1] = leaf;
+		nodes[sibling].parent = new_parent;
+		nodes[leaf].parent = new_parent;
+		if(old_parent == NULL_NODE){
+			root = new_parent;
+		}else{
+			Node& parent = nodes[old_parent];
+			parent.children[parent.children[0] == sibling ? 0 : 1] = new_parent;
+			refit_ancestors(new_parent);
+		}
+	}
+
+	void Bvh::remove(int32_t leaf){
+		assert(leaf >= 0 && leaf < static_cast<int32_t>(nodes.size()) && !nodes[leaf].free && nodes[leaf].is_leaf() && "not a bvh leaf");
+		leaf_count--;
+		changes_since_build++;
+		if(!nodes[leaf].linked){
+			new_leaves.erase(std::find(new_leaves.begin(), new_leaves.end(), leaf));
+			free_node(leaf);
+			return;
+		}
+		if(leaf == root){
+			root = NULL_NODE;
+			free_node(leaf);
+			return;
+		}
+		// the sibling takes the parent's place
+		int32_t parent = nodes[leaf].parent;
+		int32_t grand_parent = nodes[parent].parent;
+		int32_t sibling = nodes[parent].children[nodes[parent].children[0] == leaf ? 1 : 0];
+		nodes[sibling].parent = grand_parent;
+		if(grand_parent == NULL_NODE){
+			root = sibling;
+		}else{
+			Node& grand = nodes[grand_parent];
+			grand.children[grand.children[0] == parent ? 0 : 1] = sibling;
+			refit_ancestors(sibling);
+		}
+		free_node(parent);
+		free_node(leaf);
+	}
+
+	void Bvh::update(int32_t leaf, const AABB& bounds){
+		assert(!nodes[leaf].free && nodes[leaf].is_leaf() && "not a bvh leaf");
+		nodes[leaf].bounds = bounds;
+		moved_leaves.push_back(leaf);
+		changes_since_build++;
+	}
+
+	void Bvh::refit_ancestors(int32_t node){
+		for(int32_t parent = nodes[node].parent; parent != NULL_NODE; parent = nodes[parent].parent){
+			Node& current = nodes[parent];
+			AABB bounds = merge(nodes[current.children[0]].bounds, nodes[current.children[1]].bounds);
+			if(bounds.min == current.bounds.min && bounds.max == current.bounds.max){
+				break;
+			}
+			current.bounds = bounds;
+		}
+	}
+
+	void Bvh::refit(){
+		if(leaf_count > 1 && changes_since_build > REBUILD_FRACTION * leaf_count){
+			rebuild();
+			return;
+		}
+		for(int32_t leaf : moved_leaves){
+			// removed since it moved, or not linked yet
+			if(!nodes[leaf].free && nodes[leaf].is_leaf() && nodes[leaf].linked){
+				refit_ancestors(leaf);
+			}
+		}
+		moved_leaves.clear();
+		for(int32_t leaf : new_leaves){
+			insert_leaf(leaf);
+		}
+		new_leaves.clear();
+	}
+
+	void Bvh::rebuild(){
+		moved_leaves.clear();
+		new_leaves.clear();
+		changes_since_build = 0;
+		std::vector<BuildLeaf> leaves{};
+		leaves.reserve(leaf_count);
+		for(int32_t i = 0; i < static_cast<int32_t>(nodes.size()); i++){
+			if(nodes[i].free){
+				continue;
+			}
+			if(nodes[i].is_leaf()){
+				nodes[i].linked = true;
+				leaves.push_back({i, nodes[i].bounds, nodes[i].bounds.center()});
+			}else{
+				free_node(i);
+			}
+		}
+		root = leaves.empty() ? NULL_NODE : build(leaves, 0, leaves.size(), NULL_NODE);
+	}
+
+	// top down, splitting where the binned surface area heuristic is cheapest
+	int32_t Bvh::build(std::vector<BuildLeaf>& leaves, size_t begin, size_t end, int32_t parent){
+		if(end - begin == 1){
+			nodes[leaves[begin].leaf].parent = parent;
+			return leaves[begin].leaf;
+		}
+		AABB centroid_bounds{};
+		for(size_t i = begin; i < end; i++){
+			centroid_bounds.expand(leaves[i].centroid);
+		}
+
+		struct Bin{
+			AABB bounds{};
+			size_t count = 0;
+		};
+		// all three axes binned in one pass over the leaves, small ranges (most of the calls) get fewer bins
+		const int bin_count = static_cast<int>(std::min<size_t>(SAH_BINS, end - begin));
+		glm::vec3 extent = centroid_bounds.max - centroid_bounds.min;
+		glm::vec3 bin_scale{};
+		for(int axis = 0; axis < 3; axis++){
+			bin_scale[axis] = extent[axis] > 0.f ? bin_count / extent[axis] : 0.f;
+		}
+		Bin bins[3][SAH_BINS];
+		for(int axis = 0; axis < 3; axis++){
+			std::fill_n(bins[axis], bin_count, Bin{});
+		}
+		for(size_t i = begin; i < end; i++){
+			glm::ivec3 bin = glm::min(glm::ivec3{(leaves[i].centroid - centroid_bounds.min) * bin_scale}, glm::ivec3{bin_count - 1});
+			for(int axis = 0; axis < 3; axis++){
+				Bin& target = bins[axis][bin[axis]];
+				target.bounds = merge(target.bounds, leaves[i].bounds);
+				target.count++;
+			}
+		}
+
+		float best_cost = std::numeric_limits<float>::max();
+		int best_axis = -1;
+		int best_split = 0;
+		for(int axis = 0; axis < 3; axis++){
+			if(extent[axis] <= 0.f){
+				continue;
+			}
+			// cost of splitting after bin i: left area * left count + right area * right count
+			float left_costs[SAH_BINS - 1];
+			AABB left{};
+			size_t left_count = 0;
+			for(int i = 0; i < bin_count - 1; i++){
+				left = merge(left, bins[axis][i].bounds);
+				left_count += bins[axis][i].count;
+				left_costs[i] = left_count == 0 ? 0.f : surface_area(left) * left_count;
+			}
+			AABB right{};
+			size_t right_count = 0;
+			for(int i = bin_count - 1; i > 0; i--){
+				right = merge(right, bins[axis][i].bounds);
+				right_count += bins[axis][i].count;
+				if(right_count == 0 || right_count == end - begin){
+					continue;
+				}
+				float cost = left_costs[i - 1] + surface_area(right) * right_count;
+				if(cost < best_cost){
+					best_cost = cost;
+					best_axis = axis;
+					best_split = i;
+				}
+			}
+		}
+
+		size_t middle;
+		if(best_axis < 0){
+			// every centroid in the same spot, any split is as good as another
+			middle = begin + (end - begin) / 2;
+		}else{
+			auto split = std::partition(leaves.begin() + begin, leaves.begin() + end, [&](const BuildLeaf& leaf){
+				return std::min(bin_count - 1, static_cast<int>((leaf.centroid[best_axis] - centroid_bounds.min[best_axis]) * bin_scale[best_axis])) < best_split;
+			});
+			middle = static_cast<size_t>(split - leaves.begin());
+		}
+
+		int32_t node = allocate_node();
+		nodes[node].parent = parent;
+		int32_t left_child = build(leaves, begin, middle, node);
+		int32_t right_child = build(leaves, middle, end, node);
+		nodes[node].children[0] = left_child;
+		nodes[node].children[1] = right_child;
+		nodes[node].bounds = merge(nodes[left_child].bounds, nodes[right_child].bounds);
+		return node;
+	}
+
+	void Bvh::clear(){
+		nodes.clear();
+		free_nodes.clear();
+		moved_leaves.clear();
+		new_leaves.clear();
+		root = NULL_NODE;
+		leaf_count = 0;
+		changes_since_build = 0;
+	}
+
+	// slab test
+	bool Bvh::ray_box(const glm::vec3& origin, const glm::vec3& inv_direction, float max_distance, const AABB& box, float& entry){
+		glm::vec3 t0 = (box.min - origin) * inv_direction;
+		glm::vec3 t1 = (box.max - origin) * inv_direction;
+		glm::vec3 t_near = glm::min(t0, t1);
+		glm::vec3 t_far = glm::max(t0, t1);
+		float enter = std::max({t_near.x, t_near.y, t_near.z, 0.f});
+		float exit = std::min({t_far.x, t_far.y, t_far.z, max_distance});
+		entry = enter;
+		return enter <= exit;
+	}
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "bounds.hpp"
+#include "entity.hpp"
+#include "frustum.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace blikaengine{
+
+	// Dynamic bounding volume hierarchy over entity bounds. Leaves are inserted incrementally (cheapest
+	// sibling by surface area), moved leaves only refit their ancestors, and once a good part of the
+	// leaves has moved or been added since the last build the whole tree is rebuilt with a binned SAH.
+	// Leaf ids stay valid across rebuilds. Queries visit leaves in no particular order.
+	class Bvh{
+		public:
+			static constexpr int32_t NULL_NODE = -1;
+
+			// returns the leaf id, the leaf is linked into the tree (and found by queries) by the next refit()
+			int32_t insert(const AABB& bounds, Entity entity);
+			void remove(int32_t leaf);
+			// the ancestors are only refit by the next refit()
+			void update(int32_t leaf, const AABB& bounds);
+			// links new leaves and propagates updated ones to the root, rebuilds instead if enough changed
+			void refit();
+			void rebuild();
+			void clear();
+
+			size_t get_leaf_count() const{ return leaf_count; }
+			const AABB& get_bounds(int32_t leaf) const{ return nodes[leaf].bounds; }
+
+			// visit(Entity) for every leaf whose box touches the frustum, subtrees fully inside are not tested further
+			template<typename F>
+			void query(const Frustum& frustum, F&& visit) const{
+				std::vector<int32_t> stack{};
+				traverse(stack, [&](const Node& node){
+					if(!frustum.intersects(node.bounds)){
+						return Visit::Skip;
+					}
+					return frustum.contains(node.bounds) ? Visit::All : Visit::Children;
+				}, [&](const Node& leaf){ visit(leaf.entity); });
+			}
+
+			// visit(Entity) for every leaf whose box touches the sphere
+			template<typename F>
+			void query(const BoundingSphere& sphere, F&& visit) const{
+				std::vector<int32_t> stack{};
+				traverse(stack, [&](const Node& node){
+					glm::vec3 offset = glm::clamp(sphere.center, node.bounds.min, node.bounds.max) - sphere.center;
+					return glm::dot(offset, offset) <= sphere.radius * sphere.radius ? Visit::Children : Visit::Skip;
+				}, [&](const Node& leaf){ visit(leaf.entity); });
+			}
+
+			// visit(Entity, float distance) for every leaf box the ray enters within max_distance, distance is
+			// where it enters (0 if the origin is inside). direction does not have to be normalized, distances are in its units.
+			template<typename F>
+			void query(const glm::vec3& origin, const glm::vec3& direction, float max_distance, F&& visit) const{
+				const glm::vec3 inv_direction = 1.f / direction;
+				std::vector<int32_t> stack{};
+				float entry = 0.f;
+				traverse(stack, [&](const Node& node){
+					return ray_box(origin, inv_direction, max_distance, node.bounds, entry) ? Visit::Children : Visit::Skip;
+				}, [&](const Node& leaf){ visit(leaf.entity, entry); });
+			}
+
+		private:
+			struct Node{
+				AABB bounds{};
+				int32_t parent = NULL_NODE;
+				// both NULL_NODE for leaves
+				int32_t children[2] = {NULL_NODE, NULL_NODE};
+				Entity entity{};
+				bool free = false;
+				bool linked = false;
+
+				bool is_leaf() const{ return children[0] == NULL_NODE; }
+			};
+
+			enum class Visit{
+				Skip,
+				Children,
+				// every leaf below, without testing them
+				All
+			};
+
+			// Rebuild once this fraction of the leaves moved or was added since the last build. Refits let
+			// boxes overlap more and more, a full binned build is O(n log n) and fast enough to run now and then.
+			static constexpr float REBUILD_FRACTION = .25f;
+			static constexpr int SAH_BINS = 16;
+
+			static bool ray_box(const glm::vec3& origin, const glm::vec3& inv_direction, float max_distance, const AABB& box, float& entry);
+
+			// test(node) decides how to continue for every node it reaches, leaf(node) gets the accepted leaves
+			template<typename Test, typename Leaf>
+			void traverse(std::vector<int32_t>& stack, Test&& test, Leaf&& leaf) const{
+				if(root == NULL_NODE){
+					return;
+				}
+				stack.push_back(root);
+				while(!stack.empty()){
+					const Node& node = nodes[stack.back()];
+					stack.pop_back();
+					Visit visit = test(node);
+					if(visit == Visit::Skip){
+						continue;
+					}
+					if(node.is_leaf()){
+						leaf(node);
+					}else if(visit == Visit::All){
+						visit_leaves(node, leaf);
+					}else{
+						stack.push_back(node.children[0]);
+						stack.push_back(node.children[1]);
+					}
+				}
+			}
+
+			template<typename Leaf>
+			void visit_leaves(const Node& subtree, Leaf&& leaf) const{
+				std::vector<int32_t> stack{subtree.children[0], subtree.children[1]};
+				while(!stack.empty()){
+					const Node& node = nodes[stack.back()];
+					stack.pop_back();
+					if(node.is_leaf()){
+						leaf(node);
+					}else{
+						stack.push_back(node.children[0]);
+						stack.push_back(node.children[1]);
+					}
+				}
+			}
+
+			int32_t allocate_node();
+			void free_node(int32_t node);
+			// links an allocated leaf into the tree
+			void insert_leaf(int32_t leaf);
+			// recomputes the boxes from node up to the root, stops early once a box stays the same
+			void refit_ancestors(int32_t node);
+			// a copy of the box, the build touches it for every level and nodes are in no useful order
+			struct BuildLeaf{
+				int32_t leaf;
+				AABB bounds;
+				glm::vec3 centroid;
+			};
+			int32_t build(std::vector<BuildLeaf>& leaves, size_t begin, size_t end, int32_t parent);
+
+			std::vector<Node> nodes{};
+			std::vector<int32_t> free_nodes{};
+			int32_t root = NULL_NODE;
+			size_t leaf_count = 0;
+			// leaves whose box changed since the last refit()
+			std::vector<int32_t> moved_leaves{};
+			// inserted but not linked yet, many of them at once go straight into a rebuild
+			std::vector<int32_t> new_leaves{};
+			size_t changes_since_build = 0;
+	};
+}
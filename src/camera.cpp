@@ -12,6 +12,8 @@ namespace blikaengine{
 		projection_matrix[3][0] = -(right + left) / (right - left);
 		projection_matrix[3][1] = -(bottom + top) / (bottom - top);
 		projection_matrix[3][2] = -near / (far - near);
+		near_plane = near;
+		far_plane = far;
 	}
  
 	void Camera::set_perspective_projection(float fovy, float aspect, float near, float far){
@@ -23,6 +25,8 @@ namespace blikaengine{
 		projection_matrix[2][2] = far / (far - near);
 		projection_matrix[2][3] = 1.f;
 		projection_matrix[3][2] = -(far * near) / (far - near);
+		near_plane = near;
+		far_plane = far;
 	}
 
 	void Camera::set_view_direction(glm::vec3 position, glm::vec3 direction, glm::vec3 up) {
@@ -30,9 +30,20 @@ namespace blikaengine{
 				return glm::vec3(inverse_view_matrix[3]);
 			}
 
+			// view space depth of the near / far plane of the current projection
+			float get_near() const{
+				return near_plane;
+			}
+
+			float get_far() const{
+				return far_plane;
+			}
+
 		private:
 			glm::mat4 projection_matrix{1.f};
 			glm::mat4 view_matrix{1.f};
 			glm::mat4 inverse_view_matrix{1.f};
+			float near_plane = 0.f;
+			float far_plane = 1.f;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "components.hpp"
+#include "transform_batch.hpp"
+
+namespace blikaengine{
+
+	glm::mat4 TransformComponent::mat4() const{
+		glm::mat4 model;
+		glm::mat3 normal;
+		TransformBatch::local_matrices(translation, rotation, scale, model, normal);
+		return model;
+	}
+
+	glm::mat3 TransformComponent::normal_matrix() const{
+		glm::mat4 model;
+		glm::mat3 normal;
+		TransformBatch::local_matrices(translation, rotation, scale, model, normal);
+		return normal;
+	}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "entity.hpp"
+#include "model.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace blikaengine{
+
+	// Local translation / rotation (YXZ euler) / scale relative to the parent, plus the cached world
+	// matrices. Setters only mark the transform dirty and report it to the scene owning it,
+	// Scene::update_transforms() recomputes the world matrices of dirty transforms and their descendants.
+	class TransformComponent{
+		public:
+			const glm::vec3& get_translation() const{ return translation; }
+			const glm::vec3& get_rotation() const{ return rotation; }
+			const glm::vec3& get_scale() const{ return scale; }
+			void set_translation(const glm::vec3& value){ translation = value; mark_dirty(); }
+			void set_rotation(const glm::vec3& value){ rotation = value; mark_dirty(); }
+			void set_scale(const glm::vec3& value){ scale = value; mark_dirty(); }
+			Entity get_parent() const{ return parent; }
+			bool is_dirty() const{ return dirty; }
+
+			// local matrices, computed from scratch on every call
+			glm::mat4 mat4() const;
+			glm::mat3 normal_matrix() const;
+
+			// cached, valid as of the last Scene::update_transforms()
+			const glm::mat4& get_world_matrix() const{ return world_matrix; }
+			const glm::mat3& get_world_normal_matrix() const{ return world_normal_matrix; }
+			glm::vec3 get_world_position() const{ return glm::vec3(world_matrix[3]); }
+			// changes whenever the world matrix does, for caches built from it
+			uint32_t get_world_version() const{ return world_version; }
+
+		private:
+			// where a transform in a scene reports itself when it turns dirty, set by the scene. Copies
+			// start out unlinked, moves (within the component pool) keep the link
+			struct SceneLink{
+				std::vector<Entity>* dirty_entities = nullptr;
+				Entity entity{};
+
+				SceneLink() = default;
+				SceneLink(const SceneLink&){}
+				SceneLink& operator = (const SceneLink&){ return *this; }
+				SceneLink(SceneLink&&) = default;
+				SceneLink& operator = (SceneLink&&) = default;
+			};
+
+			void mark_dirty(){
+				if(!dirty && link.dirty_entities != nullptr){
+					link.dirty_entities->push_back(link.entity);
+				}
+				dirty = true;
+			}
+
+			glm::vec3 translation{};
+			glm::vec3 scale{1.f, 1.f, 1.f};
+			glm::vec3 rotation{};
+
+			Entity parent{};
+			bool dirty = true;
+			// last Scene::update_transforms() pass that visited this transform
+			uint32_t update_pass = 0;
+			// where the pass batched the local matrices of this transform, only meaningful while dirty
+			uint32_t batch_index = 0;
+			// bumped whenever the world matrix changes, children compare it with the value they were built from
+			uint32_t world_version = 0;
+			uint32_t parent_version = 0;
+			glm::mat4 world_matrix{1.f};
+			glm::mat3 world_normal_matrix{1.f};
+			SceneLink link{};
+
+			friend class Scene;
+	};
+
+	struct RenderableComponent{
+		std::shared_ptr<Model> model{};
+	};
+
+	struct PointLightComponent{
+		float light_intensity = 1.f;
+		glm::vec3 color{1.f};
+		// nothing past it is lit, keeps the light in the few clusters it reaches
+		float range = 10.f;
+		// direction the color / intensity animation is currently moving in
+		glm::vec4 multipliers{1,1,1,1};
+	};
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "cooked_mesh.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace blikaengine{
+
+	static_assert(std::is_trivially_copyable<ModelImport::Vertex>::value && std::is_trivially_copyable<ModelImport::Lod>::value && std::is_trivially_copyable<Meshlet>::value,
+		"cooked arrays are mapped as they are stored");
+
+	namespace{
+		// whole file read only, nullptr if it can't be mapped
+		const char* map_file(const std::string& filepath, size_t& size){
+#ifdef _WIN32
+			HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if(file == INVALID_HANDLE_VALUE){
+				return nullptr;
+			}
+			LARGE_INTEGER file_size{};
+			const char* data = nullptr;
+			if(GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0){
+				HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if(mapping != nullptr){
+					data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+					// the view keeps the mapping alive
+					CloseHandle(mapping);
+				}
+			}
+			CloseHandle(file);
+			size = static_cast<size_t>(file_size.QuadPart);
+			return data;
+#else
+			int file = open(filepath.c_str(), O_RDONLY);
+			if(file < 0){
+				return nullptr;
+			}
+			struct stat status{};
+			void* data = MAP_FAILED;
+			if(fstat(file, &status) == 0 && status.st_size > 0){
+				size = static_cast<size_t>(status.st_size);
+				data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+			}
+			// the mapping keeps the file alive
+			close(file);
+			if(data == MAP_FAILED){
+				return nullptr;
+			}
+			// read once front to back by the uploads
+			madvise(data, size, MADV_SEQUENTIAL);
+			return static_cast<const char*>(data);
+#endif
+		}
+
+		void unmap_file(const char* data, size_t size){
+#ifdef _WIN32
+			UnmapViewOfFile(data);
+#else
+			munmap(const_cast<char*>(data), size);
+#endif
+		}
+
+		uint64_t align_up(uint64_t offset, uint64_t alignment){
+			return (offset + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	void CookedMesh::write(const std::string& filepath, const ModelImport::Data& data){
+		Header header{};
+		header.magic = MAGIC;
+		header.version = VERSION;
+		const ModelImport::VertexLayout layout = ModelImport::get_vertex_layout(data.vertex_format);
+		header.vertex_size = layout.size;
+		header.lod_size = sizeof(ModelImport::Lod);
+		header.meshlet_size = sizeof(Meshlet);
+		header.vertex_count = static_cast<uint32_t>(data.vertices.size());
+		header.index_count = static_cast<uint32_t>(data.indices.size());
+		header.lod_count = static_cast<uint32_t>(data.lods.size());
+		header.meshlet_count = static_cast<uint32_t>(data.meshlets.size());
+		header.sphere_center = data.bounding_sphere.center;
+		header.sphere_radius = data.bounding_sphere.radius;
+		header.bounds_min = data.bounds.min;
+		header.bounds_max = data.bounds.max;
+		header.single_sided = data.single_sided ? 1 : 0;
+		header.vertex_format = static_cast<uint32_t>(data.vertex_format);
+		header.position_decode = data.position_decode;
+
+		const ModelImport::View view = data.view();
+		std::vector<glm::vec3> positions{};
+		if(view.positions == nullptr){
+			positions.resize(data.vertices.size());
+			for(size_t i = 0; i < positions.size(); i++){
+				positions[i] = data.vertices[i].position;
+			}
+		}
+		// every array in the order of the header's offsets
+		const std::pair<const void*, uint64_t> arrays[] = {
+			{view.vertices, static_cast<uint64_t>(view.vertex_count) * layout.size},
+			{view.positions != nullptr ? view.positions : positions.data(), static_cast<uint64_t>(view.vertex_count) * layout.position_size},
+			{data.indices.data(), data.indices.size() * sizeof(uint32_t)},
+			{data.lods.data(), data.lods.size() * sizeof(ModelImport::Lod)},
+			{data.meshlets.data(), data.meshlets.size() * sizeof(Meshlet)},
+		};
+		uint64_t* offsets[] = {&header.vertices_offset, &header.positions_offset, &header.indices_offset, &header.lods_offset, &header.meshlets_offset};
+		uint64_t end = sizeof(Header);
+		for(size_t i = 0; i < std::size(arrays); i++){
+			*offsets[i] = align_up(end, ARRAY_ALIGNMENT);
+			end = *offsets[i] + arrays[i].second;
+		}
+
+		std::ofstream file{filepath, std::ios::binary | std::ios::trunc};
+		if(!file.is_open()){
+			throw std::runtime_error("could not open file: " + filepath);
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		uint64_t written = sizeof(Header);
+		const char zeros[ARRAY_ALIGNMENT] = {};
+		for(size_t i = 0; i < std::size(arrays); i++){
+			file.write(zeros, static_cast<std::streamsize>(*offsets[i] - written));
+			file.write(static_cast<const char*>(arrays[i].first), static_cast<std::streamsize>(arrays[i].second));
+			written = *offsets[i] + arrays[i].second;
+		}
+		if(!file){
+			throw std::runtime_error("failed to write cooked mesh: " + filepath);
+		}
+	}
+
+	template<typename T>
+	const T* CookedMesh::array_at(uint64_t offset, uint64_t count) const{
+		if(count == 0){
+			return nullptr;
+		}
+		if(offset % ARRAY_ALIGNMENT != 0 || offset > size || (size - offset) / sizeof(T) < count){
+			throw std::runtime_error("array outside of the file");
+		}
+		return reinterpret_cast<const T*>(data + offset);
+	}
+
+	CookedMesh::CookedMesh(const std::string& filepath){
+		data = map_file(filepath, size);
+		if(data == nullptr){
+			throw std::runtime_error("could not map file: " + filepath);
+		}
+		Header header{};
+		if(size >= sizeof(Header)){
+			std::memcpy(&header, data, sizeof(Header));
+		}
+		if(size < sizeof(Header) || header.magic != MAGIC){
+			unmap_file(data, size);
+			throw std::runtime_error("not a cooked mesh: " + filepath);
+		}
+		const bool known_format = header.vertex_format <= static_cast<uint32_t>(VertexFormat::PackedUncolored);
+		const VertexFormat format = known_format ? static_cast<VertexFormat>(header.vertex_format) : VertexFormat::Full;
+		const ModelImport::VertexLayout layout = ModelImport::get_vertex_layout(format);
+		if(header.version != VERSION || !known_format || header.vertex_size != layout.size || header.lod_size != sizeof(ModelImport::Lod) || header.meshlet_size != sizeof(Meshlet)){
+			unmap_file(data, size);
+			throw std::runtime_error("cooked mesh from another engine version, cook it again: " + filepath);
+		}
+		try{
+			mesh_view.vertex_format = format;
+			mesh_view.vertices = array_at<char>(header.vertices_offset, static_cast<uint64_t>(header.vertex_count) * layout.size);
+			mesh_view.vertex_count = header.vertex_count;
+			mesh_view.positions = array_at<char>(header.positions_offset, static_cast<uint64_t>(header.vertex_count) * layout.position_size);
+			mesh_view.position_decode = header.position_decode;
+			mesh_view.indices = array_at<uint32_t>(header.indices_offset, header.index_count);
+			mesh_view.index_count = header.index_count;
+			mesh_view.lods = array_at<ModelImport::Lod>(header.lods_offset, header.lod_count);
+			mesh_view.lod_count = header.lod_count;
+			mesh_view.meshlets = array_at<Meshlet>(header.meshlets_offset, header.meshlet_count);
+			mesh_view.meshlet_count = header.meshlet_count;
+		}catch(const std::runtime_error&){
+			unmap_file(data, size);
+			throw std::runtime_error("truncated cooked mesh: " + filepath);
+		}
+		mesh_view.bounds = {header.bounds_min, header.bounds_max};
+		mesh_view.bounding_sphere = {header.sphere_center, header.sphere_radius};
+		mesh_view.single_sided = header.single_sided != 0;
+	}
+
+	CookedMesh::~CookedMesh(){
+		unmap_file(data, size);
+	}
+}
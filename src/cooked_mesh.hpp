@@ -0,0 +1,77 @@
+#pragma once
+
+#include "model_import.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace blikaengine{
+
+	// The .bmesh files the mesh_cook tool writes: a ModelImport::Data as import leaves it (welded, with bounds,
+	// levels of detail and meshlets), its vertices in the VertexFormat it was cooked for, plus the
+	// packed positions of the mesh pool's position stream. The
+	// arrays are stored in the engine's in memory layout, so loading maps the file read only and hands
+	// views into it to the mesh pool, whose uploads copy them straight into the staging ring. A file is
+	// only readable by builds with the same layouts, anything changing them has to bump VERSION.
+	class CookedMesh{
+		public:
+			// "BMSH" read as a little endian uint32_t
+			static constexpr uint32_t MAGIC = 0x48534d42;
+			static constexpr uint32_t VERSION = 3;
+			static constexpr const char* EXTENSION = ".bmesh";
+
+			// data has to be fully imported, see ModelImport::Data::load_model(), and is written in its
+			// vertex_format, see ModelImport::Data::pack_vertices()
+			static void write(const std::string& filepath, const ModelImport::Data& data);
+
+			// maps filepath, throws if it is not a cooked mesh this build can read
+			CookedMesh(const std::string& filepath);
+			~CookedMesh();
+			CookedMesh(const CookedMesh&) = delete;
+			CookedMesh& operator = (const CookedMesh&) = delete;
+
+			// points into the mapping, valid as long as the CookedMesh
+			const ModelImport::View& view() const{ return mesh_view; }
+
+		private:
+			struct Header{
+				uint32_t magic;
+				uint32_t version;
+				// sizes of the stored structs, catch layout changes that forgot to bump VERSION
+				uint32_t vertex_size;
+				uint32_t lod_size;
+				uint32_t meshlet_size;
+				uint32_t vertex_count;
+				uint32_t index_count;
+				uint32_t lod_count;
+				uint32_t meshlet_count;
+				float sphere_radius;
+				glm::vec3 sphere_center;
+				glm::vec3 bounds_min;
+				glm::vec3 bounds_max;
+				// ModelImport::Data::single_sided
+				uint32_t single_sided;
+				// VertexFormat of the vertices and positions, and the decode of packed ones
+				uint32_t vertex_format;
+				glm::vec4 position_decode;
+				uint32_t padding;
+				// byte offsets from the start of the file, ARRAY_ALIGNMENT aligned
+				uint64_t vertices_offset;
+				uint64_t positions_offset;
+				uint64_t indices_offset;
+				uint64_t lods_offset;
+				uint64_t meshlets_offset;
+			};
+
+			static constexpr uint64_t ARRAY_ALIGNMENT = 16;
+
+			// pointer to count elements of T at offset, throws if they run past the end of the file
+			template<typename T>
+			const T* array_at(uint64_t offset, uint64_t count) const;
+
+			const char* data = nullptr;
+			size_t size = 0;
+			ModelImport::View mesh_view{};
+	};
+}
@@ -0,0 +1,177 @@
+#include "depth_pyramid.hpp"
+#include "upload_manager.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace blikaengine{
+
+	DepthPyramid::DepthPyramid(Device& device, SwapChain& swap_chain): device{device}, depth_extent{swap_chain.getSwapChainExtent()}{
+		VkExtent2D extent = get_level_extent(0);
+		level_count = 1;
+		while(extent.width > 1 || extent.height > 1){
+			extent = {std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u)};
+			level_count++;
+		}
+		create_image();
+		create_sampler();
+		create_descriptor_sets(swap_chain);
+		create_pipeline();
+	}
+
+	DepthPyramid::~DepthPyramid(){
+		vkDestroyPipelineLayout(device.device(), pipeline_layout, nullptr);
+		vkDestroySampler(device.device(), sampler, nullptr);
+		for(auto view : level_views){
+			vkDestroyImageView(device.device(), view, nullptr);
+		}
+		vkDestroyImageView(device.device(), image_view, nullptr);
+		vkDestroyImage(device.device(), image, nullptr);
+		device.freeMemory(image_memory);
+	}
+
+	VkExtent2D DepthPyramid::get_level_extent(uint32_t level) const{
+		return {std::max(depth_extent.width >> (level + 1), 1u), std::max(depth_extent.height >> (level + 1), 1u)};
+	}
+
+	void DepthPyramid::create_image(){
+		VkExtent2D extent = get_level_extent(0);
+		VkImageCreateInfo image_info{};
+		image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		image_info.imageType = VK_IMAGE_TYPE_2D;
+		image_info.extent = {extent.width, extent.height, 1};
+		image_info.mipLevels = level_count;
+		image_info.arrayLayers = 1;
+		image_info.format = VK_FORMAT_R32_SFLOAT;
+		image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		image_info.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+		image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, image_memory);
+
+		VkImageViewCreateInfo view_info{};
+		view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		view_info.image = image;
+		view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		view_info.format = VK_FORMAT_R32_SFLOAT;
+		view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		view_info.subresourceRange.baseMipLevel = 0;
+		view_info.subresourceRange.levelCount = level_count;
+		view_info.subresourceRange.baseArrayLayer = 0;
+		view_info.subresourceRange.layerCount = 1;
+		if(vkCreateImageView(device.device(), &view_info, nullptr, &image_view) != VK_SUCCESS){
+			throw std::runtime_error("failed to create depth pyramid image view");
+		}
+		level_views.resize(level_count);
+		view_info.subresourceRange.levelCount = 1;
+		for(uint32_t level = 0; level < level_count; level++){
+			view_info.subresourceRange.baseMipLevel = level;
+			if(vkCreateImageView(device.device(), &view_info, nullptr, &level_views[level]) != VK_SUCCESS){
+				throw std::runtime_error("failed to create depth pyramid image view");
+			}
+		}
+
+		// into GENERAL once, ahead of the first frame that binds it
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = view_info.subresourceRange;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = level_count;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(device.uploadManager().graphics_commands(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	void DepthPyramid::create_sampler(){
+		// only read with texelFetch
+		VkSamplerCreateInfo sampler_info{};
+		sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		sampler_info.magFilter = VK_FILTER_NEAREST;
+		sampler_info.minFilter = VK_FILTER_NEAREST;
+		sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.compareOp = VK_COMPARE_OP_NEVER;
+		sampler_info.minLod = 0.f;
+		sampler_info.maxLod = static_cast<float>(level_count);
+		if(vkCreateSampler(device.device(), &sampler_info, nullptr, &sampler) != VK_SUCCESS){
+			throw std::runtime_error("failed to create depth pyramid sampler");
+		}
+	}
+
+	void DepthPyramid::create_descriptor_sets(SwapChain& swap_chain){
+		uint32_t set_count = static_cast<uint32_t>(swap_chain.imageCount()) + level_count - 1;
+		set_layout = DescriptorSetLayout::Builder(device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+			.build();
+		descriptor_pool = DescriptorPool::Builder(device)
+			.setMaxSets(set_count)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, set_count)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, set_count)
+			.build();
+
+		VkDescriptorImageInfo destination_info{VK_NULL_HANDLE, level_views[0], VK_IMAGE_LAYOUT_GENERAL};
+		depth_sets.resize(swap_chain.imageCount());
+		for(size_t i = 0; i < depth_sets.size(); i++){
+			VkDescriptorImageInfo source_info{sampler, swap_chain.getDepthImageView(static_cast<int>(i)), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+			if(!DescriptorWriter(*set_layout, *descriptor_pool).writeImage(0, &source_info).writeImage(1, &destination_info).build(depth_sets[i])){
+				throw std::runtime_error("failed to allocate depth pyramid descriptor set");
+			}
+		}
+		level_sets.resize(level_count);
+		for(uint32_t level = 1; level < level_count; level++){
+			VkDescriptorImageInfo source_info{sampler, level_views[level - 1], VK_IMAGE_LAYOUT_GENERAL};
+			VkDescriptorImageInfo level_info{VK_NULL_HANDLE, level_views[level], VK_IMAGE_LAYOUT_GENERAL};
+			if(!DescriptorWriter(*set_layout, *descriptor_pool).writeImage(0, &source_info).writeImage(1, &level_info).build(level_sets[level])){
+				throw std::runtime_error("failed to allocate depth pyramid descriptor set");
+			}
+		}
+	}
+
+	void DepthPyramid::create_pipeline(){
+		VkDescriptorSetLayout layout = set_layout->getDescriptorSetLayout();
+		VkPipelineLayoutCreateInfo pipeline_layout_info{};
+		pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_info.setLayoutCount = 1;
+		pipeline_layout_info.pSetLayouts = &layout;
+		if(vkCreatePipelineLayout(device.device(), &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS){
+			throw std::runtime_error("failed to create pipeline layout");
+		}
+		reduce_pipeline = std::make_unique<ComputePipeline>(device, "shaders/depth_reduce.comp.spv", pipeline_layout);
+	}
+
+	VkDescriptorImageInfo DepthPyramid::descriptor_info() const{
+		return {sampler, image_view, VK_IMAGE_LAYOUT_GENERAL};
+	}
+
+	void DepthPyramid::build(VkCommandBuffer command_buffer, uint32_t image_index, const glm::mat4& view_projection){
+		assert(image_index < depth_sets.size() && "no depth image with this index");
+		// culling earlier in the frame may still be reading the levels about to be overwritten
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		reduce_pipeline->bind(command_buffer);
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		for(uint32_t level = 0; level < level_count; level++){
+			VkDescriptorSet set = level == 0 ? depth_sets[image_index] : level_sets[level];
+			vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &set, 0, nullptr);
+			VkExtent2D extent = get_level_extent(level);
+			vkCmdDispatch(command_buffer, (extent.width + GROUP_SIZE - 1) / GROUP_SIZE, (extent.height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+			// the next level reads this one, the next frame's culling reads all of them
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+		this->view_projection = view_projection;
+		built = true;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "descriptors.hpp"
+#include "device.hpp"
+#include "pipeline.hpp"
+#include "swap_chain.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace blikaengine{
+
+	// Hierarchical depth buffer for occlusion culling. Every texel holds the farthest depth of the
+	// depth buffer pixels it covers: level 0 is half the depth buffer, each further level halves the
+	// one before, down to 1x1. Odd sizes fold the left over row / column into the last texel, so a texel
+	// t of level l always covers at least the pixels [t * 2^(l+1), (t+1) * 2^(l+1)) of the depth buffer.
+	// Built at the end of a frame and tested against in the next one, so it lags a frame behind.
+	// The image stays in VK_IMAGE_LAYOUT_GENERAL. Created along with the swap chain it reduces.
+	class DepthPyramid{
+		public:
+			DepthPyramid(Device& device, SwapChain& swap_chain);
+			~DepthPyramid();
+			DepthPyramid(const DepthPyramid&) = delete;
+			DepthPyramid& operator = (const DepthPyramid&) = delete;
+
+			// reduces the depth image of swap chain image image_index, recorded after the render pass that wrote it.
+			// view_projection is the one the depth was rendered with.
+			void build(VkCommandBuffer command_buffer, uint32_t image_index, const glm::mat4& view_projection);
+
+			// whole mip chain, for texelFetch in compute shaders
+			VkDescriptorImageInfo descriptor_info() const;
+			// nothing to test against before the first build
+			bool is_built() const{ return built; }
+			const glm::mat4& get_view_projection() const{ return view_projection; }
+			VkExtent2D get_depth_extent() const{ return depth_extent; }
+			uint32_t get_level_count() const{ return level_count; }
+
+		private:
+			static constexpr uint32_t GROUP_SIZE = 8;
+
+			void create_image();
+			void create_sampler();
+			void create_descriptor_sets(SwapChain& swap_chain);
+			void create_pipeline();
+			VkExtent2D get_level_extent(uint32_t level) const;
+
+			Device& device;
+			VkExtent2D depth_extent;
+			uint32_t level_count = 0;
+
+			VkImage image = VK_NULL_HANDLE;
+			Allocation image_memory{};
+			VkImageView image_view = VK_NULL_HANDLE;
+			std::vector<VkImageView> level_views{};
+			VkSampler sampler = VK_NULL_HANDLE;
+
+			std::unique_ptr<DescriptorSetLayout> set_layout{};
+			std::unique_ptr<DescriptorPool> descriptor_pool{};
+			// level 0 from each swap chain depth image
+			std::vector<VkDescriptorSet> depth_sets{};
+			// level i from level i - 1, index 0 unused
+			std::vector<VkDescriptorSet> level_sets{};
+			VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+			std::unique_ptr<ComputePipeline> reduce_pipeline{};
+
+			glm::mat4 view_projection{1.f};
+			bool built = false;
+	};
+}
@@ -1,4 +1,7 @@
 #include "device.hpp"
+#include "mesh_pool.hpp"
+#include "model.hpp"
+#include "upload_manager.hpp"
 
 #include <cstring>
 #include <iostream>
@@ -30,22 +33,35 @@ namespace blikaengine{
 	}
 
 	// class member functions
-	Device::Device(Window &window): window{window}{
+	Device::Device(Window &window, VkDeviceSize stagingSize, VertexFormat vertexFormat): window{window}, vertexFormat_{vertexFormat}{
+		if(window.is_headless()){
+			deviceExtensions.clear();
+		}
 		createInstance();
 		setupDebugMessenger();
 		createSurface();
 		pickPhysicalDevice();
 		createLogicalDevice();
 		createCommandPool();
+		allocator_ = std::make_unique<MemoryAllocator>(device_, physicalDevice);
+		uploadManager_ = std::make_unique<UploadManager>(*this, stagingSize);
+		const Model::VertexLayout layout = Model::get_vertex_layout(vertexFormat);
+		meshPool_ = std::make_unique<MeshPool>(*this, *uploadManager_, layout.size, layout.position_offset, layout.position_size);
 	}
 
 	Device::~Device() {
+		// pending uploads still hold staging memory
+		meshPool_.reset();
+		uploadManager_.reset();
+		allocator_.reset();
 		vkDestroyCommandPool(device_, commandPool, nullptr);
 		vkDestroyDevice(device_, nullptr);
 		if(enableValidationLayers){
 			DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 		}
-		vkDestroySurfaceKHR(instance, surface_, nullptr);
+		if(surface_ != VK_NULL_HANDLE){
+			vkDestroySurfaceKHR(instance, surface_, nullptr);
+		}
 		vkDestroyInstance(instance, nullptr);
 	}
 
@@ -115,9 +131,12 @@ namespace blikaengine{
 
 	void Device::createLogicalDevice(){
 		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+		queueFamilies_ = indices;
+		sharedQueueFamilies_[0] = indices.graphicsFamily;
+		sharedQueueFamilies_[1] = indices.transferFamily;
 
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-		std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+		std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily, indices.transferFamily};
 
 		float queuePriority = 1.0f;
 		for(uint32_t queueFamily : uniqueQueueFamilies){
@@ -129,11 +148,30 @@ namespace blikaengine{
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
+		VkPhysicalDeviceVulkan12Features supported12 = {};
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 supported = {};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+		optionalFeatures_.multiDrawIndirect = supported.features.multiDrawIndirect;
+		optionalFeatures_.drawIndirectFirstInstance = supported.features.drawIndirectFirstInstance;
+		optionalFeatures_.drawIndirectCount = supported12.drawIndirectCount;
+
 		VkPhysicalDeviceFeatures deviceFeatures = {};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.multiDrawIndirect = optionalFeatures_.multiDrawIndirect;
+		deviceFeatures.drawIndirectFirstInstance = optionalFeatures_.drawIndirectFirstInstance;
+
+		// upload completion is tracked with a timeline semaphore
+		VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vulkan12Features.timelineSemaphore = VK_TRUE;
+		vulkan12Features.drawIndirectCount = optionalFeatures_.drawIndirectCount;
 
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &vulkan12Features;
 
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -157,6 +195,7 @@ namespace blikaengine{
 
 		vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
 		vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+		vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
 	}
 
 	void Device::createCommandPool() {
@@ -170,19 +209,38 @@ namespace blikaengine{
 		}
 	}
 
-	void Device::createSurface() { window.create_window_surface(instance, &surface_); }
+	void Device::createSurface(){
+		if(window.is_headless()){
+			return;
+		}
+		window.create_window_surface(instance, &surface_);
+	}
 
 	bool Device::isDeviceSuitable(VkPhysicalDevice device) {
 		QueueFamilyIndices indices = findQueueFamilies(device);
 		bool extensionsSupported = checkDeviceExtensionSupport(device);
-		bool swapChainAdequate = false;
-		if(extensionsSupported){
+		bool swapChainAdequate = window.is_headless();
+		if(extensionsSupported && !window.is_headless()){
 			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 			swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 		}
-		VkPhysicalDeviceFeatures supportedFeatures;
-		vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
-		return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+		VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 supportedFeatures = {};
+		supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures.pNext = &vulkan12Features;
+		vkGetPhysicalDeviceFeatures2(device, &supportedFeatures);
+		return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.features.samplerAnisotropy && vulkan12Features.timelineSemaphore;
+	}
+
+	// resources written by the transfer queue and read by the graphics queue are shared concurrently,
+	// which spares the queue family ownership transfer barriers on both sides
+	void Device::setSharingMode(VkSharingMode &sharingMode, uint32_t &queueFamilyIndexCount, const uint32_t *&queueFamilyIndices, bool transferDst){
+		if(transferDst && queueFamilies_.hasDedicatedTransfer()){
+			sharingMode = VK_SHARING_MODE_CONCURRENT;
+			queueFamilyIndexCount = 2;
+			queueFamilyIndices = sharedQueueFamilies_;
+		}
 	}
 
 	void Device::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo) {
@@ -227,10 +285,13 @@ namespace blikaengine{
 	}
 
 	std::vector<const char *> Device::getRequiredExtensions(){
-		uint32_t glfwExtensionCount = 0;
-		const char **glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-		std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		std::vector<const char *> extensions;
+		if(!window.is_headless()){
+			uint32_t glfwExtensionCount = 0;
+			const char **glfwExtensions;
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 		if(enableValidationLayers){
 			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 		}
@@ -276,23 +337,35 @@ namespace blikaengine{
 		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
 		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
 		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+		bool transferFamilyHasValue = false;
 		int i = 0;
 		for(const auto &queueFamily : queueFamilies){
-			if(queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT){
+			// culling and the depth pyramid run as compute on the graphics queue
+			if(queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT && queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT && !indices.isComplete()){
 				indices.graphicsFamily = i;
 				indices.graphicsFamilyHasValue = true;
 			}
 			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
-			if(queueFamily.queueCount > 0 && presentSupport){
+			if(window.is_headless()){
+				// nothing is presented, the graphics queue doubles as the "present" queue
+				presentSupport = indices.graphicsFamilyHasValue && indices.graphicsFamily == static_cast<uint32_t>(i);
+			}else{
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+			}
+			if(queueFamily.queueCount > 0 && presentSupport && !indices.isComplete()){
 				indices.presentFamily = i;
 				indices.presentFamilyHasValue = true;
 			}
-			if(indices.isComplete()){
-				break;
+			// the dma engines show up as families with transfer but neither graphics nor compute
+			if(queueFamily.queueCount > 0 && !transferFamilyHasValue && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))){
+				indices.transferFamily = i;
+				transferFamilyHasValue = true;
 			}
 			i++;
 		}
+		if(!transferFamilyHasValue){
+			indices.transferFamily = indices.graphicsFamily;
+		}
 		return indices;
 	}
 
@@ -339,13 +412,14 @@ namespace blikaengine{
 		throw std::runtime_error("failed to find suitable memory type!");
 	}
 
-	void Device::createBuffer(VkDeviceSize size,VkBufferUsageFlags usage,VkMemoryPropertyFlags properties,VkBuffer &buffer,VkDeviceMemory &bufferMemory){
+	void Device::createBuffer(VkDeviceSize size,VkBufferUsageFlags usage,VkMemoryPropertyFlags properties,VkBuffer &buffer,Allocation &bufferMemory,AllocationStrategy strategy){
 		VkBufferCreateInfo bufferInfo{};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		bufferInfo.size = size;
 		bufferInfo.usage = usage;
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		
+		setSharingMode(bufferInfo.sharingMode, bufferInfo.queueFamilyIndexCount, bufferInfo.pQueueFamilyIndices, usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
 		if(vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS){
 			throw std::runtime_error("failed to create vertex buffer!");
 		}
@@ -353,16 +427,11 @@ namespace blikaengine{
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		bufferMemory = allocator_->allocate(memRequirements, properties, MemoryAllocator::ResourceKind::BUFFER, strategy);
 
-		if(vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS){
-			throw std::runtime_error("failed to allocate vertex buffer memory!");
+		if(vkBindBufferMemory(device_, buffer, bufferMemory.memory, bufferMemory.offset) != VK_SUCCESS){
+			throw std::runtime_error("failed to bind buffer memory!");
 		}
-
-		vkBindBufferMemory(device_, buffer, bufferMemory, 0);
 	}
 
 	VkCommandBuffer Device::beginSingleTimeCommands(){
@@ -430,7 +499,9 @@ namespace blikaengine{
 		  endSingleTimeCommands(commandBuffer);
 	}
 
-	void Device::createImageWithInfo(const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory){
+	void Device::createImageWithInfo(const VkImageCreateInfo &createInfo, VkMemoryPropertyFlags properties, VkImage &image, Allocation &imageMemory){
+		  VkImageCreateInfo imageInfo = createInfo;
+		  setSharingMode(imageInfo.sharingMode, imageInfo.queueFamilyIndexCount, imageInfo.pQueueFamilyIndices, imageInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
 		  if(vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS){
 				throw std::runtime_error("failed to create image!");
 		  }
@@ -438,16 +509,11 @@ namespace blikaengine{
 		  VkMemoryRequirements memRequirements;
 		  vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-		  VkMemoryAllocateInfo allocInfo{};
-		  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		  allocInfo.allocationSize = memRequirements.size;
-		  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-		  if(vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS){
-				throw std::runtime_error("failed to allocate image memory!");
-		  }
+		  // linear tiling images are laid out like buffers and may share their blocks
+		  auto kind = imageInfo.tiling == VK_IMAGE_TILING_LINEAR ? MemoryAllocator::ResourceKind::BUFFER : MemoryAllocator::ResourceKind::IMAGE;
+		  imageMemory = allocator_->allocate(memRequirements, properties, kind);
 
-		  if(vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS){
+		  if(vkBindImageMemory(device_, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS){
 				throw std::runtime_error("failed to bind image memory!");
 		  }
 	}
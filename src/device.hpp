@@ -1,7 +1,10 @@
 #pragma once
 
+#include "memory_allocator.hpp"
+#include "vertex_format.hpp"
 #include "window.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -16,11 +19,24 @@ namespace blikaengine{
 	struct QueueFamilyIndices{
 		uint32_t graphicsFamily;
 		uint32_t presentFamily;
+		// a transfer only family if the device has one, the graphics family otherwise
+		uint32_t transferFamily;
 		bool graphicsFamilyHasValue = false;
 		bool presentFamilyHasValue = false;
 		bool isComplete(){ return graphicsFamilyHasValue && presentFamilyHasValue; }
+		bool hasDedicatedTransfer(){ return transferFamily != graphicsFamily; }
 	};
 
+	// features used when present, with a fallback otherwise
+	struct OptionalFeatures{
+		bool multiDrawIndirect = false;
+		bool drawIndirectFirstInstance = false;
+		bool drawIndirectCount = false;
+	};
+
+	class UploadManager;
+	class MeshPool;
+
 	class Device{
 		public:
 				#ifdef NDEBUG
@@ -29,7 +45,9 @@ namespace blikaengine{
 				const bool enableValidationLayers = true;
 				#endif
 
-				Device(Window &window);
+				static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 32ull * 1024 * 1024;
+
+				Device(Window &window, VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE, VertexFormat vertexFormat = VertexFormat::Full);
 				~Device();
 
 				// Not copyable or movable
@@ -43,6 +61,15 @@ namespace blikaengine{
 				VkSurfaceKHR surface() { return surface_; }
 				VkQueue graphicsQueue() { return graphicsQueue_; }
 				VkQueue presentQueue() { return presentQueue_; }
+				VkQueue transferQueue() { return transferQueue_; }
+				QueueFamilyIndices queueFamilies() { return queueFamilies_; }
+				bool isHeadless() { return window.is_headless(); }
+				MemoryAllocator& memoryAllocator() { return *allocator_; }
+				UploadManager& uploadManager() { return *uploadManager_; }
+				MeshPool& meshPool() { return *meshPool_; }
+				// layout of every vertex in meshPool()
+				VertexFormat vertexFormat() const { return vertexFormat_; }
+				const OptionalFeatures& optionalFeatures() { return optionalFeatures_; }
 
 				SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
 				uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -57,7 +84,8 @@ namespace blikaengine{
 					VkBufferUsageFlags usage,
 					VkMemoryPropertyFlags properties,
 					VkBuffer &buffer,
-					VkDeviceMemory &bufferMemory);
+					Allocation &bufferMemory,
+					AllocationStrategy strategy = AllocationStrategy::FREE_LIST);
 					VkCommandBuffer beginSingleTimeCommands();
 					void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 					void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -68,7 +96,8 @@ namespace blikaengine{
 					  const VkImageCreateInfo &imageInfo,
 					  VkMemoryPropertyFlags properties,
 					  VkImage &image,
-					  VkDeviceMemory &imageMemory);
+					  Allocation &imageMemory);
+				void freeMemory(Allocation &allocation) { allocator_->free(allocation); }
 
 				VkPhysicalDeviceProperties properties;
 
@@ -82,6 +111,7 @@ namespace blikaengine{
 
 				// helper functions
 				bool isDeviceSuitable(VkPhysicalDevice device);
+				void setSharingMode(VkSharingMode &sharingMode, uint32_t &queueFamilyIndexCount, const uint32_t *&queueFamilyIndices, bool transferDst);
 				std::vector<const char *> getRequiredExtensions();
 				bool checkValidationLayerSupport();
 				QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
@@ -97,11 +127,20 @@ namespace blikaengine{
 				VkCommandPool commandPool;
 
 				VkDevice device_;
-				VkSurfaceKHR surface_;
+				std::unique_ptr<MemoryAllocator> allocator_;
+				std::unique_ptr<UploadManager> uploadManager_;
+				std::unique_ptr<MeshPool> meshPool_;
+				VertexFormat vertexFormat_;
+				OptionalFeatures optionalFeatures_;
+				VkSurfaceKHR surface_ = VK_NULL_HANDLE;
 				VkQueue graphicsQueue_;
 				VkQueue presentQueue_;
+				VkQueue transferQueue_;
+				QueueFamilyIndices queueFamilies_;
+				uint32_t sharedQueueFamilies_[2];
 
 				const std::vector<const char*> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-				const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+				// cleared for headless devices, which never present
+				std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 	};
 }
\ No newline at end of file
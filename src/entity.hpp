@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace blikaengine{
+
+	// Stable handle to an entity. The generation changes when the index is reused, so handles to
+	// destroyed entities never alias new ones.
+	struct Entity{
+		static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+		uint32_t index = INVALID_INDEX;
+		uint32_t generation = 0;
+
+		bool valid() const{ return index != INVALID_INDEX; }
+		bool operator==(const Entity& other) const{ return index == other.index && generation == other.generation; }
+		bool operator!=(const Entity& other) const{ return !(*this == other); }
+	};
+}
@@ -1,16 +1,18 @@
 #pragma once
 
 #include "camera.hpp"
-#include "game_object.hpp"
+#include "depth_pyramid.hpp"
+#include "scene.hpp"
 
 #include <vulkan/vulkan.h>
 
 namespace blikaengine{
 	
-	#define MAX_LIGHTS 10
-
+	// element of the light storage buffer (std430)
 	struct PointLight{
+		// xyz world position, w range
 		glm::vec4 position{};
+		// rgb color, w intensity
 		glm::vec4 color{};
 	};
 
@@ -20,8 +22,10 @@ namespace blikaengine{
 		glm::mat4 view{1.f};
 		glm::mat4 inverse_view{1.f};
 		glm::vec4 ambient_light_color{1.f,1.f,1.f,0.02f};
-		PointLight point_lights[MAX_LIGHTS];
-		int lights;
+		// light clusters: grid size x, y, z and the light count
+		glm::uvec4 cluster_grid{};
+		// tile width, tile height in pixels, depth slice scale and bias (see LightClusters)
+		glm::vec4 cluster_params{};
 	};
 	
 	struct FrameInfo{
@@ -30,7 +34,13 @@ namespace blikaengine{
 		VkCommandBuffer command_buffer;
 		Camera& camera;
 		VkDescriptorSet global_descriptor_set;
-		GameObject::Map& game_objects;
+		// lights and their clusters, written by PointLightSystem::write_lights()
+		VkDescriptorSet light_descriptor_set;
+		// point light shadows, written by ShadowSystem::update()
+		VkDescriptorSet shadow_descriptor_set;
+		Scene& scene;
+		// built from the previous frame's depth
+		DepthPyramid& depth_pyramid;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "frustum.hpp"
+
+namespace blikaengine{
+
+	Frustum::Frustum(const glm::mat4& view_projection){
+		// Gribb / Hartmann: rows of the clip matrix, glm stores columns
+		glm::vec4 rows[4];
+		for(int i = 0; i < 4; i++){
+			rows[i] = {view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]};
+		}
+		planes[0] = rows[3] + rows[0];
+		planes[1] = rows[3] - rows[0];
+		planes[2] = rows[3] + rows[1];
+		planes[3] = rows[3] - rows[1];
+		// clip space depth is 0..w
+		planes[4] = rows[2];
+		planes[5] = rows[3] - rows[2];
+		for(auto& plane : planes){
+			plane /= glm::length(glm::vec3(plane));
+		}
+	}
+
+	bool Frustum::intersects(const BoundingSphere& sphere) const{
+		for(const auto& plane : planes){
+			if(glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Frustum::intersects(const AABB& box) const{
+		const glm::vec3 center = box.center();
+		const glm::vec3 extent = box.extent();
+		for(const auto& plane : planes){
+			const glm::vec3 normal{plane};
+			if(glm::dot(normal, center) + plane.w < -glm::dot(glm::abs(normal), extent)){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Frustum::contains(const AABB& box) const{
+		const glm::vec3 center = box.center();
+		const glm::vec3 extent = box.extent();
+		for(const auto& plane : planes){
+			const glm::vec3 normal{plane};
+			if(glm::dot(normal, center) + plane.w < glm::dot(glm::abs(normal), extent)){
+				return false;
+			}
+		}
+		return true;
+	}
+}
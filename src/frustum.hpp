@@ -0,0 +1,28 @@
+#pragma once
+
+#include "bounds.hpp"
+
+#include <array>
+#include <cstddef>
+
+namespace blikaengine{
+
+	// Six inward facing planes (xyz normal, w distance), so a point p is inside when dot(plane.xyz, p) + plane.w >= 0
+	// for every plane. Extracted from a projection * view matrix with zero to one depth.
+	class Frustum{
+		public:
+			Frustum() = default;
+			explicit Frustum(const glm::mat4& view_projection);
+
+			bool intersects(const BoundingSphere& sphere) const;
+			bool intersects(const AABB& box) const;
+			// box entirely inside, nothing below it needs testing
+			bool contains(const AABB& box) const;
+
+			const glm::vec4& get_plane(size_t index) const{ return planes[index]; }
+
+		private:
+			// left, right, bottom, top, near, far
+			std::array<glm::vec4, 6> planes{};
+	};
+}
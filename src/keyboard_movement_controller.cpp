@@ -3,19 +3,21 @@
 #include <limits>
 
 namespace blikaengine{
-	void KeyboardMovementController::move_in_plane_XZ(GLFWwindow* window, float dt, GameObject& game_object){
+	void KeyboardMovementController::move_in_plane_XZ(GLFWwindow* window, float dt, TransformComponent& transform){
 		glm::vec3 rotate{0};
 		if(glfwGetKey(window, keys.look_right) == GLFW_PRESS) rotate.y += 1.f;
 		if(glfwGetKey(window, keys.look_left) == GLFW_PRESS) rotate.y -= 1.f;
 		if(glfwGetKey(window, keys.look_up) == GLFW_PRESS) rotate.x += 1.f;
 		if(glfwGetKey(window, keys.look_down) == GLFW_PRESS) rotate.x -= 1.f;
+		glm::vec3 rotation = transform.get_rotation();
 		if(glm::dot(rotate,rotate) > std::numeric_limits<float>::epsilon()){
-			game_object.transform.rotation += look_speed * dt * glm::normalize(rotate);
+			rotation += look_speed * dt * glm::normalize(rotate);
 		}
 		//TODO
-		//game_object.transform.rotation.x = glm::clamp(game_object.transform.rotation.x, -1.5f, 1.5f);
-		game_object.transform.rotation.y = glm::mod(game_object.transform.rotation.y , glm::two_pi<float>());
-		float yaw = game_object.transform.rotation.y;
+		//rotation.x = glm::clamp(rotation.x, -1.5f, 1.5f);
+		rotation.y = glm::mod(rotation.y , glm::two_pi<float>());
+		transform.set_rotation(rotation);
+		float yaw = rotation.y;
 		const glm::vec3 forward_dir{sin(yaw), 0.f, cos(yaw)};
 		const glm::vec3 right_dir{forward_dir.z, 0.f, -forward_dir.x};
 		const glm::vec3 up_dir{0.f, -1.f, 0.f};
@@ -28,7 +30,7 @@ namespace blikaengine{
 		if(glfwGetKey(window, keys.move_up) == GLFW_PRESS) move_dir += up_dir;
 		if(glfwGetKey(window, keys.move_down) == GLFW_PRESS) move_dir -= up_dir;
 		if(glm::dot(move_dir,move_dir) > std::numeric_limits<float>::epsilon()){
-			game_object.transform.translation += move_speed * dt * glm::normalize(move_dir);
+			transform.set_translation(transform.get_translation() + move_speed * dt * glm::normalize(move_dir));
 		}
 	}
 }
\ No newline at end of file
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "game_object.hpp"
+#include "components.hpp"
 #include "window.hpp"
 
 namespace blikaengine{
@@ -19,7 +19,7 @@ namespace blikaengine{
 				int look_down = GLFW_KEY_DOWN;
 			};
 
-			void move_in_plane_XZ(GLFWwindow* window, float dt, GameObject& game_object);
+			void move_in_plane_XZ(GLFWwindow* window, float dt, TransformComponent& transform);
 
 
 			KeyMappings keys{};
@@ -0,0 +1,105 @@
+#include "light_clusters.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace blikaengine{
+
+	namespace{
+		// tiles along one axis covered by the view space interval [low, high] seen at depths [z_near, z_far].
+		// scale is the projection's x or y scale, false if the interval is entirely off screen.
+		bool tile_range(float low, float high, float z_near, float z_far, float scale, uint32_t tiles, uint32_t& first, uint32_t& last){
+			float ndc_low = scale * (low < 0.f ? low / z_near : low / z_far);
+			float ndc_high = scale * (high > 0.f ? high / z_near : high / z_far);
+			if(ndc_high < -1.f || ndc_low > 1.f){
+				return false;
+			}
+			auto tile = [&](float ndc){
+				return static_cast<uint32_t>(std::clamp((ndc * .5f + .5f) * tiles, 0.f, static_cast<float>(tiles - 1)));
+			};
+			first = tile(ndc_low);
+			last = tile(ndc_high);
+			return true;
+		}
+
+		// view space interval covered by tile of tiles at depths [z_near, z_far]
+		void tile_bounds(uint32_t tile, uint32_t tiles, float z_near, float z_far, float scale, float& low, float& high){
+			float ndc_low = 2.f * tile / tiles - 1.f;
+			float ndc_high = 2.f * (tile + 1) / tiles - 1.f;
+			low = std::min(ndc_low * z_near, ndc_low * z_far) / scale;
+			high = std::max(ndc_high * z_near, ndc_high * z_far) / scale;
+		}
+	}
+
+	uint32_t LightClusters::slice_of(float depth) const{
+		return static_cast<uint32_t>(std::clamp(std::log(depth) * slice_scale + slice_bias, 0.f, static_cast<float>(GRID_Z - 1)));
+	}
+
+	float LightClusters::slice_depth(uint32_t slice) const{
+		return near_plane * std::pow(far_plane / near_plane, static_cast<float>(slice) / GRID_Z);
+	}
+
+	void LightClusters::build(const glm::mat4& view, const glm::mat4& projection, float near, float far, const std::vector<glm::vec4>& lights){
+		assert(near > 0.f && far > near && "light clusters need a perspective depth range");
+		near_plane = near;
+		far_plane = far;
+		slice_scale = GRID_Z / std::log(far / near);
+		slice_bias = -std::log(near) * slice_scale;
+		const float x_scale = projection[0][0];
+		const float y_scale = projection[1][1];
+
+		assignments.clear();
+		for(uint32_t light = 0; light < lights.size(); light++){
+			glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(lights[light]), 1.f));
+			float radius = lights[light].w;
+			float z_min = std::max(center.z - radius, near);
+			float z_max = std::min(center.z + radius, far);
+			if(z_min >= z_max){
+				continue;
+			}
+			for(uint32_t z = slice_of(z_min), last_z = slice_of(z_max); z <= last_z; z++){
+				// the light's view box, cut to this slice, decides the tiles to test
+				float slice_near = slice_depth(z);
+				float slice_far = slice_depth(z + 1);
+				uint32_t first_x, last_x, first_y, last_y;
+				if(!tile_range(center.x - radius, center.x + radius, std::max(slice_near, z_min), std::min(slice_far, z_max), x_scale, GRID_X, first_x, last_x)
+					|| !tile_range(center.y - radius, center.y + radius, std::max(slice_near, z_min), std::min(slice_far, z_max), y_scale, GRID_Y, first_y, last_y)){
+					continue;
+				}
+				float dz = std::max({slice_near - center.z, 0.f, center.z - slice_far});
+				for(uint32_t y = first_y; y <= last_y; y++){
+					float y_low, y_high;
+					tile_bounds(y, GRID_Y, slice_near, slice_far, y_scale, y_low, y_high);
+					float dy = std::max({y_low - center.y, 0.f, center.y - y_high});
+					for(uint32_t x = first_x; x <= last_x; x++){
+						float x_low, x_high;
+						tile_bounds(x, GRID_X, slice_near, slice_far, x_scale, x_low, x_high);
+						float dx = std::max({x_low - center.x, 0.f, center.x - x_high});
+						// sphere against the cluster's view space box
+						if(dx * dx + dy * dy + dz * dz <= radius * radius){
+							assignments.push_back({cluster_index(x, y, z), light});
+						}
+					}
+				}
+			}
+		}
+
+		// counting sort by cluster
+		ranges.assign(CLUSTER_COUNT, Range{});
+		for(const auto& assignment : assignments){
+			ranges[assignment.first].count++;
+		}
+		uint32_t offset = 0;
+		for(auto& range : ranges){
+			range.offset = offset;
+			offset += range.count;
+			range.count = 0;
+		}
+		indices.resize(assignments.size());
+		for(const auto& assignment : assignments){
+			Range& range = ranges[assignment.first];
+			indices[range.offset + range.count++] = assignment.second;
+		}
+	}
+}
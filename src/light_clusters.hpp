@@ -0,0 +1,59 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace blikaengine{
+
+	// Assigns point lights to a grid of view space clusters (froxels): GRID_X x GRID_Y screen tiles, each
+	// cut into GRID_Z depth slices that grow exponentially from the near to the far plane. A fragment only
+	// has to shade the lights of the one cluster it falls into, so the cost per pixel depends on how many
+	// lights overlap it rather than on how many there are. Built on the cpu every frame.
+	class LightClusters{
+		public:
+			static constexpr uint32_t GRID_X = 16;
+			static constexpr uint32_t GRID_Y = 9;
+			static constexpr uint32_t GRID_Z = 24;
+			static constexpr uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+			// lights of a cluster, matches the uvec2 read by master_shader.frag
+			struct Range{
+				uint32_t offset = 0;
+				uint32_t count = 0;
+			};
+
+			// lights are world space spheres (xyz center, w range). Expects a perspective projection
+			// as set by Camera::set_perspective_projection().
+			void build(const glm::mat4& view, const glm::mat4& projection, float near, float far, const std::vector<glm::vec4>& lights);
+
+			// indexed by cluster_index()
+			const std::vector<Range>& get_ranges() const{ return ranges; }
+			// light indices, every cluster's are contiguous
+			const std::vector<uint32_t>& get_indices() const{ return indices; }
+			// slice of view depth z is floor(log(z) * scale + bias)
+			float get_slice_scale() const{ return slice_scale; }
+			float get_slice_bias() const{ return slice_bias; }
+
+			static uint32_t cluster_index(uint32_t x, uint32_t y, uint32_t z){
+				return (z * GRID_Y + y) * GRID_X + x;
+			}
+
+		private:
+			uint32_t slice_of(float depth) const;
+			float slice_depth(uint32_t slice) const;
+
+			float near_plane = 0.f;
+			float far_plane = 1.f;
+			float slice_scale = 0.f;
+			float slice_bias = 0.f;
+			std::vector<Range> ranges{};
+			std::vector<uint32_t> indices{};
+			// (cluster, light) pairs, sorted into indices by cluster
+			std::vector<std::pair<uint32_t, uint32_t>> assignments{};
+	};
+}
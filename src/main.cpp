@@ -1,12 +1,42 @@
 #include "blikaengine.hpp"
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
-int main(){
-	blikaengine::BlikaEngine be{};
+static blikaengine::EngineConfig parse_args(int argc, char* argv[]){
+	blikaengine::EngineConfig config{};
+	for(int i = 1; i < argc; i++){
+		if(std::strcmp(argv[i], "--headless") == 0){
+			config.headless = true;
+		}else if(std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc){
+			config.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}else if(std::strcmp(argv[i], "--staging-mb") == 0 && i + 1 < argc){
+			config.staging_mb = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}else if(std::strcmp(argv[i], "--depth-prepass") == 0){
+			config.depth_prepass = true;
+		}else if(std::strcmp(argv[i], "--vertex-format") == 0 && i + 1 < argc){
+			config.vertex_format = blikaengine::parse_vertex_format(argv[++i]);
+		}else if(std::strcmp(argv[i], "--benchmark") == 0){
+			config.benchmark = true;
+		}else if(std::strcmp(argv[i], "--objects") == 0 && i + 1 < argc){
+			config.benchmark_objects = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}else if(std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc){
+			config.benchmark_lights = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}else if(std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc){
+			config.benchmark_warmup = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}else{
+			throw std::runtime_error(std::string("unknown argument: ") + argv[i]);
+		}
+	}
+	return config;
+}
+
+int main(int argc, char* argv[]){
 	try{
+		blikaengine::BlikaEngine be{parse_args(argc, argv)};
 		be.run();
 	}catch(const std::exception& e){
 		std::cerr << e.what() << '\n';
@@ -15,4 +45,4 @@ int main(){
 	}
 		//system("pause");
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,338 @@
+#include "memory_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <stdexcept>
+
+namespace blikaengine{
+
+	static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment){
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	static VkDeviceSize align_down(VkDeviceSize value, VkDeviceSize alignment){
+		return value / alignment * alignment;
+	}
+
+	// *************** Range Allocator *********************
+
+	RangeAllocator::RangeAllocator(VkDeviceSize size, AllocationStrategy strategy): size{size}, strategy{strategy}{
+		if(strategy == AllocationStrategy::FREE_LIST && size > 0){
+			free_ranges[0] = size;
+		}
+	}
+
+	VkDeviceSize RangeAllocator::allocate(VkDeviceSize alloc_size, VkDeviceSize alignment){
+		assert(alloc_size > 0 && "cannot allocate an empty range");
+		alignment = std::max<VkDeviceSize>(alignment, 1);
+		if(strategy == AllocationStrategy::LINEAR){
+			VkDeviceSize offset = align_up(head, alignment);
+			if(offset + alloc_size > size){
+				return INVALID_OFFSET;
+			}
+			head = offset + alloc_size;
+			used += alloc_size;
+			allocation_count++;
+			return offset;
+		}
+
+		// best fit: the smallest free range that still fits once aligned
+		auto best = free_ranges.end();
+		for(auto it = free_ranges.begin(); it != free_ranges.end(); ++it){
+			VkDeviceSize aligned = align_up(it->first, alignment);
+			if(aligned + alloc_size > it->first + it->second){
+				continue;
+			}
+			if(best == free_ranges.end() || it->second < best->second){
+				best = it;
+				if(best->second == alloc_size) break;
+			}
+		}
+		if(best == free_ranges.end()){
+			return INVALID_OFFSET;
+		}
+
+		VkDeviceSize range_offset = best->first;
+		VkDeviceSize range_end = best->first + best->second;
+		VkDeviceSize offset = align_up(range_offset, alignment);
+		free_ranges.erase(best);
+		if(offset > range_offset){
+			free_ranges[range_offset] = offset - range_offset;
+		}
+		if(offset + alloc_size < range_end){
+			free_ranges[offset + alloc_size] = range_end - (offset + alloc_size);
+		}
+		used += alloc_size;
+		allocation_count++;
+		return offset;
+	}
+
+	void RangeAllocator::free(VkDeviceSize offset, VkDeviceSize free_size){
+		assert(allocation_count > 0 && "free called on an empty range allocator");
+		used -= free_size;
+		allocation_count--;
+		if(strategy == AllocationStrategy::LINEAR){
+			if(allocation_count == 0){
+				head = 0;
+			}
+			return;
+		}
+
+		auto next = free_ranges.lower_bound(offset);
+		assert((next == free_ranges.end() || next->first >= offset + free_size) && "range freed twice");
+		if(next != free_ranges.end() && next->first == offset + free_size){
+			free_size += next->second;
+			next = free_ranges.erase(next);
+		}
+		if(next != free_ranges.begin()){
+			auto prev = std::prev(next);
+			if(prev->first + prev->second == offset){
+				prev->second += free_size;
+				return;
+			}
+		}
+		free_ranges[offset] = free_size;
+	}
+
+	void RangeAllocator::grow(VkDeviceSize new_size){
+		assert(new_size >= size && "range allocators cannot shrink");
+		if(new_size == size){
+			return;
+		}
+		if(strategy == AllocationStrategy::FREE_LIST){
+			auto last = free_ranges.empty() ? free_ranges.end() : std::prev(free_ranges.end());
+			if(last != free_ranges.end() && last->first + last->second == size){
+				last->second += new_size - size;
+			}else{
+				free_ranges[size] = new_size - size;
+			}
+		}
+		size = new_size;
+	}
+
+	VkDeviceSize RangeAllocator::largest_free_range() const{
+		if(strategy == AllocationStrategy::LINEAR){
+			return size - head;
+		}
+		VkDeviceSize largest = 0;
+		for(const auto& kv : free_ranges){
+			largest = std::max(largest, kv.second);
+		}
+		return largest;
+	}
+
+	size_t RangeAllocator::free_range_count() const{
+		if(strategy == AllocationStrategy::LINEAR){
+			return head < size ? 1 : 0;
+		}
+		return free_ranges.size();
+	}
+
+	// *************** Memory Allocator *********************
+
+	struct MemoryBlock{
+		MemoryBlock(VkDeviceSize size, AllocationStrategy strategy): ranges{size, strategy}{}
+
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		uint32_t memory_type = 0;
+		MemoryAllocator::ResourceKind kind = MemoryAllocator::ResourceKind::BUFFER;
+		// sized for a single resource and released as soon as it is freed
+		bool dedicated = false;
+		void* mapped = nullptr;
+		RangeAllocator ranges;
+	};
+
+	MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize block_size): device{device}, block_size{block_size}{
+		vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physical_device, &properties);
+		non_coherent_atom_size = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+	}
+
+	MemoryAllocator::~MemoryAllocator(){
+		for(auto& type_pools : pools){
+			for(auto& pool : type_pools){
+				for(auto& block : pool){
+					if(block->mapped){
+						vkUnmapMemory(device, block->memory);
+					}
+					vkFreeMemory(device, block->memory, nullptr);
+				}
+				pool.clear();
+			}
+		}
+	}
+
+	uint32_t MemoryAllocator::find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties) const{
+		for(uint32_t i = 0; i < memory_properties.memoryTypeCount; i++){
+			if((type_filter & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties){
+				return i;
+			}
+		}
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	std::unique_ptr<MemoryBlock> MemoryAllocator::create_block(uint32_t memory_type, ResourceKind kind, VkDeviceSize size, AllocationStrategy strategy, bool dedicated){
+		VkMemoryAllocateInfo alloc_info{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		alloc_info.allocationSize = size;
+		alloc_info.memoryTypeIndex = memory_type;
+
+		VkDeviceMemory memory;
+		if(vkAllocateMemory(device, &alloc_info, nullptr, &memory) != VK_SUCCESS){
+			return nullptr;
+		}
+
+		auto block = std::make_unique<MemoryBlock>(size, strategy);
+		block->memory = memory;
+		block->memory_type = memory_type;
+		block->kind = kind;
+		block->dedicated = dedicated;
+		if(memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT){
+			if(vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS){
+				vkFreeMemory(device, memory, nullptr);
+				throw std::runtime_error("failed to map device memory block!");
+			}
+		}
+		return block;
+	}
+
+	void MemoryAllocator::destroy_block(MemoryBlock* block){
+		auto& pool = pools[block->memory_type][static_cast<int>(block->kind)];
+		auto it = std::find_if(pool.begin(), pool.end(), [block](const std::unique_ptr<MemoryBlock>& b){ return b.get() == block; });
+		assert(it != pool.end() && "memory block does not belong to this allocator");
+		if(block->mapped){
+			vkUnmapMemory(device, block->memory);
+		}
+		vkFreeMemory(device, block->memory, nullptr);
+		pool.erase(it);
+	}
+
+	Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind, AllocationStrategy strategy){
+		uint32_t memory_type = find_memory_type(requirements.memoryTypeBits, properties);
+		VkDeviceSize alignment = requirements.alignment;
+		VkDeviceSize size = requirements.size;
+		if(memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT){
+			// keeps every flush/invalidate range of an allocation inside that allocation
+			alignment = std::max(alignment, non_coherent_atom_size);
+			size = align_up(size, non_coherent_atom_size);
+		}
+
+		std::lock_guard<std::mutex> lock{mutex};
+		auto& pool = pools[memory_type][static_cast<int>(kind)];
+
+		MemoryBlock* block = nullptr;
+		VkDeviceSize offset = RangeAllocator::INVALID_OFFSET;
+		// anything bigger than half a block gets its own VkDeviceMemory
+		if(size <= block_size / 2){
+			for(auto& candidate : pool){
+				if(candidate->dedicated || candidate->ranges.get_strategy() != strategy) continue;
+				offset = candidate->ranges.allocate(size, alignment);
+				if(offset != RangeAllocator::INVALID_OFFSET){
+					block = candidate.get();
+					break;
+				}
+			}
+			if(block == nullptr){
+				if(auto new_block = create_block(memory_type, kind, block_size, strategy, false)){
+					block = new_block.get();
+					pool.push_back(std::move(new_block));
+				}
+			}
+		}
+		if(block == nullptr){
+			// too big to share a block, or the heap is too full for another full size block
+			auto new_block = create_block(memory_type, kind, size, AllocationStrategy::FREE_LIST, true);
+			if(new_block == nullptr){
+				throw std::runtime_error("failed to allocate device memory!");
+			}
+			block = new_block.get();
+			pool.push_back(std::move(new_block));
+		}
+		if(offset == RangeAllocator::INVALID_OFFSET){
+			offset = block->ranges.allocate(size, alignment);
+			assert(offset != RangeAllocator::INVALID_OFFSET && "fresh memory block too small for allocation");
+		}
+
+		Allocation allocation{};
+		allocation.memory = block->memory;
+		allocation.offset = offset;
+		allocation.size = size;
+		allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + offset : nullptr;
+		allocation.block = block;
+		return allocation;
+	}
+
+	void MemoryAllocator::free(Allocation& allocation){
+		if(allocation.block == nullptr){
+			return;
+		}
+		std::lock_guard<std::mutex> lock{mutex};
+		MemoryBlock* block = allocation.block;
+		block->ranges.free(allocation.offset, allocation.size);
+		if(block->ranges.empty()){
+			// keep one empty shared block per pool around so alternating alloc/free does not hit vkAllocateMemory
+			auto& pool = pools[block->memory_type][static_cast<int>(block->kind)];
+			bool keep = !block->dedicated && std::none_of(pool.begin(), pool.end(), [block](const std::unique_ptr<MemoryBlock>& b){
+				return b.get() != block && !b->dedicated && b->ranges.empty() && b->ranges.get_strategy() == block->ranges.get_strategy();
+			});
+			if(!keep){
+				destroy_block(block);
+			}
+		}
+		allocation = Allocation{};
+	}
+
+	VkMappedMemoryRange MemoryAllocator::mapped_range(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset) const{
+		VkDeviceSize begin = allocation.offset + offset;
+		VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+		begin = align_down(begin, non_coherent_atom_size);
+		end = std::min(align_up(end, non_coherent_atom_size), allocation.offset + allocation.size);
+
+		VkMappedMemoryRange range{};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = allocation.memory;
+		range.offset = begin;
+		range.size = end - begin;
+		return range;
+	}
+
+	MemoryAllocator::Stats MemoryAllocator::get_stats() const{
+		std::lock_guard<std::mutex> lock{mutex};
+		Stats stats{};
+		VkDeviceSize free_bytes = 0;
+		VkDeviceSize largest_free_sum = 0;
+		for(const auto& type_pools : pools){
+			for(const auto& pool : type_pools){
+				for(const auto& block : pool){
+					const RangeAllocator& ranges = block->ranges;
+					VkDeviceSize largest = ranges.largest_free_range();
+					stats.block_count++;
+					stats.allocation_count += ranges.get_allocation_count();
+					stats.bytes_reserved += ranges.get_size();
+					stats.bytes_in_use += ranges.get_used();
+					stats.largest_free_range = std::max(stats.largest_free_range, largest);
+					free_bytes += ranges.get_size() - ranges.get_used();
+					largest_free_sum += largest;
+				}
+			}
+		}
+		if(free_bytes > 0){
+			stats.fragmentation = 1.f - static_cast<float>(largest_free_sum) / static_cast<float>(free_bytes);
+		}
+		return stats;
+	}
+
+	void MemoryAllocator::print_stats(std::ostream& out) const{
+		Stats stats = get_stats();
+		const double mb = 1024.0 * 1024.0;
+		out << std::fixed << std::setprecision(2)
+			<< "device memory: " << stats.allocation_count << " allocations in " << stats.block_count << " blocks, "
+			<< stats.bytes_in_use / mb << " / " << stats.bytes_reserved / mb << " MiB in use, "
+			<< "largest free range " << stats.largest_free_range / mb << " MiB, "
+			<< "fragmentation " << stats.fragmentation * 100.f << "%" << '\n'
+			<< std::defaultfloat;
+	}
+
+}
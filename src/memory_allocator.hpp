@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace blikaengine{
+
+	enum class AllocationStrategy{
+		// best fit over a coalescing free list, for long lived resources
+		FREE_LIST,
+		// bump pointer that only rewinds once everything in the block is freed, for bursts of short lived resources (staging)
+		LINEAR
+	};
+
+	// Offset bookkeeping for one contiguous range. Used for device memory blocks, but knows
+	// nothing about vulkan objects so it can suballocate any big buffer.
+	class RangeAllocator{
+		public:
+			static constexpr VkDeviceSize INVALID_OFFSET = ~VkDeviceSize{0};
+
+			RangeAllocator(VkDeviceSize size, AllocationStrategy strategy = AllocationStrategy::FREE_LIST);
+
+			// returns INVALID_OFFSET if no free range can hold size bytes at the requested alignment
+			VkDeviceSize allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+			void free(VkDeviceSize offset, VkDeviceSize size);
+			// appends free space at the end, existing allocations keep their offsets
+			void grow(VkDeviceSize new_size);
+
+			VkDeviceSize get_size() const{ return size; }
+			VkDeviceSize get_used() const{ return used; }
+			uint32_t get_allocation_count() const{ return allocation_count; }
+			AllocationStrategy get_strategy() const{ return strategy; }
+			VkDeviceSize largest_free_range() const;
+			size_t free_range_count() const;
+			bool empty() const{ return allocation_count == 0; }
+
+		private:
+			VkDeviceSize size;
+			AllocationStrategy strategy;
+			VkDeviceSize used = 0;
+			uint32_t allocation_count = 0;
+			// free list: offset -> size, neighbours are always coalesced
+			std::map<VkDeviceSize, VkDeviceSize> free_ranges;
+			// linear: everything past head is free
+			VkDeviceSize head = 0;
+	};
+
+	struct MemoryBlock;
+
+	struct Allocation{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		// start of this allocation in the persistently mapped block, null for non host visible memory
+		void* mapped = nullptr;
+		MemoryBlock* block = nullptr;
+	};
+
+	// Hands out suballocations of large VkDeviceMemory blocks instead of one vkAllocateMemory per
+	// resource. Blocks are kept per memory type, per resource kind (buffers and optimal tiling images
+	// never share a block, so bufferImageGranularity can be ignored) and per strategy. Host visible
+	// blocks are mapped once for their whole lifetime.
+	class MemoryAllocator{
+		public:
+			enum class ResourceKind{ BUFFER, IMAGE };
+
+			struct Stats{
+				uint32_t block_count = 0;
+				uint32_t allocation_count = 0;
+				VkDeviceSize bytes_reserved = 0;
+				VkDeviceSize bytes_in_use = 0;
+				VkDeviceSize largest_free_range = 0;
+				// 1 - largest free range / free bytes, summed over blocks: 0 when every block's free space is contiguous
+				float fragmentation = 0.f;
+			};
+
+			static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+			MemoryAllocator(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize block_size = DEFAULT_BLOCK_SIZE);
+			~MemoryAllocator();
+			MemoryAllocator(const MemoryAllocator&) = delete;
+			MemoryAllocator& operator = (const MemoryAllocator&) = delete;
+
+			Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind, AllocationStrategy strategy = AllocationStrategy::FREE_LIST);
+			void free(Allocation& allocation);
+
+			// range for vkFlush/InvalidateMappedMemoryRanges, expanded to nonCoherentAtomSize
+			VkMappedMemoryRange mapped_range(const Allocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) const;
+
+			Stats get_stats() const;
+			void print_stats(std::ostream& out) const;
+
+		private:
+			uint32_t find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties) const;
+			std::unique_ptr<MemoryBlock> create_block(uint32_t memory_type, ResourceKind kind, VkDeviceSize size, AllocationStrategy strategy, bool dedicated);
+			void destroy_block(MemoryBlock* block);
+
+			VkDevice device;
+			VkPhysicalDeviceMemoryProperties memory_properties;
+			VkDeviceSize non_coherent_atom_size;
+			VkDeviceSize block_size;
+
+			mutable std::mutex mutex;
+			std::vector<std::unique_ptr<MemoryBlock>> pools[VK_MAX_MEMORY_TYPES][2];
+	};
+
+}
@@ -0,0 +1,279 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+namespace blikaengine{
+
+	namespace{
+		constexpr uint32_t NO_VERTEX = ~0u;
+
+		// FIFO cache: a vertex is a hit while fewer than CACHE_SIZE misses happened since its own
+		class CacheSimulation{
+			public:
+				CacheSimulation(size_t vertex_count): miss_times(vertex_count, 0){}
+
+				bool access(uint32_t vertex){
+					if(time - miss_times[vertex] > MeshOptimizer::CACHE_SIZE){
+						miss_times[vertex] = time++;
+						return true;
+					}
+					return false;
+				}
+
+				uint32_t access_triangle(const uint32_t* triangle){
+					return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+				}
+
+				void flush(){
+					time += MeshOptimizer::CACHE_SIZE + 1;
+				}
+
+				bool ever_missed(uint32_t vertex) const{ return miss_times[vertex] != 0; }
+
+			private:
+				std::vector<uint32_t> miss_times;
+				uint32_t time = MeshOptimizer::CACHE_SIZE + 1;
+		};
+	}
+
+	MeshOptimizer::MeshOptimizer(const std::vector<glm::vec3>& positions): positions{positions}, local_ids(positions.size(), NO_VERTEX){
+	}
+
+	void MeshOptimizer::optimize(uint32_t* indices, size_t index_count){
+		assert(index_count % 3 == 0 && "indices have to be a triangle list");
+		if(index_count < 6){
+			return;
+		}
+		std::vector<uint32_t> cache_order(index_count);
+		optimize_vertex_cache(indices, index_count, cache_order.data());
+		optimize_overdraw(cache_order.data(), index_count, indices);
+	}
+
+	void MeshOptimizer::optimize_vertex_cache(uint32_t* indices, size_t index_count){
+		assert(index_count % 3 == 0 && "indices have to be a triangle list");
+		if(index_count < 6){
+			return;
+		}
+		std::vector<uint32_t> cache_order(index_count);
+		optimize_vertex_cache(indices, index_count, cache_order.data());
+		std::copy(cache_order.begin(), cache_order.end(), indices);
+	}
+
+	void MeshOptimizer::optimize_vertex_cache(const uint32_t* indices, size_t index_count, uint32_t* result){
+		// number the vertices of the range densely, so small ranges of big meshes stay cheap
+		local_indices.resize(index_count);
+		local_vertices.clear();
+		for(size_t i = 0; i < index_count; i++){
+			assert(indices[i] < positions.size() && "index outside of the positions");
+			uint32_t& local = local_ids[indices[i]];
+			if(local == NO_VERTEX){
+				local = static_cast<uint32_t>(local_vertices.size());
+				local_vertices.push_back(indices[i]);
+			}
+			local_indices[i] = local;
+		}
+		for(uint32_t vertex : local_vertices){
+			local_ids[vertex] = NO_VERTEX;
+		}
+
+		const size_t vertex_count = local_vertices.size();
+		const uint32_t triangle_count = static_cast<uint32_t>(index_count / 3);
+		adjacency_offsets.assign(vertex_count + 1, 0);
+		for(size_t i = 0; i < index_count; i++){
+			adjacency_offsets[local_indices[i] + 1]++;
+		}
+		live_triangles.resize(vertex_count);
+		for(size_t v = 0; v < vertex_count; v++){
+			live_triangles[v] = adjacency_offsets[v + 1];
+			adjacency_offsets[v + 1] += adjacency_offsets[v];
+		}
+		adjacent_triangles.resize(index_count);
+		std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+		for(uint32_t t = 0; t < triangle_count; t++){
+			for(uint32_t k = 0; k < 3; k++){
+				adjacent_triangles[fill[local_indices[3 * t + k]]++] = t;
+			}
+		}
+		cache_times.assign(vertex_count, 0);
+		dead_ends.clear();
+		next_vertex = 0;
+
+		std::vector<bool> emitted(triangle_count, false);
+		std::vector<uint32_t> candidates{};
+		uint32_t time = CACHE_SIZE + 1;
+		uint32_t* out = result;
+		for(uint32_t fanning = 0; fanning != NO_VERTEX;){
+			// every triangle left around the fanning vertex, in input order
+			candidates.clear();
+			for(uint32_t a = adjacency_offsets[fanning]; a < adjacency_offsets[fanning + 1]; a++){
+				uint32_t t = adjacent_triangles[a];
+				if(emitted[t]){
+					continue;
+				}
+				for(uint32_t k = 0; k < 3; k++){
+					uint32_t v = local_indices[3 * t + k];
+					*out++ = local_vertices[v];
+					dead_ends.push_back(v);
+					candidates.push_back(v);
+					live_triangles[v]--;
+					if(time - cache_times[v] > CACHE_SIZE){
+						cache_times[v] = time++;
+					}
+				}
+				emitted[t] = true;
+			}
+			// fan next around the oldest vertex that stays cached while its triangles are emitted, or any
+			// vertex with triangles left if none does
+			uint32_t best = NO_VERTEX;
+			int64_t best_priority = -1;
+			for(uint32_t v : candidates){
+				if(live_triangles[v] == 0){
+					continue;
+				}
+				int64_t age = static_cast<int64_t>(time) - cache_times[v];
+				int64_t priority = age + 2 * static_cast<int64_t>(live_triangles[v]) <= CACHE_SIZE ? age : 0;
+				if(priority > best_priority){
+					best_priority = priority;
+					best = v;
+				}
+			}
+			fanning = best != NO_VERTEX ? best : skip_dead_end();
+		}
+		assert(out == result + 3 * static_cast<size_t>(triangle_count) && "triangles lost while reordering");
+	}
+
+	uint32_t MeshOptimizer::skip_dead_end(){
+		// the most recently used vertex with triangles left, likely still cached
+		while(!dead_ends.empty()){
+			uint32_t v = dead_ends.back();
+			dead_ends.pop_back();
+			if(live_triangles[v] > 0){
+				return v;
+			}
+		}
+		// live counts only ever go down, so the scan never has to look back
+		for(; next_vertex < live_triangles.size(); next_vertex++){
+			if(live_triangles[next_vertex] > 0){
+				return next_vertex;
+			}
+		}
+		return NO_VERTEX;
+	}
+
+	std::vector<size_t> MeshOptimizer::find_clusters(const uint32_t* indices, size_t index_count){
+		const size_t triangle_count = index_count / 3;
+		if(triangle_count == 0){
+			return {};
+		}
+		CacheSimulation cache{positions.size()};
+		// a triangle missing all three vertices starts over anyway, cutting there costs nothing. The first
+		// cluster starts at triangle 0 whatever it misses, a degenerate one misses fewer than three
+		std::vector<size_t> hard_boundaries{0};
+		for(size_t t = 0; t < triangle_count; t++){
+			if(cache.access_triangle(indices + 3 * t) == 3 && t > 0){
+				hard_boundaries.push_back(t);
+			}
+		}
+		hard_boundaries.push_back(triangle_count);
+
+		// within each, cut again once the miss ratio of the cluster so far is close enough to the whole
+		// run's that reordering can't make it much worse
+		std::vector<size_t> clusters{};
+		for(size_t h = 0; h + 1 < hard_boundaries.size(); h++){
+			const size_t begin = hard_boundaries[h], end = hard_boundaries[h + 1];
+			cache.flush();
+			uint32_t misses = 0;
+			for(size_t t = begin; t < end; t++){
+				misses += cache.access_triangle(indices + 3 * t);
+			}
+			const float threshold = OVERDRAW_THRESHOLD * static_cast<float>(misses) / static_cast<float>(end - begin);
+
+			cache.flush();
+			clusters.push_back(begin);
+			size_t start = begin;
+			misses = 0;
+			for(size_t t = begin; t + 1 < end; t++){
+				misses += cache.access_triangle(indices + 3 * t);
+				if(static_cast<float>(misses) <= threshold * static_cast<float>(t + 1 - start)){
+					clusters.push_back(t + 1);
+					start = t + 1;
+					misses = 0;
+					cache.flush();
+				}
+			}
+		}
+		return clusters;
+	}
+
+	void MeshOptimizer::optimize_overdraw(const uint32_t* indices, size_t index_count, uint32_t* result){
+		const size_t triangle_count = index_count / 3;
+		std::vector<size_t> clusters = find_clusters(indices, index_count);
+		clusters.push_back(triangle_count);
+		const size_t cluster_count = clusters.size() - 1;
+
+		// area weighted centroids and normals of the clusters
+		std::vector<glm::vec3> centroids(cluster_count);
+		std::vector<glm::vec3> normals(cluster_count);
+		std::vector<float> areas(cluster_count);
+		glm::vec3 mesh_centroid{0.f};
+		float mesh_area = 0.f;
+		for(size_t c = 0; c < cluster_count; c++){
+			glm::vec3 centroid{0.f}, normal{0.f};
+			float area = 0.f;
+			for(size_t t = clusters[c]; t < clusters[c + 1]; t++){
+				const glm::vec3& p0 = positions[indices[3 * t + 0]];
+				const glm::vec3& p1 = positions[indices[3 * t + 1]];
+				const glm::vec3& p2 = positions[indices[3 * t + 2]];
+				glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+				float triangle_area = .5f * glm::length(cross);
+				centroid += triangle_area * (p0 + p1 + p2) / 3.f;
+				normal += cross;
+				area += triangle_area;
+			}
+			centroids[c] = centroid;
+			normals[c] = normal;
+			areas[c] = area;
+			mesh_centroid += centroid;
+			mesh_area += area;
+		}
+		if(mesh_area > 0.f){
+			mesh_centroid /= mesh_area;
+		}
+
+		// clusters far out along their own normal occlude more than they are occluded, draw them first
+		std::vector<float> keys(cluster_count, 0.f);
+		for(size_t c = 0; c < cluster_count; c++){
+			float length = glm::length(normals[c]);
+			if(areas[c] > 0.f && length > 0.f){
+				keys[c] = glm::dot(centroids[c] / areas[c] - mesh_centroid, normals[c] / length);
+			}
+		}
+		std::vector<uint32_t> order(cluster_count);
+		std::iota(order.begin(), order.end(), 0u);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){ return keys[a] > keys[b]; });
+
+		uint32_t* out = result;
+		for(uint32_t c : order){
+			out = std::copy(indices + 3 * clusters[c], indices + 3 * clusters[c + 1], out);
+		}
+		assert(out == result + 3 * triangle_count && "triangles lost while reordering");
+	}
+
+	VertexCacheStatistics MeshOptimizer::analyze(const uint32_t* indices, size_t index_count, size_t vertex_count){
+		VertexCacheStatistics statistics{};
+		if(index_count < 3){
+			return statistics;
+		}
+		CacheSimulation cache{vertex_count};
+		uint32_t misses = 0, referenced = 0;
+		for(size_t i = 0; i < index_count; i++){
+			referenced += !cache.ever_missed(indices[i]);
+			misses += cache.access(indices[i]);
+		}
+		statistics.acmr = static_cast<float>(misses) / static_cast<float>(index_count / 3);
+		statistics.atvr = static_cast<float>(misses) / static_cast<float>(referenced);
+		return statistics;
+	}
+}
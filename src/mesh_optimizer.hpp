@@ -0,0 +1,67 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace blikaengine{
+
+	// how well a triangle order uses a FIFO post transform cache of MeshOptimizer::CACHE_SIZE vertices
+	struct VertexCacheStatistics{
+		// average cache misses per triangle, 0.5 at best for large regular meshes, 3 at worst
+		float acmr = 0.f;
+		// average times each referenced vertex is transformed, 1 at best
+		float atvr = 0.f;
+	};
+
+	// Import time triangle reordering after Sander, Nehab & Barczak, "Fast Triangle Reordering for Vertex
+	// Locality and Reduced Overdraw" (2007). Tipsify orders the triangles for the post transform cache by
+	// fanning around recently used vertices. The result is then cut into clusters wherever the cache
+	// starts over anyway, or where a cluster's miss ratio has settled within OVERDRAW_THRESHOLD of its
+	// whole run, and the clusters are drawn outward facing ones first, so from most directions the
+	// triangles in front tend to be drawn before the ones they hide.
+	class MeshOptimizer{
+		public:
+			static constexpr uint32_t CACHE_SIZE = 16;
+			// how much the miss ratio may grow for the sake of overdraw
+			static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+			// positions have to outlive the optimizer
+			MeshOptimizer(const std::vector<glm::vec3>& positions);
+
+			// reorders the triangles of indices[0, index_count) for the cache, then for overdraw. Every index
+			// has to be below positions.size()
+			void optimize(uint32_t* indices, size_t index_count);
+			// the cache half of optimize() alone, for triangles whose clusters are fixed already
+			void optimize_vertex_cache(uint32_t* indices, size_t index_count);
+
+			static VertexCacheStatistics analyze(const uint32_t* indices, size_t index_count, size_t vertex_count);
+
+		private:
+			void optimize_vertex_cache(const uint32_t* indices, size_t index_count, uint32_t* result);
+			void optimize_overdraw(const uint32_t* indices, size_t index_count, uint32_t* result);
+			// first triangle of every cluster, in order
+			std::vector<size_t> find_clusters(const uint32_t* indices, size_t index_count);
+			// the live vertex fanned around next, or ~0u when every triangle is out
+			uint32_t skip_dead_end();
+
+			const std::vector<glm::vec3>& positions;
+			// vertices of the range being reordered numbered from 0, local_ids maps back to them and is
+			// NO_VERTEX outside of a call
+			std::vector<uint32_t> local_ids;
+			std::vector<uint32_t> local_vertices{};
+			std::vector<uint32_t> local_indices{};
+			// triangles around every local vertex, offsets into adjacent_triangles
+			std::vector<uint32_t> adjacency_offsets{};
+			std::vector<uint32_t> adjacent_triangles{};
+			// per local vertex: triangles not yet emitted, time of the last cache miss
+			std::vector<uint32_t> live_triangles{};
+			std::vector<uint32_t> cache_times{};
+			std::vector<uint32_t> dead_ends{};
+			uint32_t next_vertex = 0;
+	};
+}
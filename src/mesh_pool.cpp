@@ -0,0 +1,135 @@
+#include "mesh_pool.hpp"
+#include "upload_manager.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace blikaengine{
+
+	MeshPool::MeshPool(Device& device, UploadManager& uploads, VkDeviceSize vertex_size, VkDeviceSize position_offset, VkDeviceSize position_size): device{device}, uploads{uploads},
+		vertex_pool{vertex_size, INITIAL_VERTEX_CAPACITY, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT},
+		index_pool{sizeof(uint32_t), INITIAL_INDEX_CAPACITY, VK_BUFFER_USAGE_INDEX_BUFFER_BIT},
+		position_offset{position_offset}, position_size{position_size}{
+		assert(position_offset + position_size <= vertex_size && "position outside of the vertex");
+		vertex_pool.buffer = create_buffer(vertex_pool.element_size, vertex_pool.ranges.get_size(), vertex_pool.usage);
+		index_pool.buffer = create_buffer(index_pool.element_size, index_pool.ranges.get_size(), index_pool.usage);
+		position_buffer = create_buffer(position_size, vertex_pool.ranges.get_size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	}
+
+	MeshPool::~MeshPool(){
+	}
+
+	std::unique_ptr<Buffer> MeshPool::create_buffer(VkDeviceSize element_size, VkDeviceSize count, VkBufferUsageFlags usage){
+		return std::make_unique<Buffer>(device, element_size, static_cast<uint32_t>(count),
+			usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	void MeshPool::grow(Pool& pool, VkDeviceSize min_capacity){
+		VkDeviceSize old_size = pool.ranges.get_size();
+		VkDeviceSize new_size = std::max(min_capacity, old_size * 2);
+		if(new_size > UINT32_MAX){
+			throw std::runtime_error("mesh pool exceeds 32 bit element offsets!");
+		}
+		pool.ranges.grow(new_size);
+		replace_buffer(pool.buffer, pool.element_size, old_size, new_size, pool.usage);
+		if(&pool == &vertex_pool){
+			replace_buffer(position_buffer, position_size, old_size, new_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		}
+	}
+
+	void MeshPool::replace_buffer(std::unique_ptr<Buffer>& buffer, VkDeviceSize element_size, VkDeviceSize old_count, VkDeviceSize new_count, VkBufferUsageFlags usage){
+		auto old_buffer = std::move(buffer);
+		buffer = create_buffer(element_size, new_count, usage);
+
+		// earlier uploads into the old buffer (this batch or already submitted ones on the same queue) have to land first
+		VkCommandBuffer command_buffer = uploads.transfer_commands();
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		VkBufferCopy copy_region{};
+		copy_region.size = old_count * element_size;
+		vkCmdCopyBuffer(command_buffer, old_buffer->getBuffer(), buffer->getBuffer(), 1, &copy_region);
+		// and the copy has to finish before anything else writes the new buffer
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		retired_buffers.push_back({uploads.pending_ticket(), std::move(old_buffer)});
+	}
+
+	VkDeviceSize MeshPool::allocate_range(Pool& pool, VkDeviceSize count){
+		VkDeviceSize offset = pool.ranges.allocate(count);
+		if(offset == RangeAllocator::INVALID_OFFSET){
+			collect();
+			offset = pool.ranges.allocate(count);
+		}
+		if(offset == RangeAllocator::INVALID_OFFSET){
+			grow(pool, pool.ranges.get_size() + count);
+			offset = pool.ranges.allocate(count);
+			assert(offset != RangeAllocator::INVALID_OFFSET && "mesh pool did not grow enough");
+		}
+		return offset;
+	}
+
+	MeshPool::Mesh MeshPool::allocate(const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, const void* positions){
+		assert(vertex_count > 0 && index_count > 0 && "cannot allocate an empty mesh");
+		Mesh mesh{};
+		mesh.vertex_count = vertex_count;
+		mesh.index_count = index_count;
+		mesh.vertex_offset = static_cast<int32_t>(allocate_range(vertex_pool, vertex_count));
+		mesh.first_index = static_cast<uint32_t>(allocate_range(index_pool, index_count));
+		uploads.upload_buffer(vertices, vertex_count * vertex_pool.element_size, vertex_pool.buffer->getBuffer(), mesh.vertex_offset * vertex_pool.element_size);
+		if(positions == nullptr){
+			extracted_positions.resize(vertex_count * position_size);
+			const auto* vertex_bytes = static_cast<const char*>(vertices);
+			for(uint32_t i = 0; i < vertex_count; i++){
+				std::memcpy(&extracted_positions[i * position_size], vertex_bytes + i * vertex_pool.element_size + position_offset, position_size);
+			}
+			positions = extracted_positions.data();
+		}
+		uploads.upload_buffer(positions, vertex_count * position_size, position_buffer->getBuffer(), mesh.vertex_offset * position_size);
+		uploads.upload_buffer(indices, index_count * index_pool.element_size, index_pool.buffer->getBuffer(), mesh.first_index * index_pool.element_size);
+		return mesh;
+	}
+
+	void MeshPool::free(const Mesh& mesh){
+		// frames recorded before now may still draw the mesh
+		pending_frees.push_back({uploads.pending_ticket(), mesh});
+	}
+
+	void MeshPool::collect(){
+		for(size_t i = 0; i < pending_frees.size();){
+			if(uploads.is_complete(pending_frees[i].ticket)){
+				const Mesh& mesh = pending_frees[i].mesh;
+				vertex_pool.ranges.free(mesh.vertex_offset, mesh.vertex_count);
+				index_pool.ranges.free(mesh.first_index, mesh.index_count);
+				pending_frees[i] = pending_frees.back();
+				pending_frees.pop_back();
+			}else{
+				i++;
+			}
+		}
+		retired_buffers.erase(std::remove_if(retired_buffers.begin(), retired_buffers.end(), [&](const RetiredBuffer& retired){
+			return uploads.is_complete(retired.ticket);
+		}), retired_buffers.end());
+	}
+
+	void MeshPool::bind(VkCommandBuffer command_buffer){
+		VkBuffer buffers[] = {vertex_pool.buffer->getBuffer()};
+		VkDeviceSize offsets[] = {0};
+		vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers, offsets);
+		vkCmdBindIndexBuffer(command_buffer, index_pool.buffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	void MeshPool::bind_positions(VkCommandBuffer command_buffer){
+		VkBuffer buffers[] = {position_buffer->getBuffer()};
+		VkDeviceSize offsets[] = {0};
+		vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers, offsets);
+		vkCmdBindIndexBuffer(command_buffer, index_pool.buffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "device.hpp"
+#include "memory_allocator.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace blikaengine{
+
+	class UploadManager;
+
+	// All mesh geometry lives in one vertex and one index buffer, so a whole pass can be drawn with
+	// a single bind and indirect draws. Meshes keep their own local indices, vertex_offset rebases
+	// them. Both buffers grow by copying on the transfer queue; replaced buffers and freed ranges are
+	// only recycled once every frame that could still read them has finished. A frame may draw meshes
+	// allocated, and bind buffers grown, while it was recorded only if the upload manager is flushed
+	// before the frame is submitted.
+	//
+	// Next to the interleaved vertices the pool keeps their positions tightly packed, at the same
+	// offsets, for depth only passes that would otherwise pull every attribute through the cache.
+	// Vertices are opaque bytes here, their layout is the device's VertexFormat.
+	class MeshPool{
+		public:
+			struct Mesh{
+				int32_t vertex_offset = 0;
+				uint32_t vertex_count = 0;
+				uint32_t first_index = 0;
+				uint32_t index_count = 0;
+			};
+
+			static constexpr VkDeviceSize INITIAL_VERTEX_CAPACITY = 256 * 1024;
+			static constexpr VkDeviceSize INITIAL_INDEX_CAPACITY = 1024 * 1024;
+
+			// the position is position_size bytes at position_offset within a vertex
+			MeshPool(Device& device, UploadManager& uploads, VkDeviceSize vertex_size, VkDeviceSize position_offset, VkDeviceSize position_size);
+			~MeshPool();
+			MeshPool(const MeshPool&) = delete;
+			MeshPool& operator = (const MeshPool&) = delete;
+
+			// copies the geometry into the pool through the upload manager. positions are the vertices'
+			// positions already packed for the position stream, extracted from the vertices when null
+			Mesh allocate(const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, const void* positions = nullptr);
+			void free(const Mesh& mesh);
+			// recycles freed ranges and replaced buffers whose last users have finished
+			void collect();
+
+			void bind(VkCommandBuffer command_buffer);
+			// binds the position stream as binding 0 instead of the full vertices
+			void bind_positions(VkCommandBuffer command_buffer);
+			VkBuffer get_vertex_buffer() const{ return vertex_pool.buffer->getBuffer(); }
+			VkBuffer get_position_buffer() const{ return position_buffer->getBuffer(); }
+			VkBuffer get_index_buffer() const{ return index_pool.buffer->getBuffer(); }
+			VkDeviceSize get_vertex_size() const{ return vertex_pool.element_size; }
+			VkDeviceSize get_position_size() const{ return position_size; }
+
+		private:
+			struct Pool{
+				Pool(VkDeviceSize element_size, VkDeviceSize capacity, VkBufferUsageFlags usage): element_size{element_size}, usage{usage}, ranges{capacity}{}
+
+				VkDeviceSize element_size;
+				VkBufferUsageFlags usage;
+				RangeAllocator ranges;
+				std::unique_ptr<Buffer> buffer{};
+			};
+
+			struct PendingFree{
+				uint64_t ticket;
+				Mesh mesh;
+			};
+
+			struct RetiredBuffer{
+				uint64_t ticket;
+				std::unique_ptr<Buffer> buffer;
+			};
+
+			// offset in elements, grows the pool if needed
+			VkDeviceSize allocate_range(Pool& pool, VkDeviceSize count);
+			std::unique_ptr<Buffer> create_buffer(VkDeviceSize element_size, VkDeviceSize count, VkBufferUsageFlags usage);
+			void grow(Pool& pool, VkDeviceSize min_capacity);
+			// swaps buffer for a bigger copy, the old one is retired
+			void replace_buffer(std::unique_ptr<Buffer>& buffer, VkDeviceSize element_size, VkDeviceSize old_count, VkDeviceSize new_count, VkBufferUsageFlags usage);
+
+			Device& device;
+			UploadManager& uploads;
+			Pool vertex_pool;
+			Pool index_pool;
+			// sized and grown with vertex_pool, whose ranges it shares
+			std::unique_ptr<Buffer> position_buffer{};
+			VkDeviceSize position_offset;
+			VkDeviceSize position_size;
+			// scratch for the positions allocate() extracts
+			std::vector<char> extracted_positions{};
+			std::vector<PendingFree> pending_frees{};
+			std::vector<RetiredBuffer> retired_buffers{};
+	};
+}
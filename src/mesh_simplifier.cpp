@@ -0,0 +1,226 @@
+#include "mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace blikaengine{
+
+	namespace{
+		// normals rotating further than this (cos ~75 degrees) reject the collapse
+		constexpr float MIN_NORMAL_DOT = .25f;
+
+		uint64_t edge_key(uint32_t a, uint32_t b){
+			return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+		}
+
+		struct PositionHash{
+			size_t operator()(const glm::vec3& position) const{
+				uint32_t bits[3];
+				std::memcpy(bits, &position, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+	}
+
+	void MeshSimplifier::Quadric::add_plane(const glm::dvec3& normal, double distance, double area){
+		a2 += area * normal.x * normal.x;
+		ab += area * normal.x * normal.y;
+		ac += area * normal.x * normal.z;
+		ad += area * normal.x * distance;
+		b2 += area * normal.y * normal.y;
+		bc += area * normal.y * normal.z;
+		bd += area * normal.y * distance;
+		c2 += area * normal.z * normal.z;
+		cd += area * normal.z * distance;
+		d2 += area * distance * distance;
+		weight += area;
+	}
+
+	MeshSimplifier::Quadric& MeshSimplifier::Quadric::operator += (const Quadric& other){
+		a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+		b2 += other.b2; bc += other.bc; bd += other.bd;
+		c2 += other.c2; cd += other.cd;
+		d2 += other.d2;
+		weight += other.weight;
+		return *this;
+	}
+
+	double MeshSimplifier::Quadric::evaluate(const glm::vec3& position) const{
+		double x = position.x, y = position.y, z = position.z;
+		double sum = a2 * x * x + b2 * y * y + c2 * z * z
+			+ 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+			+ 2.0 * (ad * x + bd * y + cd * z)
+			+ d2;
+		return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+	}
+
+	MeshSimplifier::MeshSimplifier(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices): positions{positions}, indices{indices}{
+		assert(indices.size() % 3 == 0 && "simplifier needs a triangle list");
+		quadrics.resize(positions.size());
+		for(size_t i = 0; i < indices.size(); i += 3){
+			glm::dvec3 p0 = positions[indices[i]];
+			glm::dvec3 p1 = positions[indices[i + 1]];
+			glm::dvec3 p2 = positions[indices[i + 2]];
+			glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+			double length = glm::length(normal);
+			if(length <= 0.0){
+				continue;
+			}
+			normal /= length;
+			Quadric quadric{};
+			quadric.add_plane(normal, -glm::dot(normal, p0), length * .5);
+			for(int corner = 0; corner < 3; corner++){
+				quadrics[indices[i + corner]] += quadric;
+			}
+		}
+		remap.resize(positions.size());
+		for(uint32_t i = 0; i < remap.size(); i++){
+			remap[i] = i;
+		}
+		lock_seams_and_borders();
+	}
+
+	void MeshSimplifier::lock_seams_and_borders(){
+		locked.assign(positions.size(), false);
+		// one representative per position, the others are seam vertices
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> first_at{};
+		std::vector<uint32_t> welded(positions.size());
+		for(uint32_t i = 0; i < positions.size(); i++){
+			auto inserted = first_at.try_emplace(positions[i], i);
+			welded[i] = inserted.first->second;
+			if(!inserted.second){
+				locked[i] = true;
+				locked[inserted.first->second] = true;
+			}
+		}
+		// edges of the welded mesh not shared by exactly two triangles are borders or non manifold
+		std::unordered_map<uint64_t, uint32_t> edge_uses{};
+		edge_uses.reserve(indices.size());
+		for(size_t i = 0; i < indices.size(); i += 3){
+			for(int edge = 0; edge < 3; edge++){
+				edge_uses[edge_key(welded[indices[i + edge]], welded[indices[i + (edge + 1) % 3]])]++;
+			}
+		}
+		for(size_t i = 0; i < indices.size(); i += 3){
+			for(int edge = 0; edge < 3; edge++){
+				uint32_t a = indices[i + edge];
+				uint32_t b = indices[i + (edge + 1) % 3];
+				if(edge_uses[edge_key(welded[a], welded[b])] != 2){
+					locked[a] = true;
+					locked[b] = true;
+				}
+			}
+		}
+	}
+
+	void MeshSimplifier::build_adjacency(){
+		adjacency_offsets.assign(positions.size() + 1, 0);
+		for(uint32_t index : indices){
+			adjacency_offsets[index + 1]++;
+		}
+		for(size_t i = 1; i < adjacency_offsets.size(); i++){
+			adjacency_offsets[i] += adjacency_offsets[i - 1];
+		}
+		adjacent_triangles.resize(indices.size());
+		std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+		for(size_t i = 0; i < indices.size(); i++){
+			adjacent_triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	bool MeshSimplifier::keeps_orientation(uint32_t from, uint32_t to) const{
+		for(uint32_t i = adjacency_offsets[from]; i < adjacency_offsets[from + 1]; i++){
+			const uint32_t* triangle = &indices[adjacent_triangles[i] * 3];
+			if(triangle[0] == to || triangle[1] == to || triangle[2] == to){
+				// collapses away with the edge
+				continue;
+			}
+			glm::vec3 before[3];
+			glm::vec3 after[3];
+			for(int corner = 0; corner < 3; corner++){
+				before[corner] = positions[triangle[corner]];
+				after[corner] = triangle[corner] == from ? positions[to] : before[corner];
+			}
+			glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+			float lengths = glm::length(normal_before) * glm::length(normal_after);
+			if(lengths <= 0.f || glm::dot(normal_before, normal_after) < MIN_NORMAL_DOT * lengths){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t MeshSimplifier::collapse_pass(size_t target_index_count, float max_cost){
+		build_adjacency();
+		collapses.clear();
+		for(size_t i = 0; i < indices.size(); i += 3){
+			for(int edge = 0; edge < 3; edge++){
+				uint32_t a = indices[i + edge];
+				uint32_t b = indices[i + (edge + 1) % 3];
+				// b keeps its position and takes over a's quadric
+				Quadric merged = quadrics[a];
+				merged += quadrics[b];
+				if(!locked[a]){
+					collapses.push_back({static_cast<float>(merged.evaluate(positions[b])), a, b});
+				}
+				if(!locked[b]){
+					collapses.push_back({static_cast<float>(merged.evaluate(positions[a])), b, a});
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b){ return a.cost < b.cost; });
+
+		// a collapse removes about two triangles
+		size_t triangles_to_remove = (indices.size() - target_index_count + 2) / 3;
+		size_t collapse_goal = std::max<size_t>(1, triangles_to_remove / 2);
+		touched.assign(positions.size(), false);
+		size_t collapsed = 0;
+		for(const Collapse& collapse : collapses){
+			if(collapse.cost > max_cost || collapsed >= collapse_goal){
+				break;
+			}
+			if(touched[collapse.from] || touched[collapse.to] || !keeps_orientation(collapse.from, collapse.to)){
+				continue;
+			}
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			// every triangle around from changes, keep their other vertices out of this pass
+			for(uint32_t i = adjacency_offsets[collapse.from]; i < adjacency_offsets[collapse.from + 1]; i++){
+				const uint32_t* triangle = &indices[adjacent_triangles[i] * 3];
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+			}
+			touched[collapse.to] = true;
+			error = std::max(error, std::sqrt(collapse.cost));
+			collapsed++;
+		}
+		if(collapsed == 0){
+			return 0;
+		}
+
+		size_t write = 0;
+		for(size_t i = 0; i < indices.size(); i += 3){
+			uint32_t a = remap[indices[i]];
+			uint32_t b = remap[indices[i + 1]];
+			uint32_t c = remap[indices[i + 2]];
+			if(a == b || b == c || c == a){
+				continue;
+			}
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+		return collapsed;
+	}
+
+	const std::vector<uint32_t>& MeshSimplifier::simplify(size_t target_index_count, float max_error){
+		const float max_cost = max_error * max_error;
+		while(indices.size() > target_index_count && collapse_pass(target_index_count, max_cost) > 0){
+		}
+		return indices;
+	}
+}
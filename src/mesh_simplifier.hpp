@@ -0,0 +1,71 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace blikaengine{
+
+	// Quadric error metric simplification (Garland & Heckbert) by edge collapse. Vertices are only ever
+	// collapsed onto one of their neighbours, never moved, so every result still indexes the original
+	// vertex buffer and LODs can share it. Vertices on open borders and on attribute seams (several
+	// vertices at one position) are locked, which keeps the silhouette and uv layout intact. Quadrics
+	// accumulate over successive simplify() calls, so the error of a coarser level is measured against
+	// the original surface, not against the level before it.
+	class MeshSimplifier{
+		public:
+			// positions have to outlive the simplifier
+			MeshSimplifier(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+
+			// collapses edges until at most target_index_count indices are left or the next collapse would
+			// move the surface by more than max_error, and returns the triangles left
+			const std::vector<uint32_t>& simplify(size_t target_index_count, float max_error);
+
+			// distance the current result can be off the original surface, in the units of the positions
+			float get_error() const{ return error; }
+
+		private:
+			// symmetric 4x4 plane quadric plus the area it was accumulated over
+			struct Quadric{
+				double a2 = 0, ab = 0, ac = 0, ad = 0;
+				double b2 = 0, bc = 0, bd = 0;
+				double c2 = 0, cd = 0;
+				double d2 = 0;
+				double weight = 0;
+
+				void add_plane(const glm::dvec3& normal, double distance, double area);
+				Quadric& operator += (const Quadric& other);
+				// mean squared distance of position to the planes
+				double evaluate(const glm::vec3& position) const;
+			};
+
+			struct Collapse{
+				float cost;
+				uint32_t from;
+				uint32_t to;
+			};
+
+			void lock_seams_and_borders();
+			void build_adjacency();
+			// false if moving from onto to would flip or fold any triangle around from
+			bool keeps_orientation(uint32_t from, uint32_t to) const;
+			// one round of independent collapses, the number made
+			size_t collapse_pass(size_t target_index_count, float max_cost);
+
+			const std::vector<glm::vec3>& positions;
+			std::vector<uint32_t> indices;
+			std::vector<Quadric> quadrics;
+			std::vector<bool> locked;
+			// triangles around every vertex, offsets into adjacent_triangles
+			std::vector<uint32_t> adjacency_offsets;
+			std::vector<uint32_t> adjacent_triangles;
+			std::vector<Collapse> collapses;
+			std::vector<uint32_t> remap;
+			std::vector<bool> touched;
+			float error = 0.f;
+	};
+}
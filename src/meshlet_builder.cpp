@@ -0,0 +1,159 @@
+#include "meshlet_builder.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace blikaengine{
+
+	MeshletBuilder::MeshletBuilder(const std::vector<glm::vec3>& positions): positions{positions}{
+	}
+
+	void MeshletBuilder::build_adjacency(const std::vector<uint32_t>& indices, size_t index_count){
+		adjacency_offsets.assign(positions.size() + 1, 0);
+		for(size_t i = 0; i < index_count; i++){
+			adjacency_offsets[indices[i] + 1]++;
+		}
+		for(size_t i = 1; i < adjacency_offsets.size(); i++){
+			adjacency_offsets[i] += adjacency_offsets[i - 1];
+		}
+		adjacent_triangles.resize(index_count);
+		std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+		for(size_t i = 0; i < index_count; i++){
+			adjacent_triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<Meshlet> MeshletBuilder::build(std::vector<uint32_t>& indices, size_t index_count){
+		assert(index_count % 3 == 0 && index_count <= indices.size() && "meshlets need a triangle list");
+		constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+		const uint32_t triangle_count = static_cast<uint32_t>(index_count / 3);
+		build_adjacency(indices, index_count);
+
+		std::vector<bool> used(triangle_count, false);
+		// meshlet each vertex was last added to
+		std::vector<uint32_t> owner(positions.size(), NONE);
+		std::vector<uint32_t> vertices{};
+		std::vector<uint32_t> triangles{};
+		std::vector<uint32_t> reordered{};
+		reordered.reserve(index_count);
+		std::vector<Meshlet> meshlets{};
+
+		auto new_vertices = [&](uint32_t triangle, uint32_t meshlet){
+			uint32_t count = 0;
+			for(int corner = 0; corner < 3; corner++){
+				count += owner[indices[triangle * 3 + corner]] != meshlet ? 1 : 0;
+			}
+			return count;
+		};
+		auto add = [&](uint32_t triangle, uint32_t meshlet){
+			used[triangle] = true;
+			triangles.push_back(triangle);
+			for(int corner = 0; corner < 3; corner++){
+				uint32_t vertex = indices[triangle * 3 + corner];
+				if(owner[vertex] != meshlet){
+					owner[vertex] = meshlet;
+					vertices.push_back(vertex);
+				}
+			}
+		};
+
+		uint32_t seed = 0;
+		while(true){
+			while(seed < triangle_count && used[seed]){
+				seed++;
+			}
+			if(seed == triangle_count){
+				break;
+			}
+			const uint32_t meshlet = static_cast<uint32_t>(meshlets.size());
+			vertices.clear();
+			triangles.clear();
+			add(seed, meshlet);
+			while(triangles.size() < MAX_TRIANGLES){
+				// the unused neighbour needing the fewest new vertices, it has to fit
+				uint32_t best = NONE;
+				uint32_t best_new = 4;
+				for(size_t v = 0; v < vertices.size() && best_new > 0; v++){
+					uint32_t vertex = vertices[v];
+					for(uint32_t i = adjacency_offsets[vertex]; i < adjacency_offsets[vertex + 1]; i++){
+						uint32_t triangle = adjacent_triangles[i];
+						if(used[triangle]){
+							continue;
+						}
+						uint32_t needed = new_vertices(triangle, meshlet);
+						if(needed < best_new && vertices.size() + needed <= MAX_VERTICES){
+							best = triangle;
+							best_new = needed;
+							if(needed == 0){
+								break;
+							}
+						}
+					}
+				}
+				// nothing connected fits anymore, a meshlet spanning two islands would only loosen its bounds
+				if(best == NONE){
+					break;
+				}
+				add(best, meshlet);
+			}
+
+			Meshlet result = compute_bounds(triangles, indices);
+			result.first_index = static_cast<uint32_t>(reordered.size());
+			result.index_count = static_cast<uint32_t>(triangles.size() * 3);
+			for(uint32_t triangle : triangles){
+				reordered.insert(reordered.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+			}
+			meshlets.push_back(result);
+		}
+		std::copy(reordered.begin(), reordered.end(), indices.begin());
+		return meshlets;
+	}
+
+	Meshlet MeshletBuilder::compute_bounds(const std::vector<uint32_t>& triangles, const std::vector<uint32_t>& indices) const{
+		Meshlet meshlet{};
+		glm::vec3 box_min{std::numeric_limits<float>::max()};
+		glm::vec3 box_max{std::numeric_limits<float>::lowest()};
+		glm::vec3 normal_sum{0.f};
+		for(uint32_t triangle : triangles){
+			glm::vec3 p0 = positions[indices[triangle * 3]];
+			glm::vec3 p1 = positions[indices[triangle * 3 + 1]];
+			glm::vec3 p2 = positions[indices[triangle * 3 + 2]];
+			box_min = glm::min(box_min, glm::min(p0, glm::min(p1, p2)));
+			box_max = glm::max(box_max, glm::max(p0, glm::max(p1, p2)));
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(normal);
+			if(length > 0.f){
+				normal_sum += normal / length;
+			}
+		}
+		glm::vec3 center = (box_min + box_max) * .5f;
+		float radius_squared = 0.f;
+		for(uint32_t triangle : triangles){
+			for(int corner = 0; corner < 3; corner++){
+				glm::vec3 offset = positions[indices[triangle * 3 + corner]] - center;
+				radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+			}
+		}
+		meshlet.sphere = glm::vec4(center, std::sqrt(radius_squared));
+
+		float axis_length = glm::length(normal_sum);
+		if(axis_length <= 0.f){
+			return meshlet;
+		}
+		glm::vec3 axis = normal_sum / axis_length;
+		float min_dot = 1.f;
+		for(uint32_t triangle : triangles){
+			glm::vec3 p0 = positions[indices[triangle * 3]];
+			glm::vec3 normal = glm::cross(positions[indices[triangle * 3 + 1]] - p0, positions[indices[triangle * 3 + 2]] - p0);
+			float length = glm::length(normal);
+			if(length > 0.f){
+				min_dot = std::min(min_dot, glm::dot(axis, normal / length));
+			}
+		}
+		// a cone of 90 degrees or wider always has a triangle facing the camera
+		meshlet.cone = glm::vec4(axis, min_dot > 0.f ? min_dot : -1.f);
+		return meshlet;
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace blikaengine{
+
+	// A small cluster of a mesh's triangles, culled as a whole
+	struct Meshlet{
+		// object space bounding sphere, xyz center, w radius
+		glm::vec4 sphere{};
+		// xyz average triangle normal, w cosine of the widest angle between it and any triangle normal.
+		// -1 when the triangles face too many ways to ever be all back facing at once
+		glm::vec4 cone{0.f, 0.f, 1.f, -1.f};
+		uint32_t first_index = 0;
+		uint32_t index_count = 0;
+	};
+
+	// Splits a triangle list into meshlets of at most MAX_VERTICES vertices and MAX_TRIANGLES triangles.
+	// Meshlets grow greedily over shared vertices, preferring triangles that add the fewest new ones,
+	// so they stay compact and their bounds tight.
+	class MeshletBuilder{
+		public:
+			static constexpr uint32_t MAX_VERTICES = 64;
+			static constexpr uint32_t MAX_TRIANGLES = 124;
+
+			// positions have to outlive the builder
+			MeshletBuilder(const std::vector<glm::vec3>& positions);
+
+			// reorders the first index_count indices meshlet by meshlet and returns the meshlets, their
+			// first_index relative to the start of indices
+			std::vector<Meshlet> build(std::vector<uint32_t>& indices, size_t index_count);
+
+		private:
+			void build_adjacency(const std::vector<uint32_t>& indices, size_t index_count);
+			Meshlet compute_bounds(const std::vector<uint32_t>& triangles, const std::vector<uint32_t>& indices) const;
+
+			const std::vector<glm::vec3>& positions;
+			// triangles around every vertex, offsets into adjacent_triangles
+			std::vector<uint32_t> adjacency_offsets;
+			std::vector<uint32_t> adjacent_triangles;
+	};
+}
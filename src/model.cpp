@@ -1,157 +1,150 @@
 #include "model.hpp"
-#include "blikaengine.hpp"
-#include "utils/utils.hpp"
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.hpp>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include "cooked_mesh.hpp"
 
 #include <cassert>
-#include <cstring>
-#include <unordered_map>
-#include <functional>
-#include <future>
-#include <thread>
-
-namespace std{
-	template<>
-	struct hash<blikaengine::Model::Vertex>{
-		size_t operator()(blikaengine::Model::Vertex const& vertex) const{
-			size_t seed = 0;
-			blikaengine::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
-		}
-	};
-}
+#include <cstddef>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
 
 namespace blikaengine{
-	
-	Model::Model(Device& device, const Model::Data& data) : device{device} {
-		create_vertex_buffers(data.vertices);
-		create_index_buffer(data.indices);
+
+	Model::Model(Device& device, const Model::View& view) : device{device} {
+		const uint32_t vertex_count = view.vertex_count;
+		assert(vertex_count >= 3 && "vertex count must be at least 3");
+		if(view.bounds.valid()){
+			bounds = view.bounds;
+			bounding_sphere = view.bounding_sphere;
+		}else{
+			assert(view.vertex_format == VertexFormat::Full && "packed vertices come with their bounds");
+			compute_vertex_bounds(static_cast<const Vertex*>(view.vertices), vertex_count, bounds, bounding_sphere);
+		}
+		const VertexFormat format = device.vertexFormat();
+		const void* vertices = view.vertices;
+		const void* positions = view.positions;
+		std::vector<char> packed{};
+		std::vector<char> packed_positions{};
+		if(view.vertex_format == format){
+			position_decode = view.position_decode;
+		}else if(view.vertex_format == VertexFormat::Full){
+			// meshes imported or built at runtime, mesh_cook packs cooked ones ahead of time
+			pack_vertices(static_cast<const Vertex*>(view.vertices), vertex_count, bounds, format, packed, packed_positions, position_decode);
+			vertices = packed.data();
+			positions = packed_positions.data();
+		}else{
+			throw std::runtime_error("mesh packed for another vertex format");
+		}
+		if(view.index_count == 0){
+			// every mesh goes through the indexed indirect path, unindexed ones get a trivial index list
+			std::vector<uint32_t> indices(vertex_count);
+			for(uint32_t i = 0; i < vertex_count; i++){
+				indices[i] = i;
+			}
+			mesh = device.meshPool().allocate(vertices, vertex_count, indices.data(), vertex_count, positions);
+		}else{
+			mesh = device.meshPool().allocate(vertices, vertex_count, view.indices, view.index_count, positions);
+		}
+		if(view.lod_count == 0){
+			lods.push_back({mesh.first_index, mesh.index_count, 0.f});
+		}else{
+			assert(view.lod_count <= MAX_LODS && "too many levels of detail");
+			for(uint32_t i = 0; i < view.lod_count; i++){
+				const Lod& lod = view.lods[i];
+				assert(lod.first_index + lod.index_count <= mesh.index_count && "level of detail outside of the indices");
+				lods.push_back({mesh.first_index + lod.first_index, lod.index_count, lod.error});
+			}
+		}
+		meshlets.assign(view.meshlets, view.meshlets + view.meshlet_count);
+		single_sided = view.single_sided;
+		for(Meshlet& meshlet : meshlets){
+			assert(meshlet.first_index + meshlet.index_count <= lods[0].index_count && "meshlet outside of the full detail level");
+			meshlet.first_index += mesh.first_index;
+		}
 	}
 
 	Model::~Model(){
+		device.meshPool().free(mesh);
 	}
 
 	std::unique_ptr<Model> Model::create_model_from_file(Device& device, const std::string& filepath){
+		namespace fs = std::filesystem;
+		const fs::path source{filepath};
+		fs::path cooked = source;
+		cooked.replace_extension(CookedMesh::EXTENSION);
+		std::error_code error{};
+		if(fs::exists(cooked, error) && (!fs::exists(source, error) || fs::last_write_time(cooked, error) >= fs::last_write_time(source, error))){
+			// a cooked mesh this build can't use is only an error without the obj to import instead
+			const bool has_source = source != cooked && fs::exists(source, error);
+			std::unique_ptr<CookedMesh> cooked_mesh{};
+			try{
+				cooked_mesh = std::make_unique<CookedMesh>(cooked.string());
+			}catch(const std::runtime_error& e){
+				if(!has_source){
+					throw;
+				}
+				std::cerr << "warning: " << e.what() << ", importing " << filepath << " instead\n";
+			}
+			if(cooked_mesh){
+				// full vertices are packed on upload, vertices packed for another format are of no use
+				const VertexFormat cooked_format = cooked_mesh->view().vertex_format;
+				if(cooked_format == device.vertexFormat() || cooked_format == VertexFormat::Full || !has_source){
+					return std::make_unique<Model>(device, cooked_mesh->view());
+				}
+				std::cerr << "warning: " << cooked.string() << " is cooked for another vertex format, importing " << filepath << " instead\n";
+			}
+		}
 		Data data{};
 		data.load_model(filepath);
 		return std::make_unique<Model>(device, data);
 	}
 
-	void Model::create_vertex_buffers(const std::vector<Vertex>& vertices){
-		vertex_count = static_cast<uint32_t>(vertices.size());
-		assert(vertex_count >= 3 && "vertex count must be at least 3");
-		uint32_t vertex_size = sizeof(vertices[0]);
-		VkDeviceSize buffer_size = vertex_size * vertex_count;
-		Buffer staging_buffer{device,vertex_size,vertex_count,VK_BUFFER_USAGE_TRANSFER_SRC_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-		staging_buffer.map();
-		staging_buffer.writeToBuffer((void*) vertices.data());
-		vertex_buffer = std::make_unique<Buffer>(device,vertex_size,vertex_count,VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		device.copyBuffer(staging_buffer.getBuffer(), vertex_buffer->getBuffer(), buffer_size);
-	}
-	
-	void Model::create_index_buffer(const std::vector<uint32_t>& indices){
-		index_count = static_cast<uint32_t>(indices.size());
-		has_index_buffer = index_count > 0;
-		if(!has_index_buffer){
-			return;
-		}
-		uint32_t index_size = sizeof(indices[0]);
-		VkDeviceSize buffer_size = index_size * index_count;
-		Buffer staging_buffer{device,index_size,index_count,VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-		staging_buffer.map();
-		staging_buffer.writeToBuffer((void*) indices.data());
-		index_buffer = std::make_unique<Buffer>(device,index_size,index_count,VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		device.copyBuffer(staging_buffer.getBuffer(), index_buffer->getBuffer(), buffer_size);
+	void Model::draw(VkCommandBuffer command_buffer, uint32_t instance_count, uint32_t first_instance, uint32_t lod){
+		vkCmdDrawIndexed(command_buffer, lods[lod].index_count, instance_count, lods[lod].first_index, mesh.vertex_offset, first_instance);
 	}
 
-	void Model::draw(VkCommandBuffer command_buffer){
-		if(has_index_buffer){
-			vkCmdDrawIndexed(command_buffer, index_count, 1, 0, 0, 0);
-		}else{
-			vkCmdDraw(command_buffer,vertex_count,1,0,0);
-		}
+	void Model::bind(VkCommandBuffer command_buffer){
+		device.meshPool().bind(command_buffer);
 	}
 
-	void Model::bind(VkCommandBuffer command_buffer){
-		VkBuffer buffers[] = {vertex_buffer->getBuffer()};
-		VkDeviceSize offsets[] = {0};
-		vkCmdBindVertexBuffers(command_buffer,0,1,buffers,offsets);
-		if(has_index_buffer){
-			vkCmdBindIndexBuffer(command_buffer, index_buffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32); //uint16 for light models maybe?
-		}
+	glm::mat4 Model::get_position_decode_matrix() const{
+		glm::mat4 decode{position_decode.w};
+		decode[3] = glm::vec4(glm::vec3(position_decode), 1.f);
+		return decode;
 	}
 
-	std::vector<VkVertexInputBindingDescription> Model::Vertex::get_binding_descriptions(){
+	std::vector<VkVertexInputBindingDescription> Model::get_binding_descriptions(VertexFormat format){
 		std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
 		binding_descriptions[0].binding = 0;
-		binding_descriptions[0].stride = sizeof(Vertex);
+		binding_descriptions[0].stride = get_vertex_layout(format).size;
 		binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		return binding_descriptions;
 	}
 
-	std::vector<VkVertexInputAttributeDescription> Model::Vertex::get_attribute_descriptions(){
+	std::vector<VkVertexInputAttributeDescription> Model::get_attribute_descriptions(VertexFormat format){
 		std::vector<VkVertexInputAttributeDescription> attribute_descriptions{};
 
-		attribute_descriptions.push_back({0,0,VK_FORMAT_R32G32B32_SFLOAT,offsetof(Vertex, position)});
-		attribute_descriptions.push_back({1,0,VK_FORMAT_R32G32B32_SFLOAT,offsetof(Vertex, color)});
-		attribute_descriptions.push_back({2,0,VK_FORMAT_R32G32B32_SFLOAT,offsetof(Vertex, normal)});
-		attribute_descriptions.push_back({3,0,VK_FORMAT_R32G32_SFLOAT,offsetof(Vertex, uv)});
+		if(format == VertexFormat::Full){
+			attribute_descriptions.push_back({0,0,VK_FORMAT_R32G32B32_SFLOAT,offsetof(Vertex, position)});
+			attribute_descriptions.push_back({1,0,VK_FORMAT_R32G32B32_SFLOAT,offsetof(Vertex, color)});
+			attribute_descriptions.push_back({2,0,VK_FORMAT_R32G32B32_SFLOAT,offsetof(Vertex, normal)});
+			attribute_descriptions.push_back({3,0,VK_FORMAT_R32G32_SFLOAT,offsetof(Vertex, uv)});
+			return attribute_descriptions;
+		}
+		attribute_descriptions.push_back({0,0,VK_FORMAT_R16G16B16A16_UNORM,offsetof(PackedVertex, position)});
+		// without colors the shader ignores location 1, it only has to be fed something
+		uint32_t color_offset = format == VertexFormat::Packed ? offsetof(PackedVertex, color) : 0;
+		attribute_descriptions.push_back({1,0,VK_FORMAT_R8G8B8A8_UNORM,color_offset});
+		attribute_descriptions.push_back({2,0,VK_FORMAT_R16G16_SNORM,offsetof(PackedVertex, normal)});
+		attribute_descriptions.push_back({3,0,VK_FORMAT_R16G16_SFLOAT,offsetof(PackedVertex, uv)});
 		return attribute_descriptions;
 	}
-	
-	void Model::Data::load_model(const std::string& filepath){
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		std::string warn, err;
 
-		if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())){
-			throw std::runtime_error(warn + err);
-		}
-		vertices.clear();
-		indices.clear();
-
-		std::unordered_map<Vertex, uint32_t> unique_vertices{};
-		for(const auto& shape : shapes){
-			for(const auto& index : shape.mesh.indices){
-				Vertex vertex{};
-				if(index.vertex_index >= 0){
-					vertex.position = {
-						attrib.vertices[3 * index.vertex_index + 0],
-						attrib.vertices[3 * index.vertex_index + 1],
-						attrib.vertices[3 * index.vertex_index + 2]
-					};
-					
-					vertex.color = {
-						attrib.colors[3 * index.vertex_index + 0],
-						attrib.colors[3 * index.vertex_index + 1],
-						attrib.colors[3 * index.vertex_index + 2]
-					};
-				}
-				if(index.normal_index >= 0){
-					vertex.normal = {
-						attrib.normals[3 * index.normal_index + 0],
-						attrib.normals[3 * index.normal_index + 1],
-						attrib.normals[3 * index.normal_index + 2]
-					};
-				}
-				if(index.texcoord_index >= 0){
-					vertex.uv = {
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						attrib.texcoords[2 * index.texcoord_index + 1]
-					};
-				}
+	std::vector<VkVertexInputBindingDescription> Model::get_position_binding_descriptions(VertexFormat format){
+		return {{0, get_vertex_layout(format).position_size, VK_VERTEX_INPUT_RATE_VERTEX}};
+	}
 
-				if(unique_vertices.count(vertex) == 0){
-					unique_vertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
-				}
-				indices.push_back(unique_vertices[vertex]);
-			}
-		}
+	std::vector<VkVertexInputAttributeDescription> Model::get_position_attribute_descriptions(VertexFormat format){
+		return {{0, 0, format == VertexFormat::Full ? VK_FORMAT_R32G32B32_SFLOAT : VK_FORMAT_R16G16B16A16_UNORM, 0}};
 	}
-}
\ No newline at end of file
+}
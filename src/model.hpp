@@ -1,64 +1,74 @@
 #pragma once
 
-#include "buffer.hpp"
+#include "bounds.hpp"
 #include "device.hpp"
+#include "mesh_pool.hpp"
+#include "meshlet_builder.hpp"
+#include "model_import.hpp"
+#include "vertex_format.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace blikaengine{
 
-	class Model{
+	class Model : public ModelImport{
 		public:
-			struct Vertex{
-				glm::vec3 position{};
-				glm::vec3 color{};
-				glm::vec3 normal{};
-				glm::vec2 uv{};
-
-				static std::vector<VkVertexInputBindingDescription> get_binding_descriptions();
-				static std::vector<VkVertexInputAttributeDescription> get_attribute_descriptions();
-
-				bool operator==(const Vertex& other)const{
-					return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
-				}
-			};
-
-			struct Data{
-				std::vector<Vertex> vertices{};
-				std::vector<uint32_t> indices{};
-
-				void load_model(const std::string& filepath);
-			};
-
-			Model(Device& device, const Model::Data& data);
+			// of the vertices in the mesh pool, which are PackedVertex unless format is Full
+			static std::vector<VkVertexInputBindingDescription> get_binding_descriptions(VertexFormat format = VertexFormat::Full);
+			static std::vector<VkVertexInputAttributeDescription> get_attribute_descriptions(VertexFormat format = VertexFormat::Full);
+			// of the mesh pool's position stream, location 0 only
+			static std::vector<VkVertexInputBindingDescription> get_position_binding_descriptions(VertexFormat format = VertexFormat::Full);
+			static std::vector<VkVertexInputAttributeDescription> get_position_attribute_descriptions(VertexFormat format = VertexFormat::Full);
+
+			Model(Device& device, const Model::View& view);
+			Model(Device& device, const Model::Data& data): Model(device, data.view()){}
 			~Model();
 			Model(const Model&) = delete;
 			Model& operator = (const Model&) = delete;
 			
 			void create_texture_image();
 
+			// maps the CookedMesh next to filepath when it is at least as new as the source (or filepath is
+			// one), otherwise imports filepath as an obj. So does a cooked mesh this build can't read or use,
+			// with a warning, unless there is no obj
 			static std::unique_ptr<Model> create_model_from_file(Device& device, const std::string& filepath);
 
+			// binds the shared mesh pool buffers, the same for every model
 			void bind(VkCommandBuffer command_buffer);
 
-			void draw(VkCommandBuffer command_buffer);
+			void draw(VkCommandBuffer command_buffer, uint32_t instance_count = 1, uint32_t first_instance = 0, uint32_t lod = 0);
+
+			const MeshPool::Mesh& get_mesh() const{ return mesh; }
+			uint32_t get_lod_count() const{ return static_cast<uint32_t>(lods.size()); }
+			// first_index is absolute in the mesh pool's index buffer
+			const Lod& get_lod(uint32_t lod) const{ return lods[lod]; }
+			// meshlets of the full detail level, first_index absolute like the levels'
+			const std::vector<Meshlet>& get_meshlets() const{ return meshlets; }
+			// whether back facing meshlets may be culled, the pipelines draw both sides
+			bool is_single_sided() const{ return single_sided; }
+			const AABB& get_bounds() const{ return bounds; }
+			// object space position of a pool vertex is xyz + w * its stored position, identity for
+			// VertexFormat::Full
+			const glm::vec4& get_position_decode() const{ return position_decode; }
+			// the same as a matrix, for shaders that only take a model matrix
+			glm::mat4 get_position_decode_matrix() const;
+			const BoundingSphere& get_bounding_sphere() const{ return bounding_sphere; }
 
 		private:
-			
-			void create_vertex_buffers(const std::vector<Vertex>& vertices);
-			void create_index_buffer(const std::vector<uint32_t>& indices);
-
 			Device& device;
-			std::unique_ptr<Buffer> vertex_buffer;
-			uint32_t vertex_count;
-			bool has_index_buffer = false;
-			std::unique_ptr<Buffer> index_buffer;
-			uint32_t index_count;
+			MeshPool::Mesh mesh{};
+			std::vector<Lod> lods{};
+			std::vector<Meshlet> meshlets{};
+			AABB bounds{};
+			BoundingSphere bounding_sphere{};
+			bool single_sided = false;
+			glm::vec4 position_decode{0.f, 0.f, 0.f, 1.f};
 
 	};
 }
\ No newline at end of file
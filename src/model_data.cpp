@@ -0,0 +1,300 @@
+#include "model_import.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
+#include "obj_parser.hpp"
+#include "vertex_welder.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace blikaengine{
+
+	namespace{
+		uint16_t to_unorm16(float value){
+			return static_cast<uint16_t>(std::lround(std::clamp(value, 0.f, 1.f) * 65535.f));
+		}
+
+		int16_t to_snorm16(float value){
+			return static_cast<int16_t>(std::lround(std::clamp(value, -1.f, 1.f) * 32767.f));
+		}
+
+		// the unit normal projected onto an octahedron, whose lower half is folded over the upper one.
+		// Zero normals stay zero
+		glm::vec2 octahedral_encode(const glm::vec3& normal){
+			float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+			if(length == 0.f){
+				return glm::vec2{0.f};
+			}
+			glm::vec2 encoded = glm::vec2{normal} / length;
+			if(normal.z < 0.f){
+				encoded = (1.f - glm::abs(glm::vec2{encoded.y, encoded.x})) * glm::vec2{encoded.x >= 0.f ? 1.f : -1.f, encoded.y >= 0.f ? 1.f : -1.f};
+			}
+			return encoded;
+		}
+	}
+
+	void ModelImport::compute_vertex_bounds(const Vertex* vertices, uint32_t vertex_count, AABB& bounds, BoundingSphere& sphere){
+		bounds = AABB{};
+		for(uint32_t i = 0; i < vertex_count; i++){
+			bounds.expand(vertices[i].position);
+		}
+		sphere.center = bounds.center();
+		float radius_squared = 0.f;
+		for(uint32_t i = 0; i < vertex_count; i++){
+			glm::vec3 offset = vertices[i].position - sphere.center;
+			radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+		}
+		sphere.radius = glm::sqrt(radius_squared);
+	}
+
+	ModelImport::PackedVertex ModelImport::PackedVertex::pack(const Vertex& vertex, const glm::vec4& position_decode){
+		PackedVertex packed{};
+		glm::vec3 position = (vertex.position - glm::vec3(position_decode)) / position_decode.w;
+		for(int i = 0; i < 3; i++){
+			packed.position[i] = to_unorm16(position[i]);
+		}
+		glm::vec2 normal = octahedral_encode(vertex.normal);
+		packed.normal[0] = to_snorm16(normal.x);
+		packed.normal[1] = to_snorm16(normal.y);
+		packed.uv[0] = glm::packHalf1x16(vertex.uv.x);
+		packed.uv[1] = glm::packHalf1x16(vertex.uv.y);
+		for(int i = 0; i < 3; i++){
+			packed.color[i] = static_cast<uint8_t>(std::lround(std::clamp(vertex.color[i], 0.f, 1.f) * 255.f));
+		}
+		packed.color[3] = 255;
+		return packed;
+	}
+
+	ModelImport::VertexLayout ModelImport::get_vertex_layout(VertexFormat format){
+		switch(format){
+			case VertexFormat::Full:
+				return {sizeof(Vertex), offsetof(Vertex, position), sizeof(glm::vec3)};
+			case VertexFormat::Packed:
+				return {sizeof(PackedVertex), offsetof(PackedVertex, position), sizeof(PackedVertex::position)};
+			case VertexFormat::PackedUncolored:
+				return {offsetof(PackedVertex, color), offsetof(PackedVertex, position), sizeof(PackedVertex::position)};
+		}
+		throw std::runtime_error("unknown vertex format");
+	}
+
+	void ModelImport::pack_vertices(const Vertex* vertices, uint32_t vertex_count, const AABB& bounds, VertexFormat format, std::vector<char>& packed, std::vector<char>& positions, glm::vec4& position_decode){
+		assert(format != VertexFormat::Full && "full vertices are not packed");
+		// one scale for all axes keeps the decode a similarity, normals need no correction
+		glm::vec3 extent = bounds.max - bounds.min;
+		float scale = std::max(extent.x, std::max(extent.y, extent.z));
+		position_decode = glm::vec4(bounds.min, scale > 0.f ? scale : 1.f);
+		const VertexLayout layout = get_vertex_layout(format);
+		packed.resize(static_cast<size_t>(vertex_count) * layout.size);
+		positions.resize(static_cast<size_t>(vertex_count) * layout.position_size);
+		bool colored = false;
+		for(uint32_t i = 0; i < vertex_count; i++){
+			PackedVertex vertex = PackedVertex::pack(vertices[i], position_decode);
+			std::memcpy(&packed[static_cast<size_t>(i) * layout.size], &vertex, layout.size);
+			std::memcpy(&positions[static_cast<size_t>(i) * layout.position_size], reinterpret_cast<const char*>(&vertex) + layout.position_offset, layout.position_size);
+			colored = colored || vertices[i].color != glm::vec3{1.f};
+		}
+		if(colored && format == VertexFormat::PackedUncolored){
+			std::cerr << "warning: the packed-uncolored vertex format drops the colors of a colored mesh, it is drawn white\n";
+		}
+	}
+
+	void ModelImport::Data::compute_bounds(){
+		compute_vertex_bounds(vertices.data(), static_cast<uint32_t>(vertices.size()), bounds, bounding_sphere);
+	}
+
+	ModelImport::View ModelImport::Data::view() const{
+		View view{};
+		view.vertex_format = vertex_format;
+		if(vertex_format == VertexFormat::Full){
+			view.vertices = vertices.data();
+		}else{
+			view.vertices = packed_vertices.data();
+			view.positions = packed_positions.data();
+			view.position_decode = position_decode;
+		}
+		view.vertex_count = static_cast<uint32_t>(vertices.size());
+		view.indices = indices.data();
+		view.index_count = static_cast<uint32_t>(indices.size());
+		view.lods = lods.data();
+		view.lod_count = static_cast<uint32_t>(lods.size());
+		view.meshlets = meshlets.data();
+		view.meshlet_count = static_cast<uint32_t>(meshlets.size());
+		view.bounds = bounds;
+		view.bounding_sphere = bounding_sphere;
+		view.single_sided = single_sided;
+		return view;
+	}
+
+	void ModelImport::Data::pack_vertices(VertexFormat format){
+		vertex_format = format;
+		packed_vertices.clear();
+		packed_positions.clear();
+		position_decode = glm::vec4{0.f, 0.f, 0.f, 1.f};
+		if(format != VertexFormat::Full){
+			ModelImport::pack_vertices(vertices.data(), static_cast<uint32_t>(vertices.size()), bounds, format, packed_vertices, packed_positions, position_decode);
+		}
+	}
+
+	void ModelImport::Data::find_single_sided(){
+		const size_t base_count = lods.empty() ? indices.size() : lods[0].index_count;
+		// vertices split at uv or normal seams are still one corner of the surface
+		std::vector<glm::vec3> corners{};
+		std::vector<uint32_t> corner_of(vertices.size());
+		VertexWelder<glm::vec3> welder{corners, vertices.size()};
+		for(size_t i = 0; i < vertices.size(); i++){
+			corner_of[i] = welder.weld(vertices[i].position);
+		}
+		// directed edges as from << 32 | to
+		std::vector<uint64_t> edges{};
+		edges.reserve(base_count);
+		for(size_t i = 0; i + 3 <= base_count; i += 3){
+			for(size_t j = 0; j < 3; j++){
+				const uint64_t from = corner_of[indices[i + j]];
+				const uint64_t to = corner_of[indices[i + (j + 1) % 3]];
+				edges.push_back(from << 32 | to);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		// closed and consistently wound: every edge is walked once in each direction
+		single_sided = !edges.empty();
+		for(size_t i = 0; i < edges.size() && single_sided; i++){
+			const uint64_t reversed = edges[i] << 32 | edges[i] >> 32;
+			const bool unique = i + 1 == edges.size() || edges[i + 1] != edges[i];
+			single_sided = unique && reversed != edges[i] && std::binary_search(edges.begin(), edges.end(), reversed);
+		}
+	}
+
+	void ModelImport::Data::generate_lods(){
+		// levels halving less than this are not worth their indices
+		constexpr float MIN_REDUCTION = .8f;
+		constexpr size_t MIN_LOD_INDICES = 3 * 64;
+		assert(lods.empty() && "levels of detail already generated");
+		const uint32_t base_count = static_cast<uint32_t>(indices.size());
+		lods.push_back({0, base_count, 0.f});
+		if(base_count < 2 * MIN_LOD_INDICES){
+			return;
+		}
+		std::vector<glm::vec3> positions(vertices.size());
+		for(size_t i = 0; i < vertices.size(); i++){
+			positions[i] = vertices[i].position;
+		}
+		MeshSimplifier simplifier{positions, indices};
+		// past a quarter of the model's size a level is nothing like the model anymore
+		const float max_error = .25f * bounding_sphere.radius;
+		size_t previous_count = base_count;
+		while(lods.size() < MAX_LODS && previous_count / 2 >= MIN_LOD_INDICES){
+			const std::vector<uint32_t>& simplified = simplifier.simplify(previous_count / 2, max_error);
+			if(simplified.size() > MIN_REDUCTION * previous_count){
+				break;
+			}
+			lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), simplifier.get_error()});
+			indices.insert(indices.end(), simplified.begin(), simplified.end());
+			previous_count = simplified.size();
+		}
+	}
+
+	void ModelImport::Data::optimize_triangles(){
+		std::vector<glm::vec3> positions(vertices.size());
+		for(size_t i = 0; i < vertices.size(); i++){
+			positions[i] = vertices[i].position;
+		}
+		MeshOptimizer optimizer{positions};
+		if(lods.empty()){
+			optimizer.optimize(indices.data(), indices.size());
+		}
+		for(const Lod& lod : lods){
+			optimizer.optimize(indices.data() + lod.first_index, lod.index_count);
+		}
+	}
+
+	void ModelImport::Data::build_meshlets(){
+		assert(meshlets.empty() && "meshlets already built");
+		// the full detail level is always first, the whole index list without levels
+		const size_t base_count = lods.empty() ? indices.size() : lods[0].index_count;
+		if(base_count < 3 * MIN_MESHLET_TRIANGLES){
+			return;
+		}
+		std::vector<glm::vec3> positions(vertices.size());
+		for(size_t i = 0; i < vertices.size(); i++){
+			positions[i] = vertices[i].position;
+		}
+		MeshletBuilder builder{positions};
+		meshlets = builder.build(indices, base_count);
+		// the builder grows meshlets in whatever order suits their shape, win back the cache within each
+		MeshOptimizer optimizer{positions};
+		for(const Meshlet& meshlet : meshlets){
+			optimizer.optimize_vertex_cache(indices.data() + meshlet.first_index, meshlet.index_count);
+		}
+	}
+
+	void ModelImport::Data::load_model(const std::string& filepath){
+		ObjParser parser{};
+		parser.parse(filepath);
+		const auto& positions = parser.get_positions();
+		const auto& colors = parser.get_colors();
+		const auto& normals = parser.get_normals();
+		const auto& texcoords = parser.get_texcoords();
+		vertices.clear();
+		indices.clear();
+		indices.reserve(parser.get_corners().size());
+
+		VertexWelder<Vertex> welder{vertices, parser.get_corners().size()};
+		for(const auto& corner : parser.get_corners()){
+			Vertex vertex{};
+			vertex.position = positions[corner.position];
+			vertex.color = colors[corner.position];
+			if(corner.normal >= 0){
+				vertex.normal = normals[corner.normal];
+			}
+			if(corner.texcoord >= 0){
+				vertex.uv = texcoords[corner.texcoord];
+			}
+			indices.push_back(welder.weld(vertex));
+		}
+		// triangles whose corners welded into fewer than three vertices cover nothing
+		size_t kept = 0;
+		for(size_t i = 0; i + 3 <= indices.size(); i += 3){
+			const uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+			if(a != b && b != c && c != a){
+				indices[kept++] = a;
+				indices[kept++] = b;
+				indices[kept++] = c;
+			}
+		}
+		indices.resize(kept);
+		source_cache = MeshOptimizer::analyze(indices.data(), indices.size(), vertices.size());
+		lods.clear();
+		meshlets.clear();
+		compute_bounds();
+		find_single_sided();
+		generate_lods();
+		optimize_triangles();
+		build_meshlets();
+		optimize_vertex_fetch();
+		imported_cache = MeshOptimizer::analyze(indices.data(), lods[0].index_count, vertices.size());
+	}
+
+	void ModelImport::Data::optimize_vertex_fetch(){
+		constexpr uint32_t UNUSED = ~0u;
+		std::vector<uint32_t> remap(vertices.size(), UNUSED);
+		std::vector<Vertex> reordered{};
+		reordered.reserve(vertices.size());
+		for(uint32_t& index : indices){
+			if(remap[index] == UNUSED){
+				remap[index] = static_cast<uint32_t>(reordered.size());
+				reordered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+		vertices = std::move(reordered);
+	}
+}
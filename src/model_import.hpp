@@ -0,0 +1,146 @@
+#pragma once
+
+#include "bounds.hpp"
+#include "mesh_optimizer.hpp"
+#include "meshlet_builder.hpp"
+#include "vertex_format.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blikaengine{
+
+	// Everything about a model up to its upload: vertex layouts, levels of detail, meshlets and the Data
+	// an import produces. Nothing here touches the renderer, so the mesh_cook tool builds without Vulkan;
+	// Model derives from it, the engine names all of it Model::. Implemented in model_data.cpp
+	class ModelImport{
+		public:
+			struct Vertex{
+				glm::vec3 position{};
+				glm::vec3 color{};
+				glm::vec3 normal{};
+				glm::vec2 uv{};
+
+				bool operator==(const Vertex& other)const{
+					return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
+				}
+			};
+
+			// Vertex quantized for VertexFormat::Packed, the shaders decode it. Positions are unorm within the
+			// model's bounds, see get_position_decode(), normals octahedral snorm, uvs half floats. Colors
+			// come last, PackedUncolored vertices are the first 16 bytes
+			struct PackedVertex{
+				uint16_t position[4];
+				int16_t normal[2];
+				uint16_t uv[2];
+				uint8_t color[4];
+
+				static PackedVertex pack(const Vertex& vertex, const glm::vec4& position_decode);
+			};
+			static_assert(sizeof(PackedVertex) == 20, "PackedVertex has to stay tightly packed");
+
+			// where the position sits within a vertex of the format, for the mesh pool
+			struct VertexLayout{
+				uint32_t size;
+				uint32_t position_offset;
+				uint32_t position_size;
+			};
+			static VertexLayout get_vertex_layout(VertexFormat format);
+
+			// one level of detail, a range of the model's indices into its shared vertices
+			struct Lod{
+				uint32_t first_index = 0;
+				uint32_t index_count = 0;
+				// object space distance from the full detail surface
+				float error = 0.f;
+			};
+
+			static constexpr uint32_t MAX_LODS = 6;
+			// meshes with fewer triangles are drawn whole, their meshlets would not pay for their draws
+			static constexpr uint32_t MIN_MESHLET_TRIANGLES = 8192;
+
+			// everything a model is built from, not owned. Arrays of zero count may be null
+			struct View{
+				// Vertex for Full, packed ones otherwise. Full vertices are packed on upload when the engine
+				// uses another format, packed ones have to be of the engine's format
+				VertexFormat vertex_format = VertexFormat::Full;
+				const void* vertices = nullptr;
+				uint32_t vertex_count = 0;
+				// the vertices' positions tightly packed for the mesh pool's position stream, extracted when null
+				const void* positions = nullptr;
+				// of packed vertices, see get_position_decode()
+				glm::vec4 position_decode{0.f, 0.f, 0.f, 1.f};
+				// a trivial index list is made up when there are none
+				const uint32_t* indices = nullptr;
+				uint32_t index_count = 0;
+				const Lod* lods = nullptr;
+				uint32_t lod_count = 0;
+				const Meshlet* meshlets = nullptr;
+				uint32_t meshlet_count = 0;
+				// a closed, consistently wound surface whose back faces can't be seen, see Data::single_sided
+				bool single_sided = false;
+				// computed from the vertices when invalid
+				AABB bounds{};
+				BoundingSphere bounding_sphere{};
+			};
+
+			// what importing a model produces, load_model() through optimize_vertex_fetch()
+			struct Data{
+				std::vector<Vertex> vertices{};
+				// every level of detail back to back, full detail first
+				std::vector<uint32_t> indices{};
+				// first_index relative to indices, a single level covering all of them when empty
+				std::vector<Lod> lods{};
+				// clusters of the full detail level, first_index relative to indices. Empty for small meshes
+				std::vector<Meshlet> meshlets{};
+				// object space bounds of the vertices, filled by load_model() / compute_bounds()
+				AABB bounds{};
+				BoundingSphere bounding_sphere{};
+				// every edge of the full detail level is shared by exactly two triangles wound against each
+				// other, so no back face is ever visible. Only then may back facing meshlets be culled, filled by
+				// load_model() / find_single_sided()
+				bool single_sided = false;
+				// the vertices in the layout of vertex_format and their position stream, filled by
+				// pack_vertices(). Empty for Full, whose layout is Vertex itself
+				VertexFormat vertex_format = VertexFormat::Full;
+				std::vector<char> packed_vertices{};
+				std::vector<char> packed_positions{};
+				glm::vec4 position_decode{0.f, 0.f, 0.f, 1.f};
+				// vertex cache behaviour of the full detail level in source order and as imported, for reports
+				VertexCacheStatistics source_cache{};
+				VertexCacheStatistics imported_cache{};
+
+				void load_model(const std::string& filepath);
+				void compute_bounds();
+				// run on full detail indices only, vertices split at seams count as one corner
+				void find_single_sided();
+				// appends simplified levels, each about half the triangles of the one before, to the
+				// indices. Run on full detail indices only, after compute_bounds()
+				void generate_lods();
+				// reorders the triangles of every level for the post transform cache and overdraw, see
+				// MeshOptimizer. After generate_lods()
+				void optimize_triangles();
+				// reorders the full detail indices into meshlets when there are at least MIN_MESHLET_TRIANGLES,
+				// after optimize_triangles()
+				void build_meshlets();
+				// renumbers the vertices in order of first use, so vertex fetches walk the buffer forwards, and
+				// drops unreferenced ones. Runs last, after build_meshlets()
+				void optimize_vertex_fetch();
+				// packs the vertices for format, so cooking can store them as the engine uploads them. After
+				// optimize_vertex_fetch(), the vertices stay for reports
+				void pack_vertices(VertexFormat format);
+				View view() const;
+			};
+
+		protected:
+			// box around all vertices, sphere centered on the box with the farthest vertex on its surface
+			static void compute_vertex_bounds(const Vertex* vertices, uint32_t vertex_count, AABB& bounds, BoundingSphere& sphere);
+			// vertices in the packed format and their position stream, quantized within bounds
+			static void pack_vertices(const Vertex* vertices, uint32_t vertex_count, const AABB& bounds, VertexFormat format, std::vector<char>& packed, std::vector<char>& positions, glm::vec4& position_decode);
+	};
+}
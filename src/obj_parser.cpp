@@ -0,0 +1,389 @@
+#include "obj_parser.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace blikaengine{
+
+	namespace{
+		bool is_space(char c){
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		bool is_digit(char c){
+			return c >= '0' && c <= '9';
+		}
+
+		void skip_spaces(const char*& p, const char* end){
+			while(p < end && is_space(*p)){
+				p++;
+			}
+		}
+
+		// decimal float with optional exponent, leaves p untouched and value 0 if there is none
+		bool parse_float(const char*& p, const char* end, float& value){
+			// every power up to 1e22 is exact in a double, so scaling by one only rounds once
+			static constexpr double POWERS_OF_TEN[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+			constexpr int MAX_DIGITS = 19;
+			skip_spaces(p, end);
+			const char* start = p;
+			bool negative = false;
+			if(p < end && (*p == '-' || *p == '+')){
+				negative = *p == '-';
+				p++;
+			}
+			uint64_t mantissa = 0;
+			int digits = 0;
+			int exponent = 0;
+			bool any_digit = false;
+			for(; p < end && is_digit(*p); p++){
+				if(digits < MAX_DIGITS){
+					mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+					digits += mantissa != 0;
+				}else{
+					exponent++;
+				}
+				any_digit = true;
+			}
+			if(p < end && *p == '.'){
+				for(p++; p < end && is_digit(*p); p++){
+					if(digits < MAX_DIGITS){
+						mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+						digits += mantissa != 0;
+						exponent--;
+					}
+					any_digit = true;
+				}
+			}
+			if(!any_digit){
+				p = start;
+				value = 0.f;
+				return false;
+			}
+			if(p < end && (*p == 'e' || *p == 'E')){
+				const char* e = p++;
+				bool negative_exponent = false;
+				if(p < end && (*p == '-' || *p == '+')){
+					negative_exponent = *p == '-';
+					p++;
+				}
+				if(p < end && is_digit(*p)){
+					int exponent_value = 0;
+					for(; p < end && is_digit(*p); p++){
+						exponent_value = std::min(exponent_value * 10 + (*p - '0'), 10000);
+					}
+					exponent += negative_exponent ? -exponent_value : exponent_value;
+				}else{
+					p = e;
+				}
+			}
+			double result = static_cast<double>(mantissa);
+			if(mantissa != 0 && exponent != 0){
+				if(exponent > 0 && exponent <= 22){
+					result *= POWERS_OF_TEN[exponent];
+				}else if(exponent < 0 && exponent >= -22){
+					result /= POWERS_OF_TEN[-exponent];
+				}else{
+					result *= std::pow(10., exponent);
+				}
+			}
+			value = static_cast<float>(negative ? -result : result);
+			return true;
+		}
+
+		// a face index as written, 1 based or negative relative to the last element so far
+		bool parse_index(const char*& p, const char* end, int64_t& value){
+			bool negative = false;
+			if(p < end && (*p == '-' || *p == '+')){
+				negative = *p == '-';
+				p++;
+			}
+			if(p >= end || !is_digit(*p)){
+				return false;
+			}
+			value = 0;
+			for(; p < end && is_digit(*p); p++){
+				value = std::min<int64_t>(value * 10 + (*p - '0'), std::numeric_limits<int32_t>::max());
+			}
+			if(negative){
+				value = -value;
+			}
+			return true;
+		}
+
+		// 0 based index of a face index, count elements have been read before it
+		int32_t resolve_index(int64_t index, uint32_t count){
+			if(index > 0){
+				return static_cast<int32_t>(index - 1);
+			}
+			if(index < 0 && -index <= count){
+				return static_cast<int32_t>(count + index);
+			}
+			throw std::runtime_error("invalid obj face index");
+		}
+
+		enum class LineType{ Other, Position, Normal, Texcoord, Face };
+
+		// moves p past the keyword
+		LineType line_type(const char*& p, const char* end){
+			skip_spaces(p, end);
+			if(end - p < 2){
+				return LineType::Other;
+			}
+			if(p[0] == 'f' && is_space(p[1])){
+				p += 2;
+				return LineType::Face;
+			}
+			if(p[0] != 'v'){
+				return LineType::Other;
+			}
+			if(is_space(p[1])){
+				p += 2;
+				return LineType::Position;
+			}
+			if(end - p < 3 || !is_space(p[2])){
+				return LineType::Other;
+			}
+			LineType type = p[1] == 'n' ? LineType::Normal : p[1] == 't' ? LineType::Texcoord : LineType::Other;
+			if(type != LineType::Other){
+				p += 3;
+			}
+			return type;
+		}
+
+		const char* line_end(const char* p, const char* end){
+			const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+			return newline == nullptr ? end : newline;
+		}
+	}
+
+	ObjParser::ObjParser(uint32_t thread_count): thread_count{thread_count}{
+		if(this->thread_count == 0){
+			this->thread_count = std::max(1u, std::thread::hardware_concurrency());
+		}
+	}
+
+	template<typename Task>
+	void ObjParser::for_each_range(Task&& task){
+		std::vector<std::future<void>> futures{};
+		for(size_t i = 1; i < ranges.size(); i++){
+			futures.push_back(std::async(std::launch::async, [&, i]{ task(ranges[i]); }));
+		}
+		std::exception_ptr error{};
+		try{
+			task(ranges[0]);
+		}catch(...){
+			error = std::current_exception();
+		}
+		// every task has to finish before the ranges go away, even if one failed
+		for(auto& future : futures){
+			try{
+				future.get();
+			}catch(...){
+				if(!error){
+					error = std::current_exception();
+				}
+			}
+		}
+		if(error){
+			std::rethrow_exception(error);
+		}
+	}
+
+	void ObjParser::parse(const std::string& filepath){
+		std::ifstream file{filepath, std::ios::ate | std::ios::binary};
+		if(!file.is_open()){
+			throw std::runtime_error("could not open file: " + filepath);
+		}
+		size_t file_size = static_cast<size_t>(file.tellg());
+		std::vector<char> text(file_size);
+		file.seekg(0);
+		file.read(text.data(), static_cast<std::streamsize>(file_size));
+		if(!file){
+			throw std::runtime_error("could not read file: " + filepath);
+		}
+		try{
+			parse(text.data(), text.size());
+		}catch(const std::runtime_error& e){
+			throw std::runtime_error(std::string{e.what()} + ": " + filepath);
+		}
+	}
+
+	void ObjParser::parse(const char* text, size_t size){
+		const size_t range_count = std::max<size_t>(1, std::min<size_t>(thread_count, size / MIN_RANGE_SIZE));
+		const char* text_end = text + size;
+		ranges.clear();
+		ranges.resize(range_count);
+		const char* begin = text;
+		for(size_t i = 0; i < range_count; i++){
+			// ranges end after the newline following their share of the text
+			const char* end = i + 1 == range_count ? text_end : std::max(begin, text + size * (i + 1) / range_count);
+			end = std::min(line_end(end, text_end) + 1, text_end);
+			ranges[i].begin = begin;
+			ranges[i].end = end;
+			begin = end;
+		}
+
+		for_each_range([this](Range& range){ count_lines(range); });
+		uint64_t position_count = 0, normal_count = 0, texcoord_count = 0;
+		for(Range& range : ranges){
+			range.first_position = static_cast<uint32_t>(position_count);
+			range.first_normal = static_cast<uint32_t>(normal_count);
+			range.first_texcoord = static_cast<uint32_t>(texcoord_count);
+			position_count += range.position_count;
+			normal_count += range.normal_count;
+			texcoord_count += range.texcoord_count;
+		}
+		if(std::max({position_count, normal_count, texcoord_count}) > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())){
+			throw std::runtime_error("obj has too many vertices");
+		}
+		positions.resize(position_count);
+		colors.resize(position_count);
+		normals.resize(normal_count);
+		texcoords.resize(texcoord_count);
+
+		for_each_range([this](Range& range){ parse_lines(range); });
+		size_t triangle_count = 0;
+		for(Range& range : ranges){
+			range.first_triangle = triangle_count;
+			triangle_count += range.triangle_count;
+		}
+		corners.resize(3 * triangle_count);
+
+		for_each_range([this](Range& range){ triangulate(range); });
+		ranges.clear();
+	}
+
+	void ObjParser::count_lines(Range& range) const{
+		for(const char* p = range.begin; p < range.end;){
+			const char* end = line_end(p, range.end);
+			switch(line_type(p, end)){
+				case LineType::Position: range.position_count++; break;
+				case LineType::Normal: range.normal_count++; break;
+				case LineType::Texcoord: range.texcoord_count++; break;
+				default: break;
+			}
+			p = end + 1;
+		}
+	}
+
+	void ObjParser::parse_lines(Range& range){
+		uint32_t position_index = range.first_position;
+		uint32_t normal_index = range.first_normal;
+		uint32_t texcoord_index = range.first_texcoord;
+		for(const char* p = range.begin; p < range.end;){
+			const char* end = line_end(p, range.end);
+			switch(line_type(p, end)){
+				case LineType::Position:{
+					glm::vec3& position = positions[position_index];
+					parse_float(p, end, position.x);
+					parse_float(p, end, position.y);
+					parse_float(p, end, position.z);
+					glm::vec3 color{};
+					if(parse_float(p, end, color.r) && parse_float(p, end, color.g) && parse_float(p, end, color.b)){
+						colors[position_index] = color;
+					}else{
+						colors[position_index] = glm::vec3{1.f};
+					}
+					position_index++;
+					break;
+				}
+				case LineType::Normal:{
+					glm::vec3& normal = normals[normal_index++];
+					parse_float(p, end, normal.x);
+					parse_float(p, end, normal.y);
+					parse_float(p, end, normal.z);
+					break;
+				}
+				case LineType::Texcoord:{
+					glm::vec2& texcoord = texcoords[texcoord_index++];
+					parse_float(p, end, texcoord.x);
+					parse_float(p, end, texcoord.y);
+					break;
+				}
+				case LineType::Face:{
+					uint32_t size = 0;
+					for(skip_spaces(p, end); p < end; skip_spaces(p, end)){
+						// v, v/vt, v//vn or v/vt/vn
+						Corner corner{};
+						int64_t index = 0;
+						if(!parse_index(p, end, index)){
+							throw std::runtime_error("invalid obj face");
+						}
+						corner.position = resolve_index(index, position_index);
+						if(p < end && *p == '/'){
+							p++;
+							if(p < end && *p != '/'){
+								if(!parse_index(p, end, index)){
+									throw std::runtime_error("invalid obj face");
+								}
+								corner.texcoord = resolve_index(index, texcoord_index);
+							}
+							if(p < end && *p == '/'){
+								p++;
+								if(!parse_index(p, end, index)){
+									throw std::runtime_error("invalid obj face");
+								}
+								corner.normal = resolve_index(index, normal_index);
+							}
+						}
+						if(p < end && !is_space(*p)){
+							throw std::runtime_error("invalid obj face");
+						}
+						range.polygon_corners.push_back(corner);
+						size++;
+					}
+					if(size < 3){
+						// degenerate, nothing to draw
+						range.polygon_corners.resize(range.polygon_corners.size() - size);
+					}else{
+						range.polygon_sizes.push_back(size);
+						range.triangle_count += size - 2;
+					}
+					break;
+				}
+				default: break;
+			}
+			p = end + 1;
+		}
+	}
+
+	void ObjParser::triangulate(Range& range){
+		for(const Corner& corner : range.polygon_corners){
+			if(static_cast<size_t>(corner.position) >= positions.size() || corner.normal >= static_cast<int64_t>(normals.size())
+				|| corner.texcoord >= static_cast<int64_t>(texcoords.size())){
+				throw std::runtime_error("obj face index out of range");
+			}
+		}
+		Corner* out = corners.data() + 3 * range.first_triangle;
+		const Corner* polygon = range.polygon_corners.data();
+		for(uint32_t size : range.polygon_sizes){
+			if(size == 4){
+				// split along the shorter diagonal, the flatter of the two pairs of triangles
+				glm::vec3 diagonal02 = positions[polygon[2].position] - positions[polygon[0].position];
+				glm::vec3 diagonal13 = positions[polygon[3].position] - positions[polygon[1].position];
+				static constexpr uint32_t SPLIT02[] = {0, 1, 2, 0, 2, 3};
+				static constexpr uint32_t SPLIT13[] = {0, 1, 3, 1, 2, 3};
+				const uint32_t* order = glm::dot(diagonal02, diagonal02) < glm::dot(diagonal13, diagonal13) ? SPLIT02 : SPLIT13;
+				for(uint32_t i = 0; i < 6; i++){
+					*out++ = polygon[order[i]];
+				}
+			}else{
+				for(uint32_t i = 2; i < size; i++){
+					*out++ = polygon[0];
+					*out++ = polygon[i - 1];
+					*out++ = polygon[i];
+				}
+			}
+			polygon += size;
+		}
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blikaengine{
+
+	// Multi threaded Wavefront obj geometry parser. The file is split into one range of whole lines per
+	// thread; a quick first pass counts the v/vn/vt lines of every range so each range knows where its
+	// attributes start, then every range parses straight into the shared attribute arrays and collects
+	// its own faces, which are triangulated and concatenated in file order. The result does not depend
+	// on the number of threads.
+	//
+	// Only geometry is read: groups, objects, materials and smoothing groups are skipped, every face
+	// ends up in one triangle list. Quads are split along their shorter diagonal, larger polygons are
+	// fanned. Vertex colors (v x y z r g b) default to white.
+	class ObjParser{
+		public:
+			// one corner of a triangle, indices into the attribute arrays, -1 where the face has none
+			struct Corner{
+				int32_t position = -1;
+				int32_t normal = -1;
+				int32_t texcoord = -1;
+			};
+
+			// ranges smaller than this are not worth a thread
+			static constexpr size_t MIN_RANGE_SIZE = 1024 * 1024;
+
+			// 0 uses every hardware thread
+			ObjParser(uint32_t thread_count = 0);
+
+			// throws if the file can't be read or a face indexes a vertex, normal or uv that doesn't exist
+			void parse(const std::string& filepath);
+			void parse(const char* text, size_t size);
+
+			const std::vector<glm::vec3>& get_positions() const{ return positions; }
+			// one per position
+			const std::vector<glm::vec3>& get_colors() const{ return colors; }
+			const std::vector<glm::vec3>& get_normals() const{ return normals; }
+			const std::vector<glm::vec2>& get_texcoords() const{ return texcoords; }
+			// three per triangle
+			const std::vector<Corner>& get_corners() const{ return corners; }
+
+		private:
+			// a range of whole lines and everything parsed from it
+			struct Range{
+				const char* begin;
+				const char* end;
+				// counts of the range's v/vn/vt lines, then where they start in the attribute arrays
+				uint32_t position_count = 0;
+				uint32_t normal_count = 0;
+				uint32_t texcoord_count = 0;
+				uint32_t first_position = 0;
+				uint32_t first_normal = 0;
+				uint32_t first_texcoord = 0;
+				// the corners of every face, polygon_sizes[i] of them per face
+				std::vector<Corner> polygon_corners{};
+				std::vector<uint32_t> polygon_sizes{};
+				size_t triangle_count = 0;
+				size_t first_triangle = 0;
+			};
+
+			// runs task(range) for every range, one thread each, and rethrows the first exception
+			template<typename Task>
+			void for_each_range(Task&& task);
+
+			void count_lines(Range& range) const;
+			void parse_lines(Range& range);
+			void triangulate(Range& range);
+
+			uint32_t thread_count;
+			std::vector<Range> ranges{};
+			std::vector<glm::vec3> positions{};
+			std::vector<glm::vec3> colors{};
+			std::vector<glm::vec3> normals{};
+			std::vector<glm::vec2> texcoords{};
+			std::vector<Corner> corners{};
+	};
+}
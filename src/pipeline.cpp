@@ -47,7 +47,17 @@ namespace blikaengine{
 		shader_stages[0].pName = "main";
 		shader_stages[0].flags = 0;
 		shader_stages[0].pNext = nullptr;
-		shader_stages[0].pSpecializationInfo = nullptr;
+		// vertex_constants[i] is the vertex shader's constant_id i
+		std::vector<VkSpecializationMapEntry> vertex_constant_entries(config_info.vertex_constants.size());
+		for(uint32_t i = 0; i < vertex_constant_entries.size(); i++){
+			vertex_constant_entries[i] = {i, i * static_cast<uint32_t>(sizeof(uint32_t)), sizeof(uint32_t)};
+		}
+		VkSpecializationInfo vertex_specialization{};
+		vertex_specialization.mapEntryCount = static_cast<uint32_t>(vertex_constant_entries.size());
+		vertex_specialization.pMapEntries = vertex_constant_entries.data();
+		vertex_specialization.dataSize = config_info.vertex_constants.size() * sizeof(uint32_t);
+		vertex_specialization.pData = config_info.vertex_constants.data();
+		shader_stages[0].pSpecializationInfo = config_info.vertex_constants.empty() ? nullptr : &vertex_specialization;
 		shader_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 		shader_stages[1].module = frag_shader_module;
@@ -166,8 +176,8 @@ namespace blikaengine{
 		config_info.dynamic_state_info.dynamicStateCount = static_cast<uint32_t>(config_info.dynamic_state_enables.size());
 		config_info.dynamic_state_info.flags = 0;
 
-		config_info.attribute_descriptions = Model::Vertex::get_attribute_descriptions();
-		config_info.binding_descriptions = Model::Vertex::get_binding_descriptions();
+		config_info.attribute_descriptions = Model::get_attribute_descriptions();
+		config_info.binding_descriptions = Model::get_binding_descriptions();
 	}
 
 	void Pipeline::enable_alpha_blending(PipelineConfigInfo& config_info){
@@ -181,4 +191,63 @@ namespace blikaengine{
 		config_info.color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
 	}
 
-}
\ No newline at end of file
+	void Pipeline::enable_weighted_blending(PipelineConfigInfo& config_info){
+		// premultiplied color and coverage, weighted by the shader, summed
+		VkPipelineColorBlendAttachmentState& accum = config_info.weighted_blend_attachments[0];
+		accum.blendEnable = VK_TRUE;
+		accum.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		accum.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		accum.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		accum.colorBlendOp = VK_BLEND_OP_ADD;
+		accum.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		accum.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		accum.alphaBlendOp = VK_BLEND_OP_ADD;
+		// product of (1 - coverage)
+		VkPipelineColorBlendAttachmentState& revealage = config_info.weighted_blend_attachments[1];
+		revealage.blendEnable = VK_TRUE;
+		revealage.colorWriteMask = VK_COLOR_COMPONENT_R_BIT;
+		revealage.srcColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+		revealage.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+		revealage.colorBlendOp = VK_BLEND_OP_ADD;
+		revealage.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		revealage.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		revealage.alphaBlendOp = VK_BLEND_OP_ADD;
+		config_info.color_blend_info.attachmentCount = static_cast<uint32_t>(config_info.weighted_blend_attachments.size());
+		config_info.color_blend_info.pAttachments = config_info.weighted_blend_attachments.data();
+		config_info.depth_stencil_info.depthWriteEnable = VK_FALSE;
+	}
+
+	ComputePipeline::ComputePipeline(Device& device, const std::string& comp_filepath, VkPipelineLayout pipeline_layout) : device{device} {
+		assert(pipeline_layout != VK_NULL_HANDLE && "cannot create compute pipeline: no pipeline_layout provided");
+		auto comp_code = Pipeline::read_file(comp_filepath);
+		VkShaderModuleCreateInfo module_info{};
+		module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		module_info.codeSize = comp_code.size();
+		module_info.pCode = reinterpret_cast<const uint32_t*>(comp_code.data());
+		if(vkCreateShaderModule(device.device(), &module_info, nullptr, &comp_shader_module) != VK_SUCCESS){
+			throw std::runtime_error("failed to create shader module");
+		}
+
+		VkComputePipelineCreateInfo pipeline_info{};
+		pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipeline_info.stage.module = comp_shader_module;
+		pipeline_info.stage.pName = "main";
+		pipeline_info.layout = pipeline_layout;
+		pipeline_info.basePipelineIndex = -1;
+		pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+		if(vkCreateComputePipelines(device.device(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &compute_pipeline) != VK_SUCCESS){
+			throw std::runtime_error("failed to create compute pipeline");
+		}
+	}
+
+	ComputePipeline::~ComputePipeline(){
+		vkDestroyShaderModule(device.device(), comp_shader_module, nullptr);
+		vkDestroyPipeline(device.device(), compute_pipeline, nullptr);
+	}
+
+	void ComputePipeline::bind(VkCommandBuffer command_buffer){
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline);
+	}
+}
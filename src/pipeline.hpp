@@ -2,6 +2,7 @@
 
 #include "device.hpp"
 
+#include <array>
 #include <string>
 #include <vector>
 
@@ -14,12 +15,16 @@ namespace blikaengine{
 
 		std::vector<VkVertexInputBindingDescription> binding_descriptions{};
 		std::vector<VkVertexInputAttributeDescription> attribute_descriptions{};
+		// specialization constants of the vertex shader, element i is constant_id i
+		std::vector<uint32_t> vertex_constants{};
 
 		VkPipelineViewportStateCreateInfo viewport_info;
 		VkPipelineInputAssemblyStateCreateInfo input_assembly_info;
 		VkPipelineRasterizationStateCreateInfo rasterization_info;
 		VkPipelineMultisampleStateCreateInfo multisample_info;
 		VkPipelineColorBlendAttachmentState color_blend_attachment;
+		// accumulation and revealage, see enable_weighted_blending()
+		std::array<VkPipelineColorBlendAttachmentState, 2> weighted_blend_attachments{};
 		VkPipelineColorBlendStateCreateInfo color_blend_info;
 		VkPipelineDepthStencilStateCreateInfo depth_stencil_info;
 		std::vector<VkDynamicState> dynamic_state_enables;
@@ -42,9 +47,12 @@ namespace blikaengine{
 			
 			static void default_pipeline_config_info(PipelineConfigInfo& configInfo);
 			static void enable_alpha_blending(PipelineConfigInfo& configInfo);
+			// order independent transparency: writes the swap chain's accumulation and revealage targets in its
+			// transparent subpass, without writing depth
+			static void enable_weighted_blending(PipelineConfigInfo& configInfo);
+			static std::vector<char> read_file(const std::string& file_path);
 
 		private:
-			static std::vector<char> read_file(const std::string& file_path);
 			void create_graphics_pipeline(const std::string& vert_filepath, const std::string& frag_filepath, const PipelineConfigInfo& config_info);
 
 			void create_shader_module(const std::vector<char>& code, VkShaderModule* shader_module);
@@ -54,4 +62,20 @@ namespace blikaengine{
 			VkShaderModule vert_shader_module;
 			VkShaderModule frag_shader_module;
 	};
+
+	class ComputePipeline{
+		public:
+			ComputePipeline(Device& device, const std::string& comp_filepath, VkPipelineLayout pipeline_layout);
+			~ComputePipeline();
+
+			ComputePipeline(const ComputePipeline&) = delete;
+			ComputePipeline& operator = (const ComputePipeline&) = delete;
+
+			void bind(VkCommandBuffer command_buffer);
+
+		private:
+			Device& device;
+			VkPipeline compute_pipeline;
+			VkShaderModule comp_shader_module;
+	};
 }
\ No newline at end of file
@@ -1,78 +1,591 @@
 #include "master_render_system.hpp"
 #include "blikaengine.hpp"
+#include "swap_chain.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
 #include <vector>
 
 namespace blikaengine{
 	
-	struct SimplePushConstantData{
+	// matches ObjectData in master_shader.vert and cull.comp (std430)
+	struct ObjectData{
 		glm::mat4 model_matrix{1.f};
 		glm::mat4 normal_matrix{1.f};
+		glm::vec4 bounds_min{};
+		glm::vec4 bounds_max{};
+		// the model's Model::get_position_decode()
+		glm::vec4 position_decode{0.f, 0.f, 0.f, 1.f};
+		uint32_t batch;
+		uint32_t padding[3];
 	};
+
+	// matches Batch in cull.comp and cull_compact.comp (std430)
+	struct BatchData{
+		uint32_t index_count;
+		uint32_t first_index;
+		int32_t vertex_offset;
+		uint32_t first_instance;
+		// object space error of this level, and the number of levels of its model
+		float lod_error;
+		uint32_t lod_count;
+		// meshlets drawn instead of the whole batch, count 0 for batches drawn whole
+		uint32_t first_meshlet;
+		uint32_t meshlet_count;
+	};
+	static_assert(sizeof(BatchData) == 32, "BatchData has to match the std430 stride of Batch");
+
+	// matches Meshlet in cluster_cull.comp (std430)
+	struct MeshletData{
+		glm::vec4 sphere;
+		glm::vec4 cone;
+		uint32_t first_index;
+		uint32_t index_count;
+		uint32_t padding[2];
+	};
+
+	// matches CullUbo in cull.comp (std140)
+	struct CullUbo{
+		glm::vec4 frustum_planes[6];
+		glm::mat4 pyramid_view_projection{1.f};
+		// xyz camera position, w lod_pixel_scale()
+		glm::vec4 lod_params{};
+		glm::vec2 depth_size{};
+		uint32_t object_count;
+		uint32_t batch_count;
+		uint32_t pyramid_levels;
+		uint32_t flags;
+	};
+
+	// CullUbo::flags
+	constexpr uint32_t OCCLUSION_CULLING = 1;
+	constexpr uint32_t COMPACT_DRAWS = 2;
 	
-	MasterRenderSystem::MasterRenderSystem(Device& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout): device{device}{
-		create_pipeline_layout(global_set_layout);
-		create_pipeline(render_pass);
+	MasterRenderSystem::MasterRenderSystem(Device& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout, VkDescriptorSetLayout light_set_layout, VkDescriptorSetLayout shadow_set_layout, bool depth_prepass): device{device}{
+		const OptionalFeatures& features = device.optionalFeatures();
+		gpu_culling = features.drawIndirectFirstInstance;
+		meshlet_culling = gpu_culling && features.multiDrawIndirect && features.drawIndirectCount;
+		create_frame_resources();
+		create_pipeline_layout(global_set_layout, light_set_layout, shadow_set_layout);
+		create_pipeline(render_pass, depth_prepass);
+		if(gpu_culling){
+			create_cull_pipelines();
+		}
 	}
 	
 	MasterRenderSystem::~MasterRenderSystem(){
 		vkDestroyPipelineLayout(device.device(), pipeline_layout, nullptr);
+		if(cull_pipeline_layout != VK_NULL_HANDLE){
+			vkDestroyPipelineLayout(device.device(), cull_pipeline_layout, nullptr);
+		}
+	}
+
+	void MasterRenderSystem::create_frame_resources(){
+		instance_set_layout = DescriptorSetLayout::Builder(device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+			.build();
+		instance_pool = DescriptorPool::Builder(device)
+			.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * SwapChain::MAX_FRAMES_IN_FLIGHT)
+			.build();
+		if(gpu_culling){
+			cull_set_layout = DescriptorSetLayout::Builder(device)
+				.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(11, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(12, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.addBinding(13, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+				.build();
+			cull_pool = DescriptorPool::Builder(device)
+				.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+				.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+				.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 12 * SwapChain::MAX_FRAMES_IN_FLIGHT)
+				.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+				.build();
+		}
+		frames.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	}
+
+	// only ever called for the frame being recorded, whose previous submission has already completed
+	bool MasterRenderSystem::reserve(std::unique_ptr<Buffer>& buffer, VkDeviceSize element_size, uint32_t count, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_properties){
+		count = std::max(count, 1u);
+		if(buffer && buffer->getInstanceCount() >= count){
+			return false;
+		}
+		uint32_t capacity = buffer ? std::max(count, buffer->getInstanceCount() * 2) : count;
+		buffer = std::make_unique<Buffer>(device, element_size, capacity, usage, memory_properties);
+		if(memory_properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT){
+			buffer->map();
+		}
+		return true;
 	}
 
-	void MasterRenderSystem::create_pipeline_layout(VkDescriptorSetLayout global_set_layout){
-		
-		VkPushConstantRange push_constant_range{};
-		push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		push_constant_range.offset = 0;
-		push_constant_range.size = sizeof(SimplePushConstantData);
+	void MasterRenderSystem::reserve_frame(FrameResources& frame, uint32_t object_count){
+		const VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		const VkMemoryPropertyFlags local = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		const uint32_t batch_count = static_cast<uint32_t>(batches.size());
+		bool objects_changed = reserve(frame.objects, sizeof(ObjectData), object_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, host);
+		bool changed = objects_changed;
+		// the cpu path writes the instances itself
+		changed |= reserve(frame.instances, sizeof(uint32_t), instance_capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, gpu_culling ? local : host);
+		if(gpu_culling){
+			objects_changed |= reserve(frame.batches, sizeof(BatchData), batch_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, host);
+			changed |= objects_changed;
+			changed |= reserve(frame.counters, sizeof(uint32_t), batch_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, local);
+			changed |= reserve(frame.draws, sizeof(VkDrawIndexedIndirectCommand), batch_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, local);
+			changed |= reserve(frame.draw_count, sizeof(uint32_t), 1, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, local);
+			changed |= reserve(frame.cull_ubo, sizeof(CullUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, host);
+			// starts out as garbage, cull.comp clamps it to the model's levels
+			changed |= reserve(frame.lods, sizeof(uint32_t), object_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, local);
+			// the cull shaders reference these either way, so they exist even without meshlet culling
+			objects_changed |= reserve(frame.meshlets, sizeof(MeshletData), meshlet_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, host);
+			changed |= objects_changed;
+			changed |= reserve(frame.cluster_objects, sizeof(glm::uvec2), cluster_object_capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, local);
+			changed |= reserve(frame.cluster_dispatch, sizeof(VkDispatchIndirectCommand), 1, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, local);
+			changed |= reserve(frame.cluster_draws, sizeof(VkDrawIndexedIndirectCommand), cluster_draw_capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, local);
+			changed |= reserve(frame.cluster_draw_count, sizeof(uint32_t), 1, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, local);
+		}
+		if(objects_changed){
+			frame.written_layout = 0;
+		}
+		frame.descriptors_dirty |= changed;
+	}
 
-		std::vector<VkDescriptorSetLayout> descriptor_sets_layouts{global_set_layout};
+	void MasterRenderSystem::create_pipeline_layout(VkDescriptorSetLayout global_set_layout, VkDescriptorSetLayout light_set_layout, VkDescriptorSetLayout shadow_set_layout){
+		std::vector<VkDescriptorSetLayout> descriptor_sets_layouts{global_set_layout, instance_set_layout->getDescriptorSetLayout(), light_set_layout, shadow_set_layout};
 
 		VkPipelineLayoutCreateInfo pipeline_layout_info{};
 		pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(descriptor_sets_layouts.size());
 		pipeline_layout_info.pSetLayouts = descriptor_sets_layouts.data();
-		pipeline_layout_info.pushConstantRangeCount = 1;
-		pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+		pipeline_layout_info.pushConstantRangeCount = 0;
+		pipeline_layout_info.pPushConstantRanges = nullptr;
 		if(vkCreatePipelineLayout(device.device(),&pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS){
 			throw std::runtime_error("failed to create pipeline layout");
 		}
 	}
 	
-	void MasterRenderSystem::create_pipeline(VkRenderPass render_pass){
+	void MasterRenderSystem::create_pipeline(VkRenderPass render_pass, bool depth_prepass){
 		assert(pipeline_layout != VK_NULL_HANDLE && "cannot create pipeline before pipeline layout");
 
 		PipelineConfigInfo pipeline_config{};
 		Pipeline::default_pipeline_config_info(pipeline_config);
 		pipeline_config.render_pass = render_pass;
 		pipeline_config.pipeline_layout = pipeline_layout;
+		const VertexFormat vertex_format = device.vertexFormat();
+		pipeline_config.binding_descriptions = Model::get_binding_descriptions(vertex_format);
+		pipeline_config.attribute_descriptions = Model::get_attribute_descriptions(vertex_format);
+		pipeline_config.vertex_constants = {static_cast<uint32_t>(vertex_format)};
+		if(depth_prepass){
+			PipelineConfigInfo prepass_config{};
+			Pipeline::default_pipeline_config_info(prepass_config);
+			prepass_config.render_pass = render_pass;
+			prepass_config.pipeline_layout = pipeline_layout;
+			prepass_config.binding_descriptions = Model::get_position_binding_descriptions(vertex_format);
+			prepass_config.attribute_descriptions = Model::get_position_attribute_descriptions(vertex_format);
+			// the subpass' color attachment stays, it just isn't written
+			prepass_config.color_blend_attachment.colorWriteMask = 0;
+			prepass_pipeline = std::make_unique<Pipeline>(device, "shaders/depth_prepass.vert.spv", "shaders/depth_prepass.frag.spv", prepass_config);
+			// only the front most surface of every pixel matches the depth the pre-pass left
+			pipeline_config.depth_stencil_info.depthCompareOp = VK_COMPARE_OP_EQUAL;
+			pipeline_config.depth_stencil_info.depthWriteEnable = VK_FALSE;
+		}
 		be_pipeline = std::make_unique<Pipeline>(device, "shaders/master_shader.vert.spv", "shaders/master_shader.frag.spv", pipeline_config);
 	}
 
-	void MasterRenderSystem::render_game_objects(FrameInfo& frame_info){
-		be_pipeline->bind(frame_info.command_buffer);
-		auto projection_view = frame_info.camera.get_projection() * frame_info.camera.get_view();
+	void MasterRenderSystem::create_cull_pipelines(){
+		VkDescriptorSetLayout layout = cull_set_layout->getDescriptorSetLayout();
+		VkPipelineLayoutCreateInfo pipeline_layout_info{};
+		pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_info.setLayoutCount = 1;
+		pipeline_layout_info.pSetLayouts = &layout;
+		if(vkCreatePipelineLayout(device.device(), &pipeline_layout_info, nullptr, &cull_pipeline_layout) != VK_SUCCESS){
+			throw std::runtime_error("failed to create pipeline layout");
+		}
+		cull_pipeline = std::make_unique<ComputePipeline>(device, "shaders/cull.comp.spv", cull_pipeline_layout);
+		compact_pipeline = std::make_unique<ComputePipeline>(device, "shaders/cull_compact.comp.spv", cull_pipeline_layout);
+		if(meshlet_culling){
+			cluster_cull_pipeline = std::make_unique<ComputePipeline>(device, "shaders/cluster_cull.comp.spv", cull_pipeline_layout);
+		}
+	}
+
+	void MasterRenderSystem::update_batches(Scene& scene){
+		auto& renderables = scene.renderables;
+		auto& transforms = scene.transforms;
+		// both only ever grow, so their sum changes whenever either does
+		uint64_t versions = renderables.get_version() + transforms.get_version();
+		if(versions == batched_versions){
+			return;
+		}
+		batched_versions = versions;
+		batch_layout++;
+
+		batch_lookup.clear();
+		batches.clear();
+		object_batches.assign(renderables.size(), NO_BATCH);
+		object_lods.assign(renderables.size(), 0);
+		for(size_t slot = 0; slot < renderables.size(); slot++){
+			Model* model = renderables[slot].model.get();
+			if(model == nullptr || !transforms.has(renderables.entity(slot))){
+				continue;
+			}
+			auto inserted = batch_lookup.try_emplace(model, static_cast<uint32_t>(batches.size()));
+			if(inserted.second){
+				for(uint32_t lod = 0; lod < model->get_lod_count(); lod++){
+					batches.push_back({model, lod, 0, 0});
+				}
+			}
+			batches[inserted.first->second].instance_count++;
+			object_batches[slot] = inserted.first->second;
+		}
+		// any object can end up at any level, so every level gets room for all of its model's objects
+		instance_capacity = 0;
+		for(size_t i = 0; i < batches.size(); i++){
+			if(batches[i].lod > 0){
+				batches[i].instance_count = batches[i - 1].instance_count;
+			}
+			batches[i].first_instance = instance_capacity;
+			instance_capacity += batches[i].instance_count;
+		}
+		// meshlets replace the full detail draw of their model's batches
+		meshlet_count = 0;
+		cluster_object_capacity = 0;
+		cluster_draw_capacity = 0;
+		if(meshlet_culling){
+			for(auto& batch : batches){
+				const uint32_t count = static_cast<uint32_t>(batch.model->get_meshlets().size());
+				if(batch.lod > 0 || count == 0){
+					continue;
+				}
+				batch.first_meshlet = meshlet_count;
+				batch.meshlet_count = count;
+				meshlet_count += count;
+				cluster_object_capacity += batch.instance_count;
+				cluster_draw_capacity += batch.instance_count * count;
+			}
+		}
+	}
+
+	void MasterRenderSystem::write_objects(Scene& scene, FrameResources& frame){
+		auto& renderables = scene.renderables;
+		auto& transforms = scene.transforms;
+		const bool full = frame.written_layout != batch_layout;
+		if(full){
+			frame.written_versions.assign(renderables.size(), 0);
+			if(gpu_culling && !batches.empty()){
+				auto* batch_data = static_cast<BatchData*>(frame.batches->getMappedMemory());
+				for(size_t i = 0; i < batches.size(); i++){
+					const Model& model = *batches[i].model;
+					const Model::Lod& lod = model.get_lod(batches[i].lod);
+					batch_data[i] = {lod.index_count, lod.first_index, model.get_mesh().vertex_offset, batches[i].first_instance, lod.error, model.get_lod_count(), batches[i].first_meshlet, batches[i].meshlet_count};
+				}
+				frame.batches->flush(batches.size() * sizeof(BatchData));
+			}
+			if(meshlet_count > 0){
+				auto* meshlet_data = static_cast<MeshletData*>(frame.meshlets->getMappedMemory());
+				for(const auto& batch : batches){
+					const std::vector<Meshlet>& meshlets = batch.model->get_meshlets();
+					// the pipelines draw both sides, back faces of open or inconsistently wound models are visible
+					const bool cone_culling = batch.model->is_single_sided();
+					for(uint32_t i = 0; i < batch.meshlet_count; i++){
+						const glm::vec4 cone = cone_culling ? meshlets[i].cone : glm::vec4{0.f, 0.f, 1.f, -1.f};
+						meshlet_data[batch.first_meshlet + i] = {meshlets[i].sphere, cone, meshlets[i].first_index, meshlets[i].index_count, {0, 0}};
+					}
+				}
+				frame.meshlets->flush(meshlet_count * sizeof(MeshletData));
+			}
+		}
+
+		// only objects whose world matrix changed since this frame's buffer last saw them
+		auto* objects = static_cast<ObjectData*>(frame.objects->getMappedMemory());
+		size_t first_written = renderables.size();
+		size_t end_written = 0;
+		for(size_t slot = 0; slot < renderables.size(); slot++){
+			uint32_t batch = object_batches[slot];
+			if(batch == NO_BATCH){
+				if(full){
+					objects[slot].batch = NO_BATCH;
+					first_written = std::min(first_written, slot);
+					end_written = slot + 1;
+				}
+				continue;
+			}
+			const TransformComponent& transform = transforms.get(renderables.entity(slot));
+			if(!full && frame.written_versions[slot] == transform.get_world_version()){
+				continue;
+			}
+			ObjectData& object = objects[slot];
+			object.model_matrix = transform.get_world_matrix();
+			object.normal_matrix = glm::mat4(transform.get_world_normal_matrix());
+			const Model& model = *batches[batch].model;
+			AABB bounds = model.get_bounds().transformed(transform.get_world_matrix());
+			object.bounds_min = glm::vec4(bounds.min, 1.f);
+			object.bounds_max = glm::vec4(bounds.max, 1.f);
+			object.position_decode = model.get_position_decode();
+			object.batch = batch;
+			frame.written_versions[slot] = transform.get_world_version();
+			first_written = std::min(first_written, slot);
+			end_written = slot + 1;
+		}
+		if(first_written < end_written){
+			frame.objects->flush((end_written - first_written) * sizeof(ObjectData), first_written * sizeof(ObjectData));
+		}
+		frame.written_layout = batch_layout;
+	}
+
+	void MasterRenderSystem::write_descriptors(FrameResources& frame, FrameInfo& frame_info){
+		if(frame.descriptors_dirty){
+			auto objects_info = frame.objects->descriptorInfo();
+			auto instances_info = frame.instances->descriptorInfo();
+			DescriptorWriter writer{*instance_set_layout, *instance_pool};
+			writer.writeBuffer(0, &objects_info).writeBuffer(1, &instances_info);
+			if(frame.instance_set == VK_NULL_HANDLE){
+				writer.build(frame.instance_set);
+			}else{
+				writer.overwrite(frame.instance_set);
+			}
+			if(gpu_culling){
+				auto ubo_info = frame.cull_ubo->descriptorInfo();
+				auto batches_info = frame.batches->descriptorInfo();
+				auto counters_info = frame.counters->descriptorInfo();
+				auto draws_info = frame.draws->descriptorInfo();
+				auto draw_count_info = frame.draw_count->descriptorInfo();
+				auto lods_info = frame.lods->descriptorInfo();
+				auto meshlets_info = frame.meshlets->descriptorInfo();
+				auto cluster_objects_info = frame.cluster_objects->descriptorInfo();
+				auto cluster_dispatch_info = frame.cluster_dispatch->descriptorInfo();
+				auto cluster_draws_info = frame.cluster_draws->descriptorInfo();
+				auto cluster_draw_count_info = frame.cluster_draw_count->descriptorInfo();
+				DescriptorWriter cull_writer{*cull_set_layout, *cull_pool};
+				cull_writer.writeBuffer(0, &ubo_info)
+					.writeBuffer(1, &objects_info)
+					.writeBuffer(2, &batches_info)
+					.writeBuffer(3, &counters_info)
+					.writeBuffer(4, &instances_info)
+					.writeBuffer(5, &draws_info)
+					.writeBuffer(6, &draw_count_info)
+					.writeBuffer(8, &lods_info)
+					.writeBuffer(9, &meshlets_info)
+					.writeBuffer(10, &cluster_objects_info)
+					.writeBuffer(11, &cluster_dispatch_info)
+					.writeBuffer(12, &cluster_draws_info)
+					.writeBuffer(13, &cluster_draw_count_info);
+				if(frame.cull_set == VK_NULL_HANDLE){
+					cull_writer.build(frame.cull_set);
+				}else{
+					cull_writer.overwrite(frame.cull_set);
+				}
+			}
+			frame.descriptors_dirty = false;
+		}
+		if(gpu_culling){
+			// the pyramid is recreated with the swap chain, cheaper to always point at the current one than to track it
+			auto pyramid_info = frame_info.depth_pyramid.descriptor_info();
+			DescriptorWriter{*cull_set_layout, *cull_pool}.writeImage(7, &pyramid_info).overwrite(frame.cull_set);
+		}
+	}
+
+	void MasterRenderSystem::cull(FrameInfo& frame_info){
+		FrameResources& frame = frames[frame_info.frame_index];
+		update_batches(frame_info.scene);
+		reserve_frame(frame, static_cast<uint32_t>(frame_info.scene.renderables.size()));
+		write_objects(frame_info.scene, frame);
+		write_descriptors(frame, frame_info);
+		if(gpu_culling){
+			cull_gpu(frame_info, frame);
+		}else{
+			cull_cpu(frame_info, frame);
+		}
+	}
+
+	void MasterRenderSystem::cull_gpu(FrameInfo& frame_info, FrameResources& frame){
+		const uint32_t object_count = static_cast<uint32_t>(frame_info.scene.renderables.size());
+		const uint32_t batch_count = static_cast<uint32_t>(batches.size());
+		frame.draw_count_recorded = 0;
+		if(batch_count == 0){
+			return;
+		}
+		const OptionalFeatures& features = device.optionalFeatures();
+		const DepthPyramid& pyramid = frame_info.depth_pyramid;
 
-		vkCmdBindDescriptorSets(frame_info.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,1,&frame_info.global_descriptor_set,0,nullptr);
+		CullUbo ubo{};
+		Frustum frustum{frame_info.camera.get_projection() * frame_info.camera.get_view()};
+		for(size_t i = 0; i < 6; i++){
+			ubo.frustum_planes[i] = frustum.get_plane(i);
+		}
+		ubo.pyramid_view_projection = pyramid.get_view_projection();
+		ubo.lod_params = glm::vec4(frame_info.camera.get_position(), lod_pixel_scale(frame_info));
+		ubo.depth_size = {static_cast<float>(pyramid.get_depth_extent().width), static_cast<float>(pyramid.get_depth_extent().height)};
+		ubo.object_count = object_count;
+		ubo.batch_count = batch_count;
+		ubo.pyramid_levels = pyramid.get_level_count();
+		ubo.flags = (pyramid.is_built() ? OCCLUSION_CULLING : 0) | (features.multiDrawIndirect && features.drawIndirectCount ? COMPACT_DRAWS : 0);
+		frame.cull_ubo->writeToBuffer(&ubo);
+		frame.cull_ubo->flush();
+
+		VkCommandBuffer command_buffer = frame_info.command_buffer;
+		vkCmdFillBuffer(command_buffer, frame.counters->getBuffer(), 0, batch_count * sizeof(uint32_t), 0);
+		vkCmdFillBuffer(command_buffer, frame.draw_count->getBuffer(), 0, sizeof(uint32_t), 0);
+		if(meshlet_count > 0){
+			const VkDispatchIndirectCommand no_groups{0, 1, 1};
+			vkCmdUpdateBuffer(command_buffer, frame.cluster_dispatch->getBuffer(), 0, sizeof(no_groups), &no_groups);
+			vkCmdFillBuffer(command_buffer, frame.cluster_draw_count->getBuffer(), 0, sizeof(uint32_t), 0);
+		}
+		// also orders the levels of detail this frame index's last cull wrote before they are read again
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_layout, 0, 1, &frame.cull_set, 0, nullptr);
+		cull_pipeline->bind(command_buffer);
+		vkCmdDispatch(command_buffer, (object_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+		// the cluster dispatch is read as an indirect command
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		compact_pipeline->bind(command_buffer);
+		vkCmdDispatch(command_buffer, (batch_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+		if(meshlet_count > 0){
+			cluster_cull_pipeline->bind(command_buffer);
+			vkCmdDispatchIndirect(command_buffer, frame.cluster_dispatch->getBuffer(), 0);
+		}
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		frame.draw_count_recorded = batch_count;
+	}
 
-		for(auto& kv : frame_info.game_objects){
-			auto& obj = kv.second;
-			if(obj.model == nullptr) continue;
-			SimplePushConstantData push{};
-			push.model_matrix = obj.transform.mat4();
-			push.normal_matrix = obj.transform.normal_matrix();
-			vkCmdPushConstants(frame_info.command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0 ,sizeof(SimplePushConstantData), &push);
-			obj.model->bind(frame_info.command_buffer);
-			obj.model->draw(frame_info.command_buffer);
+	float MasterRenderSystem::lod_pixel_scale(FrameInfo& frame_info){
+		return frame_info.camera.get_projection()[1][1] * .5f * frame_info.depth_pyramid.get_depth_extent().height / LOD_ERROR_PIXELS;
+	}
+
+	uint32_t MasterRenderSystem::select_lod(const Model& model, uint32_t previous, float error_scale){
+		const uint32_t lod_count = model.get_lod_count();
+		uint32_t lod = std::min(previous, lod_count - 1);
+		while(lod + 1 < lod_count && model.get_lod(lod + 1).error * error_scale < LOD_HYSTERESIS){
+			lod++;
+		}
+		while(lod > 0 && model.get_lod(lod).error * error_scale > 1.f){
+			lod--;
+		}
+		return lod;
+	}
+
+	void MasterRenderSystem::cull_cpu(FrameInfo& frame_info, FrameResources& frame){
+		auto& renderables = frame_info.scene.renderables;
+		auto& transforms = frame_info.scene.transforms;
+		Frustum frustum{frame_info.camera.get_projection() * frame_info.camera.get_view()};
+		visible.clear();
+		frame_info.scene.get_bvh().query(frustum, [&](Entity entity){
+			if(renderables.has(entity) && object_batches[renderables.slot(entity)] != NO_BATCH){
+				visible.push_back(static_cast<uint32_t>(renderables.slot(entity)));
+			}
+		});
+
+		const glm::vec3 camera_position = frame_info.camera.get_position();
+		const float pixel_scale = lod_pixel_scale(frame_info);
+		for(uint32_t slot : visible){
+			const Model& model = *batches[object_batches[slot]].model;
+			if(model.get_lod_count() == 1){
+				continue;
+			}
+			const glm::mat4& world = transforms.get(renderables.entity(slot)).get_world_matrix();
+			AABB bounds = model.get_bounds().transformed(world);
+			// largest axis scale, error measured from the nearest point of the box
+			float scale = std::sqrt(std::max({glm::dot(glm::vec3(world[0]), glm::vec3(world[0])), glm::dot(glm::vec3(world[1]), glm::vec3(world[1])), glm::dot(glm::vec3(world[2]), glm::vec3(world[2]))}));
+			glm::vec3 offset = glm::max(bounds.min - camera_position, glm::vec3(0.f)) + glm::max(camera_position - bounds.max, glm::vec3(0.f));
+			float distance = std::max(glm::length(offset), 1e-4f);
+			object_lods[slot] = static_cast<uint8_t>(select_lod(model, object_lods[slot], scale * pixel_scale / distance));
+		}
+
+		// visible objects grouped by batch, drawn directly
+		visible_batches.clear();
+		for(const auto& batch : batches){
+			visible_batches.push_back({batch.model, batch.lod, 0, 0});
+		}
+		for(uint32_t slot : visible){
+			visible_batches[object_batches[slot] + object_lods[slot]].instance_count++;
+		}
+		uint32_t instance_count = 0;
+		for(auto& batch : visible_batches){
+			batch.first_instance = instance_count;
+			instance_count += batch.instance_count;
+			batch.instance_count = 0;
+		}
+		auto* instances = static_cast<uint32_t*>(frame.instances->getMappedMemory());
+		for(uint32_t slot : visible){
+			auto& batch = visible_batches[object_batches[slot] + object_lods[slot]];
+			instances[batch.first_instance + batch.instance_count++] = slot;
+		}
+		if(instance_count > 0){
+			frame.instances->flush(instance_count * sizeof(uint32_t));
+		}
+		frame.draw_count_recorded = instance_count > 0 ? static_cast<uint32_t>(visible_batches.size()) : 0;
+	}
+
+	void MasterRenderSystem::render_game_objects(FrameInfo& frame_info){
+		FrameResources& frame = frames[frame_info.frame_index];
+		if(frame.draw_count_recorded == 0){
+			return;
+		}
+		VkCommandBuffer command_buffer = frame_info.command_buffer;
+		VkDescriptorSet descriptor_sets[] = {frame_info.global_descriptor_set, frame.instance_set, frame_info.light_descriptor_set, frame_info.shadow_descriptor_set};
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 4, descriptor_sets, 0, nullptr);
+		if(prepass_pipeline){
+			prepass_pipeline->bind(command_buffer);
+			device.meshPool().bind_positions(command_buffer);
+			draw_objects(command_buffer, frame);
+		}
+		be_pipeline->bind(command_buffer);
+		device.meshPool().bind(command_buffer);
+		draw_objects(command_buffer, frame);
+	}
+
+	void MasterRenderSystem::draw_objects(VkCommandBuffer command_buffer, FrameResources& frame){
+		if(!gpu_culling){
+			for(auto& batch : visible_batches){
+				if(batch.instance_count > 0){
+					batch.model->draw(command_buffer, batch.instance_count, batch.first_instance, batch.lod);
+				}
+			}
+			return;
+		}
+		const OptionalFeatures& features = device.optionalFeatures();
+		VkBuffer draw_buffer = frame.draws->getBuffer();
+		uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+		if(features.multiDrawIndirect && features.drawIndirectCount){
+			vkCmdDrawIndexedIndirectCount(command_buffer, draw_buffer, 0, frame.draw_count->getBuffer(), 0, frame.draw_count_recorded, stride);
+			if(meshlet_count > 0){
+				vkCmdDrawIndexedIndirectCount(command_buffer, frame.cluster_draws->getBuffer(), 0, frame.cluster_draw_count->getBuffer(), 0, cluster_draw_capacity, stride);
+			}
+		}else if(features.multiDrawIndirect){
+			vkCmdDrawIndexedIndirect(command_buffer, draw_buffer, 0, frame.draw_count_recorded, stride);
+		}else{
+			for(uint32_t i = 0; i < frame.draw_count_recorded; i++){
+				vkCmdDrawIndexedIndirect(command_buffer, draw_buffer, i * stride, 1, stride);
+			}
 		}
 	}
 
-}
\ No newline at end of file
+}
@@ -1,33 +1,164 @@
 #pragma once
 
+#include "buffer.hpp"
 #include "camera.hpp"
+#include "descriptors.hpp"
 #include "device.hpp"
-#include "game_object.hpp"
+#include "scene.hpp"
 #include "pipeline.hpp"
 #include "frame_info.hpp"
+#include "frustum.hpp"
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace blikaengine{
 
+	// Draws every renderable with one instanced draw per model. Per object data (matrices and world
+	// bounds) lives in a per frame storage buffer that is only rewritten for objects that moved.
+	//
+	// With drawIndirectFirstInstance the objects are culled on the gpu: a compute pass tests every
+	// object against the view frustum and the depth pyramid of the previous frame, appends the
+	// survivors to their model's instance range and a second pass writes the indirect draws, compacted
+	// when the device has drawIndirectCount. Otherwise the scene bvh is walked on the cpu and the
+	// visible objects are drawn directly.
+	//
+	// Either way every object picks the coarsest level of detail of its model whose error stays under
+	// LOD_ERROR_PIXELS on screen. Objects only move to a coarser level once its error is well under
+	// the limit, so they don't flicker between two levels at the distance where they swap.
+	//
+	// With compacted draws, full detail objects of models split into meshlets are culled a second time
+	// per meshlet: cluster_cull.comp drops the meshlets outside the frustum and the ones facing away
+	// from the camera, and draws the rest one indexed draw each. The pipelines draw both sides, so only
+	// models found single sided at import (Model::is_single_sided()) have back facing meshlets dropped.
+	//
+	// With depth_prepass the visible objects are drawn twice: depth only from the mesh pool's position
+	// stream, then lit with an EQUAL depth test and depth writes off, so the lighting runs once per pixel
+	// however much the objects overlap.
 	class MasterRenderSystem{
 		public:
 
-			MasterRenderSystem(Device& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout);
+			// light_set_layout is PointLightSystem's, bound as set 2, shadow_set_layout ShadowSystem's, bound as set 3
+			MasterRenderSystem(Device& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout, VkDescriptorSetLayout light_set_layout, VkDescriptorSetLayout shadow_set_layout, bool depth_prepass = false);
 			~MasterRenderSystem();
 			MasterRenderSystem(const MasterRenderSystem&) = delete;
 			MasterRenderSystem& operator = (const MasterRenderSystem&) = delete;
 
+			// decides what render_game_objects() draws. Records compute work, so it has to be called
+			// outside of the render pass, after Scene::update_bounds().
+			void cull(FrameInfo& frame_info);
 			void render_game_objects(FrameInfo& frame_info);
 
+			bool is_gpu_culling() const{ return gpu_culling; }
+
 		private:
-			void create_pipeline_layout(VkDescriptorSetLayout global_set_layout);
-			void create_pipeline(VkRenderPass render_pass);
+			// all renderables sharing a model and level of detail, drawn with one instanced draw. The
+			// levels of a model are consecutive batches, the first one full detail
+			struct Batch{
+				Model* model;
+				uint32_t lod;
+				uint32_t first_instance;
+				uint32_t instance_count;
+				// range in the frame's meshlet buffer, full detail batches with meshlet culling only
+				uint32_t first_meshlet = 0;
+				uint32_t meshlet_count = 0;
+			};
+
+			struct FrameResources{
+				std::unique_ptr<Buffer> objects{};
+				std::unique_ptr<Buffer> batches{};
+				// object index per instance
+				std::unique_ptr<Buffer> instances{};
+				// gpu culling only
+				std::unique_ptr<Buffer> counters{};
+				std::unique_ptr<Buffer> draws{};
+				std::unique_ptr<Buffer> draw_count{};
+				std::unique_ptr<Buffer> cull_ubo{};
+				// level of detail every object was drawn with last, for the hysteresis
+				std::unique_ptr<Buffer> lods{};
+				// meshlet culling, every batch's meshlets, the objects cull.comp queued for
+				// cluster_cull.comp, its dispatch, and the draws it writes
+				std::unique_ptr<Buffer> meshlets{};
+				std::unique_ptr<Buffer> cluster_objects{};
+				std::unique_ptr<Buffer> cluster_dispatch{};
+				std::unique_ptr<Buffer> cluster_draws{};
+				std::unique_ptr<Buffer> cluster_draw_count{};
+				VkDescriptorSet instance_set = VK_NULL_HANDLE;
+				VkDescriptorSet cull_set = VK_NULL_HANDLE;
+				bool descriptors_dirty = true;
+				// the batch layout objects and batches were last written for, 0 forces a full write
+				uint64_t written_layout = 0;
+				// world version each object was written with
+				std::vector<uint32_t> written_versions{};
+				// draws render_game_objects() submits
+				uint32_t draw_count_recorded = 0;
+			};
+
+			static constexpr uint32_t NO_BATCH = 0xffffffff;
+			static constexpr uint32_t CULL_GROUP_SIZE = 64;
+			static constexpr float LOD_ERROR_PIXELS = 1.f;
+			// fraction of LOD_ERROR_PIXELS the next coarser level has to be under before it is taken
+			static constexpr float LOD_HYSTERESIS = .75f;
+
+			void create_frame_resources();
+			void create_pipeline_layout(VkDescriptorSetLayout global_set_layout, VkDescriptorSetLayout light_set_layout, VkDescriptorSetLayout shadow_set_layout);
+			void create_pipeline(VkRenderPass render_pass, bool depth_prepass);
+			void create_cull_pipelines();
+			// regroups the renderables by model when the component pools changed
+			void update_batches(Scene& scene);
+			// grows buffer to hold count elements, true if it had to be recreated
+			bool reserve(std::unique_ptr<Buffer>& buffer, VkDeviceSize element_size, uint32_t count, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_properties);
+			void reserve_frame(FrameResources& frame, uint32_t object_count);
+			void write_objects(Scene& scene, FrameResources& frame);
+			void write_descriptors(FrameResources& frame, FrameInfo& frame_info);
+			void cull_gpu(FrameInfo& frame_info, FrameResources& frame);
+			void cull_cpu(FrameInfo& frame_info, FrameResources& frame);
+			// the draws cull() decided on, with whatever pipeline and vertex stream are bound
+			void draw_objects(VkCommandBuffer command_buffer, FrameResources& frame);
+			// screen space error, in LOD_ERROR_PIXELS, of one unit of object space error seen from distance 1
+			static float lod_pixel_scale(FrameInfo& frame_info);
+			// coarsest level of model fine enough at error_scale (object space error to screen error, in
+			// LOD_ERROR_PIXELS), moving from the previous level with hysteresis. Same as select_lod() in cull.comp
+			static uint32_t select_lod(const Model& model, uint32_t previous, float error_scale);
 
 			Device& device;
+			bool gpu_culling;
+			// gpu culling with compacted draws, needed for the varying number of meshlet draws
+			bool meshlet_culling;
 			std::unique_ptr<Pipeline> be_pipeline;
+			// null without depth_prepass
+			std::unique_ptr<Pipeline> prepass_pipeline;
 			VkPipelineLayout pipeline_layout;
+
+			std::unique_ptr<DescriptorSetLayout> instance_set_layout;
+			std::unique_ptr<DescriptorPool> instance_pool;
+			std::unique_ptr<DescriptorSetLayout> cull_set_layout;
+			std::unique_ptr<DescriptorPool> cull_pool;
+			VkPipelineLayout cull_pipeline_layout = VK_NULL_HANDLE;
+			std::unique_ptr<ComputePipeline> cull_pipeline;
+			std::unique_ptr<ComputePipeline> compact_pipeline;
+			std::unique_ptr<ComputePipeline> cluster_cull_pipeline;
+			std::vector<FrameResources> frames;
+
+			// rebuilt when the renderables or transforms change
+			uint64_t batched_versions = ~0ull;
+			uint64_t batch_layout = 0;
+			std::unordered_map<Model*, uint32_t> batch_lookup;
+			std::vector<Batch> batches;
+			// full detail batch of every renderable slot
+			std::vector<uint32_t> object_batches;
+			uint32_t instance_capacity = 0;
+			uint32_t meshlet_count = 0;
+			// objects with meshlets, and meshlets of all their instances, that could be visible at once
+			uint32_t cluster_object_capacity = 0;
+			uint32_t cluster_draw_capacity = 0;
+
+			// cpu culling, rebuilt every frame
+			std::vector<uint32_t> visible;
+			// level of detail of every renderable slot, kept across frames
+			std::vector<uint8_t> object_lods;
+			std::vector<Batch> visible_batches;
 	};
 
-}
\ No newline at end of file
+}
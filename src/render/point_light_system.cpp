@@ -1,13 +1,15 @@
 #include "point_light_system.hpp"
+#include "swap_chain.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
-#include <map>
+#include <cstring>
 #include <stdexcept>
 #include <vector>
 
@@ -15,13 +17,15 @@
 
 namespace blikaengine{
 	
-	struct PointLightPushConstant{
+	// matches Billboard in point_light.vert (std430)
+	struct BillboardData{
+		// xyz world position, w radius
 		glm::vec4 position{};
 		glm::vec4 color{};
-		float radius;
 	};
 
 	PointLightSystem::PointLightSystem(Device& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout): device{device}{
+		create_frame_resources();
 		create_pipeline_layout(global_set_layout);
 		create_pipeline(render_pass);
 	}
@@ -30,21 +34,65 @@ namespace blikaengine{
 		vkDestroyPipelineLayout(device.device(), pipeline_layout, nullptr);
 	}
 
-	void PointLightSystem::create_pipeline_layout(VkDescriptorSetLayout global_set_layout){
-		
-		VkPushConstantRange push_constant_range{};
-		push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		push_constant_range.offset = 0;
-		push_constant_range.size = sizeof(PointLightPushConstant);
+	void PointLightSystem::create_frame_resources(){
+		light_set_layout = DescriptorSetLayout::Builder(device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+			.build();
+		light_pool = DescriptorPool::Builder(device)
+			.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * SwapChain::MAX_FRAMES_IN_FLIGHT)
+			.build();
+		// the sets have to exist before the first write_lights(), frame infos are built with them
+		frames.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+		for(auto& frame : frames){
+			reserve(frame.lights, sizeof(PointLight), 1);
+			reserve(frame.ranges, sizeof(LightClusters::Range), LightClusters::CLUSTER_COUNT);
+			reserve(frame.indices, sizeof(uint32_t), 1);
+			reserve(frame.billboards, sizeof(BillboardData), 1);
+			write_descriptors(frame);
+		}
+	}
+
+	// only ever called for the frame being recorded, whose previous submission has already completed
+	bool PointLightSystem::reserve(std::unique_ptr<Buffer>& buffer, VkDeviceSize element_size, size_t count){
+		uint32_t needed = static_cast<uint32_t>(std::max<size_t>(count, 1));
+		if(buffer && buffer->getInstanceCount() >= needed){
+			return false;
+		}
+		uint32_t capacity = buffer ? std::max(needed, buffer->getInstanceCount() * 2) : needed;
+		buffer = std::make_unique<Buffer>(device, element_size, capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		buffer->map();
+		return true;
+	}
+
+	void PointLightSystem::write_descriptors(FrameResources& frame){
+		auto lights_info = frame.lights->descriptorInfo();
+		auto ranges_info = frame.ranges->descriptorInfo();
+		auto indices_info = frame.indices->descriptorInfo();
+		auto billboards_info = frame.billboards->descriptorInfo();
+		DescriptorWriter writer{*light_set_layout, *light_pool};
+		writer.writeBuffer(0, &lights_info).writeBuffer(1, &ranges_info).writeBuffer(2, &indices_info).writeBuffer(3, &billboards_info);
+		if(frame.light_set == VK_NULL_HANDLE){
+			if(!writer.build(frame.light_set)){
+				throw std::runtime_error("failed to allocate light descriptor set");
+			}
+		}else{
+			writer.overwrite(frame.light_set);
+		}
+	}
 
-		std::vector<VkDescriptorSetLayout> descriptor_sets_layouts{global_set_layout};
+	void PointLightSystem::create_pipeline_layout(VkDescriptorSetLayout global_set_layout){
+		std::vector<VkDescriptorSetLayout> descriptor_sets_layouts{global_set_layout, light_set_layout->getDescriptorSetLayout()};
 
 		VkPipelineLayoutCreateInfo pipeline_layout_info{};
 		pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(descriptor_sets_layouts.size());
 		pipeline_layout_info.pSetLayouts = descriptor_sets_layouts.data();
-		pipeline_layout_info.pushConstantRangeCount = 1;
-		pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+		pipeline_layout_info.pushConstantRangeCount = 0;
+		pipeline_layout_info.pPushConstantRanges = nullptr;
 		if(vkCreatePipelineLayout(device.device(),&pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS){
 			throw std::runtime_error("failed to create pipeline layout");
 		}
@@ -55,92 +103,119 @@ namespace blikaengine{
 
 		PipelineConfigInfo pipeline_config{};
 		Pipeline::default_pipeline_config_info(pipeline_config);
-		Pipeline::enable_alpha_blending(pipeline_config);
+		// also keeps them out of the depth buffer, so they hide nothing from the depth pyramid
+		Pipeline::enable_weighted_blending(pipeline_config);
+		pipeline_config.subpass = SwapChain::TRANSPARENT_SUBPASS;
         pipeline_config.attribute_descriptions.clear();
         pipeline_config.binding_descriptions.clear();
 		pipeline_config.render_pass = render_pass;
 		pipeline_config.pipeline_layout = pipeline_layout;
 		be_pipeline = std::make_unique<Pipeline>(device, "shaders/point_light.vert.spv", "shaders/point_light.frag.spv", pipeline_config);
 	}
-	void PointLightSystem::update(FrameInfo& frame_info, GlobalUbo& ubo){
+	void PointLightSystem::update(FrameInfo& frame_info){
 		auto rotate = glm::rotate(glm::mat4(1.f), frame_info.frame_time, {0.f, -1.f, 0.f});
-		int i = 0;
-		for(auto& kv: frame_info.game_objects){
-			auto& obj = kv.second;
-			if(obj.point_light == nullptr) continue;
-			assert(i < MAX_LIGHTS && "point lights exceed maximum specified");
-
-			obj.transform.translation = glm::vec3(rotate * glm::vec4(obj.transform.translation,1.f));
-			//if(obj.next_color == 0){
-				obj.color.x += 0.25f * frame_info.frame_time * obj.multipliers[0];
-				if(obj.color.x > 1.f){
-					obj.color.x = 1.f;
-					obj.multipliers[0] = -1;
-				}else if(obj.color.x < 0.f){
-					obj.color.x = 0.f;
-					obj.multipliers[0] = 1;
-					//obj.next_color = 1;
-				}
-			/*}else if(obj.next_color == 1){
-				obj.color.y += 0.25f * frame_info.frame_time * obj.multipliers[1];
-				if(obj.color.y > 1.f){
-					obj.color.y = 1.f;
-					obj.multipliers[1] = -1;
-				}else if(obj.color.y < 0.f){
-					obj.color.y = 0.f;
-					obj.multipliers[1] = 1;
-					obj.next_color = 2;
-				}
-			}else if(obj.next_color == 2){
-				obj.color.z += 0.25f *frame_info.frame_time * obj.multipliers[2];
-				if(obj.color.z > 1.f){
-					obj.color.z = 1.f;
-					obj.multipliers[2] = -1;
-				}else if(obj.color.z < 0.f){
-					obj.color.y = 0.f;
-					obj.multipliers[2] = 1;
-					obj.next_color = 0;
-				}
-			}*/
-			obj.point_light->light_intensity += 0.1f * frame_info.frame_time * obj.multipliers[3];
-			if(obj.point_light->light_intensity > 1.f){
-				obj.point_light->light_intensity = 1.f;
-				obj.multipliers[3] = -1;
-			}else if(obj.point_light->light_intensity < 0.1f){
-				obj.point_light->light_intensity = 0.1f;
-				obj.multipliers[3] = 1;
+		auto& point_lights = frame_info.scene.point_lights;
+		auto& transforms = frame_info.scene.transforms;
+		for(size_t slot = 0; slot < point_lights.size(); slot++){
+			auto& light = point_lights[slot];
+			auto& transform = transforms.get(point_lights.entity(slot));
+
+			transform.set_translation(glm::vec3(rotate * glm::vec4(transform.get_translation(),1.f)));
+			light.color.x += 0.25f * frame_info.frame_time * light.multipliers[0];
+			if(light.color.x > 1.f){
+				light.color.x = 1.f;
+				light.multipliers[0] = -1;
+			}else if(light.color.x < 0.f){
+				light.color.x = 0.f;
+				light.multipliers[0] = 1;
+			}
+			light.light_intensity += 0.1f * frame_info.frame_time * light.multipliers[3];
+			if(light.light_intensity > 1.f){
+				light.light_intensity = 1.f;
+				light.multipliers[3] = -1;
+			}else if(light.light_intensity < 0.1f){
+				light.light_intensity = 0.1f;
+				light.multipliers[3] = 1;
 			}
+		}
+	}
+
+	void PointLightSystem::write_lights(FrameInfo& frame_info, GlobalUbo& ubo, VkExtent2D extent){
+		auto& point_lights = frame_info.scene.point_lights;
+		auto& transforms = frame_info.scene.transforms;
+		FrameResources& frame = frames[frame_info.frame_index];
+		bool resized = reserve(frame.lights, sizeof(PointLight), point_lights.size());
+		auto* lights = static_cast<PointLight*>(frame.lights->getMappedMemory());
+		light_spheres.resize(point_lights.size());
+		for(size_t slot = 0; slot < point_lights.size(); slot++){
+			auto& light = point_lights[slot];
+			auto& transform = transforms.get(point_lights.entity(slot));
+			light_spheres[slot] = glm::vec4(transform.get_world_position(), light.range);
+			lights[slot].position = light_spheres[slot];
+			lights[slot].color = glm::vec4(light.color, light.light_intensity);
+		}
+		frame.lights->flush();
 
-			ubo.point_lights[i].position = glm::vec4(obj.transform.translation,1.f);
-			ubo.point_lights[i].color = glm::vec4(obj.color, obj.point_light->light_intensity);
-			i++;
+		Camera& camera = frame_info.camera;
+		clusters.build(camera.get_view(), camera.get_projection(), camera.get_near(), camera.get_far(), light_spheres);
+		const auto& ranges = clusters.get_ranges();
+		const auto& indices = clusters.get_indices();
+		std::memcpy(frame.ranges->getMappedMemory(), ranges.data(), ranges.size() * sizeof(LightClusters::Range));
+		frame.ranges->flush();
+		resized |= reserve(frame.indices, sizeof(uint32_t), indices.size());
+		if(!indices.empty()){
+			std::memcpy(frame.indices->getMappedMemory(), indices.data(), indices.size() * sizeof(uint32_t));
+			frame.indices->flush();
+		}
+		// the set is bound during recording, after which it can't be touched anymore
+		resized |= write_billboards(frame_info, frame);
+		if(resized){
+			write_descriptors(frame);
 		}
-		ubo.lights = i;
+
+		ubo.cluster_grid = {LightClusters::GRID_X, LightClusters::GRID_Y, LightClusters::GRID_Z, static_cast<uint32_t>(point_lights.size())};
+		ubo.cluster_params = {
+			static_cast<float>(extent.width) / LightClusters::GRID_X,
+			static_cast<float>(extent.height) / LightClusters::GRID_Y,
+			clusters.get_slice_scale(),
+			clusters.get_slice_bias()};
 	}
 
-	void PointLightSystem::render(FrameInfo& frame_info){
-		std::map<float, GameObject::id_t> sorted;
-		for(auto& kv: frame_info.game_objects){
-			auto& obj = kv.second;
-			if(obj.point_light == nullptr) continue;
-			auto offset = frame_info.camera.get_position() - obj.transform.translation;
-			float dis_squared = glm::dot(offset, offset);
-			sorted[dis_squared] = obj.getId();
+	bool PointLightSystem::write_billboards(FrameInfo& frame_info, FrameResources& frame){
+		auto& point_lights = frame_info.scene.point_lights;
+		auto& transforms = frame_info.scene.transforms;
+		// billboards in view, in any order: they are blended order independently
+		visible_lights.clear();
+		Frustum frustum{frame_info.camera.get_projection() * frame_info.camera.get_view()};
+		frame_info.scene.get_bvh().query(frustum, [&](Entity entity){
+			if(point_lights.has(entity)){
+				visible_lights.push_back(static_cast<uint32_t>(point_lights.slot(entity)));
+			}
+		});
+
+		bool resized = reserve(frame.billboards, sizeof(BillboardData), visible_lights.size());
+		auto* billboards = static_cast<BillboardData*>(frame.billboards->getMappedMemory());
+		for(size_t i = 0; i < visible_lights.size(); i++){
+			auto& light = point_lights[visible_lights[i]];
+			auto& transform = transforms.get(point_lights.entity(visible_lights[i]));
+			billboards[i].position = glm::vec4(transform.get_world_position(), transform.get_scale().x);
+			billboards[i].color = glm::vec4(light.color, light.light_intensity);
+		}
+		if(!visible_lights.empty()){
+			frame.billboards->flush();
 		}
+		frame.billboard_count = static_cast<uint32_t>(visible_lights.size());
+		return resized;
+	}
 
-		be_pipeline->bind(frame_info.command_buffer);
-		auto projection_view = frame_info.camera.get_projection() * frame_info.camera.get_view();
-
-		vkCmdBindDescriptorSets(frame_info.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,1,&frame_info.global_descriptor_set,0,nullptr);
-		for(auto it = sorted.rbegin(); it != sorted.rend(); ++it){
-			auto& obj = frame_info.game_objects.at(it->second);
-			//if(obj.point_light == nullptr) continue;
-			PointLightPushConstant push{};
-			push.position = glm::vec4(obj.transform.translation,1.f);
-			push.color = glm::vec4(obj.color, obj.point_light->light_intensity);
-			push.radius = obj.transform.scale.x;
-			vkCmdPushConstants(frame_info.command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PointLightPushConstant), &push);
-        	vkCmdDraw(frame_info.command_buffer, 6, 1, 0, 0);
+	void PointLightSystem::render(FrameInfo& frame_info){
+		FrameResources& frame = frames[frame_info.frame_index];
+		if(frame.billboard_count == 0){
+			return;
 		}
+		be_pipeline->bind(frame_info.command_buffer);
+		VkDescriptorSet descriptor_sets[] = {frame_info.global_descriptor_set, frame.light_set};
+		vkCmdBindDescriptorSets(frame_info.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 2, descriptor_sets, 0, nullptr);
+		vkCmdDraw(frame_info.command_buffer, 6, frame.billboard_count, 0, 0);
 	}
 }
\ No newline at end of file
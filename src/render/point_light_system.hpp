@@ -1,8 +1,11 @@
 #pragma once
 
+#include "buffer.hpp"
 #include "camera.hpp"
+#include "descriptors.hpp"
 #include "device.hpp"
-#include "game_object.hpp"
+#include "light_clusters.hpp"
+#include "scene.hpp"
 #include "pipeline.hpp"
 #include "frame_info.hpp"
 
@@ -11,6 +14,8 @@
 
 namespace blikaengine{
 
+	// Owns the per frame light buffers the master shader reads through its clusters, and draws a
+	// billboard for every light in view with one instanced draw into the transparent subpass.
 	class PointLightSystem{
 		public:
 
@@ -19,16 +24,48 @@ namespace blikaengine{
 			PointLightSystem(const PointLightSystem&) = delete;
 			PointLightSystem& operator = (const PointLightSystem&) = delete;
 			
-			void update(FrameInfo& frame_info, GlobalUbo& ubo);
+			// animates the lights, run before Scene::update_transforms()
+			void update(FrameInfo& frame_info);
+			// world space lights into the frame's light buffer and their clusters, and the billboards in view.
+			// Run after Scene::update_bounds(), extent is the size of the framebuffer being rendered.
+			void write_lights(FrameInfo& frame_info, GlobalUbo& ubo, VkExtent2D extent);
 			void render(FrameInfo& frame_info);
 
+			VkDescriptorSetLayout get_light_set_layout() const{ return light_set_layout->getDescriptorSetLayout(); }
+			// stays the same set for a frame index, only its contents change
+			VkDescriptorSet get_light_set(int frame_index) const{ return frames[frame_index].light_set; }
+
 		private:
+			struct FrameResources{
+				std::unique_ptr<Buffer> lights{};
+				std::unique_ptr<Buffer> ranges{};
+				std::unique_ptr<Buffer> indices{};
+				std::unique_ptr<Buffer> billboards{};
+				uint32_t billboard_count = 0;
+				VkDescriptorSet light_set = VK_NULL_HANDLE;
+			};
+
+			void create_frame_resources();
 			void create_pipeline_layout(VkDescriptorSetLayout global_set_layout);
 			void create_pipeline(VkRenderPass render_pass);
+			// grows buffer to hold count elements, true if it had to be recreated
+			bool reserve(std::unique_ptr<Buffer>& buffer, VkDeviceSize element_size, size_t count);
+			void write_descriptors(FrameResources& frame);
+			// true if the billboard buffer had to be recreated
+			bool write_billboards(FrameInfo& frame_info, FrameResources& frame);
 
 			Device& device;
 			std::unique_ptr<Pipeline> be_pipeline;
 			VkPipelineLayout pipeline_layout;
+
+			std::unique_ptr<DescriptorSetLayout> light_set_layout;
+			std::unique_ptr<DescriptorPool> light_pool;
+			std::vector<FrameResources> frames;
+			LightClusters clusters{};
+			// xyz world position, w range of every light, in point light pool order
+			std::vector<glm::vec4> light_spheres;
+			// point light slots with a billboard in view
+			std::vector<uint32_t> visible_lights;
 	};
 
 }
\ No newline at end of file
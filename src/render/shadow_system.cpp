@@ -0,0 +1,388 @@
+#include "shadow_system.hpp"
+#include "frustum.hpp"
+#include "swap_chain.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace blikaengine{
+
+	// matches ShadowData in master_shader.frag (std430)
+	struct ShadowData{
+		// per cube face: xy top left corner and z size of its tile, in atlas uv
+		glm::vec4 faces[6];
+		// near, far, one texel in tile uv, 1 when the light is shadowed
+		glm::vec4 params{};
+	};
+
+	struct ShadowPushConstantData{
+		glm::mat4 view_projection{1.f};
+		glm::mat4 model_matrix{1.f};
+	};
+
+	namespace{
+		constexpr float NEAR_PLANE = .05f;
+		// lights re-rendered per frame at most, the rest keep their stale maps or stay unshadowed until their turn
+		constexpr size_t MAX_RENDERED_LIGHTS = 16;
+
+		// right and up of every cube face, the face looks along their cross product (+x, -x, +y, -y, +z, -z).
+		// The same table is in master_shader.frag
+		const glm::vec3 FACE_RIGHT[6] = {{0.f, 0.f, -1.f}, {0.f, 0.f, 1.f}, {1.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f}};
+		const glm::vec3 FACE_UP[6] = {{0.f, 1.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, 0.f, -1.f}, {0.f, 0.f, 1.f}, {0.f, 1.f, 0.f}, {0.f, 1.f, 0.f}};
+		const glm::vec3 FACE_DIRECTION[6] = {{1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f}};
+
+		// 90 degree perspective of one cube face, zero to one depth
+		glm::mat4 face_view_projection(const glm::vec3& position, float range, int face){
+			glm::mat4 view{1.f};
+			for(int i = 0; i < 3; i++){
+				view[i][0] = FACE_RIGHT[face][i];
+				view[i][1] = FACE_UP[face][i];
+				view[i][2] = FACE_DIRECTION[face][i];
+			}
+			view[3][0] = -glm::dot(FACE_RIGHT[face], position);
+			view[3][1] = -glm::dot(FACE_UP[face], position);
+			view[3][2] = -glm::dot(FACE_DIRECTION[face], position);
+			glm::mat4 projection{0.f};
+			projection[0][0] = 1.f;
+			projection[1][1] = 1.f;
+			projection[2][2] = range / (range - NEAR_PLANE);
+			projection[2][3] = 1.f;
+			projection[3][2] = -(range * NEAR_PLANE) / (range - NEAR_PLANE);
+			return projection * view;
+		}
+
+		uint64_t mix(uint64_t x){
+			x ^= x >> 30;
+			x *= 0xbf58476d1ce4e5b9ull;
+			x ^= x >> 27;
+			x *= 0x94d049bb133111ebull;
+			return x ^ (x >> 31);
+		}
+
+		uint64_t entity_key(Entity entity){
+			return (static_cast<uint64_t>(entity.generation) << 32) | entity.index;
+		}
+	}
+
+	ShadowSystem::ShadowSystem(Device& device): device{device}, atlas{device}{
+		create_frame_resources();
+		create_pipeline_layout();
+		create_pipeline();
+	}
+
+	ShadowSystem::~ShadowSystem(){
+		vkDestroyPipelineLayout(device.device(), pipeline_layout, nullptr);
+	}
+
+	void ShadowSystem::create_frame_resources(){
+		shadow_set_layout = DescriptorSetLayout::Builder(device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build();
+		shadow_pool = DescriptorPool::Builder(device)
+			.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+			.build();
+		// the sets have to exist before the first update(), frame infos are built with them
+		frames.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+		for(auto& frame : frames){
+			frame.shadows = std::make_unique<Buffer>(device, sizeof(ShadowData), 1, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+			frame.shadows->map();
+			write_descriptors(frame);
+		}
+	}
+
+	void ShadowSystem::write_descriptors(FrameResources& frame){
+		auto shadows_info = frame.shadows->descriptorInfo();
+		auto atlas_info = atlas.descriptor_info();
+		DescriptorWriter writer{*shadow_set_layout, *shadow_pool};
+		writer.writeBuffer(0, &shadows_info).writeImage(1, &atlas_info);
+		if(frame.shadow_set == VK_NULL_HANDLE){
+			if(!writer.build(frame.shadow_set)){
+				throw std::runtime_error("failed to allocate shadow descriptor set");
+			}
+		}else{
+			writer.overwrite(frame.shadow_set);
+		}
+	}
+
+	void ShadowSystem::create_pipeline_layout(){
+		VkPushConstantRange push_constant_range{};
+		push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		push_constant_range.offset = 0;
+		push_constant_range.size = sizeof(ShadowPushConstantData);
+
+		VkPipelineLayoutCreateInfo pipeline_layout_info{};
+		pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_info.setLayoutCount = 0;
+		pipeline_layout_info.pSetLayouts = nullptr;
+		pipeline_layout_info.pushConstantRangeCount = 1;
+		pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+		if(vkCreatePipelineLayout(device.device(), &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS){
+			throw std::runtime_error("failed to create pipeline layout");
+		}
+	}
+
+	void ShadowSystem::create_pipeline(){
+		assert(pipeline_layout != VK_NULL_HANDLE && "cannot create pipeline before pipeline layout");
+
+		PipelineConfigInfo pipeline_config{};
+		Pipeline::default_pipeline_config_info(pipeline_config);
+		// depth only
+		pipeline_config.color_blend_info.attachmentCount = 0;
+		pipeline_config.color_blend_info.pAttachments = nullptr;
+		// against acne, in units of the atlas' depth format
+		pipeline_config.rasterization_info.depthBiasEnable = VK_TRUE;
+		pipeline_config.rasterization_info.depthBiasConstantFactor = 1.25f;
+		pipeline_config.rasterization_info.depthBiasSlopeFactor = 1.75f;
+		pipeline_config.binding_descriptions = Model::get_binding_descriptions(device.vertexFormat());
+		pipeline_config.attribute_descriptions = Model::get_attribute_descriptions(device.vertexFormat());
+		pipeline_config.render_pass = atlas.get_render_pass();
+		pipeline_config.pipeline_layout = pipeline_layout;
+		be_pipeline = std::make_unique<Pipeline>(device, "shaders/shadow.vert.spv", "shaders/shadow.frag.spv", pipeline_config);
+	}
+
+	uint32_t ShadowSystem::wanted_tile_size(const glm::vec3& position, float range, const Camera& camera, VkExtent2D extent) const{
+		glm::vec3 offset = position - camera.get_position();
+		float distance_squared = glm::dot(offset, offset);
+		if(distance_squared <= range * range){
+			return MAX_TILE_SIZE;
+		}
+		// radius of the projected range sphere in pixels
+		float radius = range / std::sqrt(distance_squared - range * range) * camera.get_projection()[1][1] * .5f * extent.height;
+		uint32_t size = ShadowAtlas::MIN_TILE_SIZE;
+		while(size < MAX_TILE_SIZE && static_cast<float>(size) < radius){
+			size *= 2;
+		}
+		return size;
+	}
+
+	bool ShadowSystem::allocate(LightShadow& shadow, uint32_t size){
+		TileAllocator& allocator = atlas.get_allocator();
+		std::array<TileAllocator::Tile, 6> faces{};
+		for(; size >= ShadowAtlas::MIN_TILE_SIZE; size /= 2){
+			int face = 0;
+			while(face < 6 && allocator.allocate(size, faces[face])){
+				face++;
+			}
+			if(face == 6){
+				shadow.faces = faces;
+				return true;
+			}
+			while(face > 0){
+				allocator.free(faces[--face]);
+			}
+		}
+		return false;
+	}
+
+	void ShadowSystem::free(LightShadow& shadow){
+		if(shadow.faces[0].size == 0){
+			return;
+		}
+		for(auto& face : shadow.faces){
+			atlas.get_allocator().free(face);
+			face = {};
+		}
+	}
+
+	ShadowSystem::LightShadow& ShadowSystem::shadow_of(Entity entity){
+		if(entity.index >= shadows.size()){
+			shadows.resize(entity.index + 1);
+		}
+		LightShadow& shadow = shadows[entity.index];
+		// the index was reused since
+		if(shadow.generation != entity.generation){
+			free(shadow);
+			shadow = LightShadow{};
+			shadow.generation = entity.generation;
+		}
+		return shadow;
+	}
+
+	void ShadowSystem::update(FrameInfo& frame_info, VkExtent2D extent){
+		Scene& scene = frame_info.scene;
+		auto& point_lights = scene.point_lights;
+		auto& transforms = scene.transforms;
+		auto& renderables = scene.renderables;
+		FrameResources& frame = frames[frame_info.frame_index];
+		update_count++;
+
+		// lights that can light anything in view, by wanted size
+		Frustum frustum{frame_info.camera.get_projection() * frame_info.camera.get_view()};
+		candidates.clear();
+		for(size_t slot = 0; slot < point_lights.size(); slot++){
+			Entity entity = point_lights.entity(slot);
+			glm::vec3 position = transforms.get(entity).get_world_position();
+			float range = point_lights[slot].range;
+			if(range <= NEAR_PLANE || !frustum.intersects(BoundingSphere{position, range})){
+				continue;
+			}
+			LightShadow& shadow = shadow_of(entity);
+			shadow.seen = update_count;
+			shadow.wanted_size = wanted_tile_size(position, range, frame_info.camera, extent);
+			candidates.push_back({shadow.wanted_size, static_cast<uint32_t>(slot)});
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b){ return a.first > b.first; });
+
+		// tiles of lights gone or out of view go back first
+		for(size_t i = 0; i < allocated.size();){
+			LightShadow& shadow = shadows[allocated[i]];
+			if(shadow.seen != update_count){
+				free(shadow);
+			}
+			if(shadow.faces[0].size == 0){
+				allocated[i] = allocated.back();
+				allocated.pop_back();
+			}else{
+				i++;
+			}
+		}
+
+		// larger lights first, so the ones that don't fit are the least visible
+		for(const auto& candidate : candidates){
+			LightShadow& shadow = shadows[point_lights.entity(candidate.second).index];
+			uint32_t size = shadow.faces[0].size;
+			if(size == 0){
+				if(allocate(shadow, shadow.wanted_size)){
+					allocated.push_back(point_lights.entity(candidate.second).index);
+					shadow.dirty = true;
+				}
+			}else if(shadow.wanted_size < size / 2){
+				// shrinks only past twice the wanted size, so a slowly moving camera doesn't keep reallocating
+				free(shadow);
+				allocate(shadow, shadow.wanted_size);
+				shadow.dirty = true;
+			}else if(shadow.wanted_size > size){
+				// the old tiles stay while the new ones are taken, they are kept if nothing larger fits
+				auto old_faces = shadow.faces;
+				if(allocate(shadow, shadow.wanted_size)){
+					if(shadow.faces[0].size > size){
+						for(auto& face : old_faces){
+							atlas.get_allocator().free(face);
+						}
+						shadow.dirty = true;
+					}else{
+						free(shadow);
+						shadow.faces = old_faces;
+					}
+				}
+			}
+		}
+
+		// re-render what changed, within the budget, and write the frame's shadow buffer
+		if(frame.shadows->getInstanceCount() < point_lights.size()){
+			uint32_t capacity = std::max(static_cast<uint32_t>(point_lights.size()), frame.shadows->getInstanceCount() * 2);
+			frame.shadows = std::make_unique<Buffer>(device, sizeof(ShadowData), capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+			frame.shadows->map();
+			write_descriptors(frame);
+		}
+		auto* shadow_data = static_cast<ShadowData*>(frame.shadows->getMappedMemory());
+		std::memset(shadow_data, 0, point_lights.size() * sizeof(ShadowData));
+		dirty_lights.clear();
+		casters.clear();
+		const float atlas_scale = 1.f / ShadowAtlas::SIZE;
+		for(const auto& candidate : candidates){
+			uint32_t slot = candidate.second;
+			Entity entity = point_lights.entity(slot);
+			LightShadow& shadow = shadows[entity.index];
+			if(shadow.faces[0].size == 0){
+				continue;
+			}
+			const TransformComponent& transform = transforms.get(entity);
+			glm::vec3 position = transform.get_world_position();
+			float range = point_lights[slot].range;
+
+			// changes with the light and with anything that can cast into its range, in any order
+			uint32_t range_bits;
+			std::memcpy(&range_bits, &range, sizeof(range_bits));
+			uint64_t signature = mix(entity_key(entity) ^ (static_cast<uint64_t>(range_bits) << 32 | transform.get_world_version()));
+			uint32_t first_caster = static_cast<uint32_t>(casters.size());
+			scene.get_bvh().query(BoundingSphere{position, range}, [&](Entity caster){
+				const RenderableComponent* renderable = renderables.find(caster);
+				if(renderable == nullptr || !renderable->model || !transforms.has(caster)){
+					return;
+				}
+				uint64_t key = entity_key(caster) ^ (static_cast<uint64_t>(transforms.get(caster).get_world_version()) << 17);
+				signature += mix(key ^ reinterpret_cast<uintptr_t>(renderable->model.get()));
+				casters.push_back(caster);
+			});
+
+			if((shadow.dirty || signature != shadow.signature) && dirty_lights.size() < MAX_RENDERED_LIGHTS){
+				dirty_lights.push_back({position, range, shadow.faces, first_caster, static_cast<uint32_t>(casters.size()) - first_caster});
+				shadow.signature = signature;
+				shadow.dirty = false;
+			}else{
+				casters.resize(first_caster);
+			}
+			// tiles nothing was rendered into yet
+			if(shadow.dirty){
+				continue;
+			}
+			ShadowData& data = shadow_data[slot];
+			for(int face = 0; face < 6; face++){
+				const TileAllocator::Tile& tile = shadow.faces[face];
+				data.faces[face] = {tile.x * atlas_scale, tile.y * atlas_scale, tile.size * atlas_scale, 0.f};
+			}
+			data.params = {NEAR_PLANE, range, 1.f / shadow.faces[0].size, 1.f};
+		}
+		if(!point_lights.empty()){
+			frame.shadows->flush();
+		}
+	}
+
+	void ShadowSystem::render(FrameInfo& frame_info){
+		if(dirty_lights.empty()){
+			return;
+		}
+		VkCommandBuffer command_buffer = frame_info.command_buffer;
+		auto& renderables = frame_info.scene.renderables;
+		auto& transforms = frame_info.scene.transforms;
+		atlas.begin_render_pass(command_buffer);
+		be_pipeline->bind(command_buffer);
+		device.meshPool().bind(command_buffer);
+		for(const DirtyLight& light : dirty_lights){
+			for(int face = 0; face < 6; face++){
+				const TileAllocator::Tile& tile = light.faces[face];
+				VkViewport viewport{};
+				viewport.x = static_cast<float>(tile.x);
+				viewport.y = static_cast<float>(tile.y);
+				viewport.width = static_cast<float>(tile.size);
+				viewport.height = static_cast<float>(tile.size);
+				viewport.minDepth = 0.f;
+				viewport.maxDepth = 1.f;
+				VkRect2D scissor{{static_cast<int32_t>(tile.x), static_cast<int32_t>(tile.y)}, {tile.size, tile.size}};
+				vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+				vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+				VkClearAttachment clear{};
+				clear.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+				clear.clearValue.depthStencil = {1.f, 0};
+				VkClearRect clear_rect{scissor, 0, 1};
+				vkCmdClearAttachments(command_buffer, 1, &clear, 1, &clear_rect);
+
+				ShadowPushConstantData push{};
+				push.view_projection = face_view_projection(light.position, light.range, face);
+				Frustum face_frustum{push.view_projection};
+				for(uint32_t i = light.first_caster; i < light.first_caster + light.caster_count; i++){
+					Model* model = renderables.get(casters[i]).model.get();
+					const TransformComponent& transform = transforms.get(casters[i]);
+					if(!face_frustum.intersects(model->get_bounds().transformed(transform.get_world_matrix()))){
+						continue;
+					}
+					push.model_matrix = transform.get_world_matrix() * model->get_position_decode_matrix();
+					vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ShadowPushConstantData), &push);
+					model->draw(command_buffer);
+				}
+			}
+		}
+		atlas.end_render_pass(command_buffer);
+	}
+}
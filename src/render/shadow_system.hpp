@@ -0,0 +1,101 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "descriptors.hpp"
+#include "device.hpp"
+#include "frame_info.hpp"
+#include "pipeline.hpp"
+#include "scene.hpp"
+#include "shadow_atlas.hpp"
+
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace blikaengine{
+
+	// Omnidirectional point light shadows. Every shadowed light gets six cube faces in the shared
+	// ShadowAtlas, sized by how large its range appears on screen. A light's faces are only re-rendered
+	// when their tiles changed or when the light or any caster within its range moved, so stationary
+	// lights cost nothing after their first frame. Lights covering the most of the screen get their tiles
+	// first, the ones the atlas has no room left for stay unshadowed.
+	class ShadowSystem{
+		public:
+			static constexpr uint32_t MAX_TILE_SIZE = 512;
+
+			ShadowSystem(Device& device);
+			~ShadowSystem();
+			ShadowSystem(const ShadowSystem&) = delete;
+			ShadowSystem& operator = (const ShadowSystem&) = delete;
+
+			// sizes and allocates the tiles of the lights in view, writes the frame's shadow buffer and finds
+			// the lights to re-render. Run after Scene::update_bounds(), extent is the size of the framebuffer
+			void update(FrameInfo& frame_info, VkExtent2D extent);
+			// re-renders what update() found out of date, outside of the swap chain render pass
+			void render(FrameInfo& frame_info);
+
+			// the set layout the master shader samples the shadows through
+			VkDescriptorSetLayout get_shadow_set_layout() const{ return shadow_set_layout->getDescriptorSetLayout(); }
+			VkDescriptorSet get_shadow_set(int frame_index) const{ return frames[frame_index].shadow_set; }
+
+		private:
+			// per entity index of the light it belongs to
+			struct LightShadow{
+				uint32_t generation = 0;
+				// +x, -x, +y, -y, +z, -z, size 0 when not allocated
+				std::array<TileAllocator::Tile, 6> faces{};
+				// last update() that found the light in view
+				uint64_t seen = 0;
+				uint32_t wanted_size = 0;
+				// of the light and its casters when last rendered
+				uint64_t signature = 0;
+				bool dirty = false;
+			};
+
+			// a light to re-render this frame and its casters
+			struct DirtyLight{
+				glm::vec3 position;
+				float range;
+				std::array<TileAllocator::Tile, 6> faces;
+				uint32_t first_caster;
+				uint32_t caster_count;
+			};
+
+			struct FrameResources{
+				std::unique_ptr<Buffer> shadows{};
+				VkDescriptorSet shadow_set = VK_NULL_HANDLE;
+			};
+
+			void create_frame_resources();
+			void create_pipeline_layout();
+			void create_pipeline();
+			void write_descriptors(FrameResources& frame);
+			// power of two tile size for a light of range at position, from its size on screen
+			uint32_t wanted_tile_size(const glm::vec3& position, float range, const Camera& camera, VkExtent2D extent) const;
+			// all six faces or none, halving the size until they fit
+			bool allocate(LightShadow& shadow, uint32_t size);
+			void free(LightShadow& shadow);
+			LightShadow& shadow_of(Entity entity);
+
+			Device& device;
+			ShadowAtlas atlas;
+			std::unique_ptr<Pipeline> be_pipeline;
+			VkPipelineLayout pipeline_layout;
+
+			std::unique_ptr<DescriptorSetLayout> shadow_set_layout;
+			std::unique_ptr<DescriptorPool> shadow_pool;
+			std::vector<FrameResources> frames;
+
+			std::vector<LightShadow> shadows;
+			// entity indices with allocated faces
+			std::vector<uint32_t> allocated;
+			uint64_t update_count = 0;
+
+			// rebuilt every update(): wanted tile size and point light slot of the lights in view
+			std::vector<std::pair<uint32_t, uint32_t>> candidates;
+			std::vector<DirtyLight> dirty_lights;
+			std::vector<Entity> casters;
+	};
+
+}
@@ -33,6 +33,8 @@ namespace blikaengine{
 				throw std::runtime_error("swap chain image/depth format has changed");
 			}
 		}
+		depth_pyramid = std::make_unique<DepthPyramid>(device, *swap_chain);
+		transparency_resolve = std::make_unique<TransparencyResolve>(device, *swap_chain);
 	}
 
 	void Renderer::create_command_buffers(){
@@ -101,9 +103,12 @@ namespace blikaengine{
 		render_pass_info.renderArea.offset = {0,0};
 		render_pass_info.renderArea.extent = swap_chain->getSwapChainExtent();
 
-		std::array<VkClearValue, 2> clear_values{};
+		std::array<VkClearValue, 4> clear_values{};
 		clear_values[0].color = {0.01f,0.01f,0.01f,1.0f};
 		clear_values[1].depthStencil = {1.0f,0};
+		// accumulation starts empty, revealage fully revealed
+		clear_values[2].color = {0.0f,0.0f,0.0f,0.0f};
+		clear_values[3].color = {1.0f,0.0f,0.0f,0.0f};
 
 		render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
 		render_pass_info.pClearValues = clear_values.data();
@@ -121,9 +126,23 @@ namespace blikaengine{
 		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
 		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 	}
+	void Renderer::begin_transparent_subpass(VkCommandBuffer command_buffer){
+		assert(is_frame_started && "can't call begin_transparent_subpass while not in progress");
+		assert(command_buffer == get_current_command_buffer() && "can't change subpass on command buffer from a different frame");
+		vkCmdNextSubpass(command_buffer, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
 	void Renderer::end_swap_chain_render_pass(VkCommandBuffer command_buffer){
 		assert(is_frame_started && "can't call end_swap_chain_render_pass while not in progress");
 		assert(command_buffer == get_current_command_buffer() && "can't end render pass on command buffer from a different frame");
+		vkCmdNextSubpass(command_buffer, VK_SUBPASS_CONTENTS_INLINE);
+		transparency_resolve->resolve(command_buffer, current_image_index);
 		vkCmdEndRenderPass(command_buffer);
 	}
+
+	void Renderer::build_depth_pyramid(VkCommandBuffer command_buffer, const glm::mat4& view_projection){
+		assert(is_frame_started && "can't call build_depth_pyramid while not in progress");
+		assert(command_buffer == get_current_command_buffer() && "can't build the depth pyramid on command buffer from a different frame");
+		depth_pyramid->build(command_buffer, current_image_index, view_projection);
+	}
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
+#include "depth_pyramid.hpp"
 #include "device.hpp"
 #include "swap_chain.hpp"
+#include "transparency_resolve.hpp"
 #include "window.hpp"
 
 #include <cassert>
@@ -27,6 +29,10 @@ namespace blikaengine{
 				return swap_chain->getRenderPass();
 			}
 
+			VkExtent2D get_swap_chain_extent() const{
+				return swap_chain->getSwapChainExtent();
+			}
+
 			float get_aspect_ratio() const{
 				return swap_chain->extentAspectRatio();
 			}
@@ -42,8 +48,19 @@ namespace blikaengine{
 
 			VkCommandBuffer begin_frame();
 			void end_frame();
+			// starts in the opaque subpass
 			void begin_swap_chain_render_pass(VkCommandBuffer command_buffer);
+			// transparent pipelines (Pipeline::enable_weighted_blending()) draw from here on, in any order
+			void begin_transparent_subpass(VkCommandBuffer command_buffer);
+			// resolves the transparency over the opaque image and ends the pass
 			void end_swap_chain_render_pass(VkCommandBuffer command_buffer);
+			// after the swap chain render pass, view_projection is what the frame was rendered with
+			void build_depth_pyramid(VkCommandBuffer command_buffer, const glm::mat4& view_projection);
+
+			// recreated with the swap chain, only hold on to it for the frame
+			DepthPyramid& get_depth_pyramid() const{
+				return *depth_pyramid;
+			}
 
 			int get_frame_index()const{
 				assert(is_frame_started && "cannot get frame index when frame is not in progress");
@@ -58,6 +75,8 @@ namespace blikaengine{
 			Window& window;
 			Device& device;
 			std::unique_ptr<SwapChain> swap_chain;
+			std::unique_ptr<DepthPyramid> depth_pyramid;
+			std::unique_ptr<TransparencyResolve> transparency_resolve;
 			std::vector<VkCommandBuffer> command_buffers;
 
 			uint32_t current_image_index;
@@ -0,0 +1,265 @@
+#include "scene.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace blikaengine{
+
+	Entity Scene::create_entity(){
+		Entity entity{};
+		if(!free_indices.empty()){
+			entity.index = free_indices.back();
+			free_indices.pop_back();
+		}else{
+			entity.index = static_cast<uint32_t>(generations.size());
+			generations.push_back(0);
+		}
+		entity.generation = generations[entity.index];
+		return entity;
+	}
+
+	void Scene::destroy_entity(Entity entity){
+		if(!is_alive(entity)){
+			return;
+		}
+		if(SpatialEntry* entry = spatial_entries.find(entity)){
+			if(entry->leaf != Bvh::NULL_NODE){
+				bvh.remove(entry->leaf);
+			}
+			spatial_entries.remove(entity);
+		}
+		transforms.remove(entity);
+		renderables.remove(entity);
+		point_lights.remove(entity);
+		generations[entity.index]++;
+		free_indices.push_back(entity.index);
+	}
+
+	void Scene::clear(){
+		transforms.clear();
+		renderables.clear();
+		point_lights.clear();
+		spatial_entries.clear();
+		bvh.clear();
+		moved_entities.clear();
+		dirty_transforms.clear();
+		child_lists.clear();
+		// bump every generation so no old handle stays valid
+		free_indices.clear();
+		for(uint32_t i = 0; i < generations.size(); i++){
+			generations[i]++;
+			free_indices.push_back(i);
+		}
+	}
+
+	void Scene::set_parent(Entity child, Entity parent){
+		TransformComponent& transform = transforms.get(child);
+		for(Entity ancestor = parent; ancestor.valid(); ancestor = transforms.get(ancestor).parent){
+			assert(ancestor != child && "transform hierarchy cannot contain cycles");
+		}
+		if(transform.parent.valid() && transform.parent.index < child_lists.size()){
+			std::vector<Entity>& siblings = child_lists[transform.parent.index];
+			siblings.erase(std::remove(siblings.begin(), siblings.end(), child), siblings.end());
+		}
+		if(parent.valid()){
+			if(parent.index >= child_lists.size()){
+				child_lists.resize(parent.index + 1);
+			}
+			child_lists[parent.index].push_back(child);
+		}
+		transform.parent = parent;
+		transform.mark_dirty();
+	}
+
+	void Scene::link_transforms(){
+		dirty_transforms.clear();
+		for(auto& children : child_lists){
+			children.clear();
+		}
+		child_lists.resize(generations.size());
+		for(size_t i = 0; i < transforms.size(); i++){
+			TransformComponent& transform = transforms[i];
+			Entity entity = transforms.entity(i);
+			transform.link.dirty_entities = &dirty_transforms;
+			transform.link.entity = entity;
+			if(transform.parent.valid() && !transforms.has(transform.parent)){
+				transform.parent = Entity{};
+				transform.dirty = true;
+			}
+			if(transform.parent.valid()){
+				child_lists[transform.parent.index].push_back(entity);
+			}
+			if(transform.dirty){
+				dirty_transforms.push_back(entity);
+			}
+		}
+		linked_transforms_version = transforms.get_version();
+	}
+
+	void Scene::update_transforms(){
+		if(linked_transforms_version != transforms.get_version()){
+			link_transforms();
+		}
+		update_pass++;
+		local_batch.clear();
+		// clean transforms below clean parents never change, only what was reported is looked at
+		pending_transforms.clear();
+		for(Entity entity : dirty_transforms){
+			TransformComponent& transform = transforms.get(entity);
+			transform.batch_index = static_cast<uint32_t>(local_batch.size());
+			local_batch.push_back(transform.translation, transform.rotation, transform.scale);
+			pending_transforms.push_back(entity);
+		}
+		dirty_transforms.clear();
+		local_matrices.resize(local_batch.size());
+		local_normal_matrices.resize(local_batch.size());
+		local_batch.compute(local_matrices.data(), local_normal_matrices.data());
+
+		// update_transform() appends the children of everything it recomputes
+		for(size_t i = 0; i < pending_transforms.size(); i++){
+			update_transform(transforms.slot(pending_transforms[i]));
+		}
+	}
+
+	// visits each transform once per pass, parents before their children
+	void Scene::update_transform(size_t slot){
+		TransformComponent& transform = transforms[slot];
+		if(transform.update_pass == update_pass){
+			return;
+		}
+		transform.update_pass = update_pass;
+		// parents of every transform exist at this point, update_transforms() detached the others
+		TransformComponent* parent = nullptr;
+		if(transform.parent.valid()){
+			size_t parent_slot = transforms.slot(transform.parent);
+			update_transform(parent_slot);
+			parent = &transforms[parent_slot];
+		}
+		if(!transform.dirty && (parent == nullptr || parent->world_version == transform.parent_version)){
+			return;
+		}
+		glm::mat4 local_matrix;
+		glm::mat3 local_normal_matrix;
+		if(transform.dirty){
+			local_matrix = local_matrices[transform.batch_index];
+			local_normal_matrix = local_normal_matrices[transform.batch_index];
+		}else{
+			local_matrix = transform.mat4();
+			local_normal_matrix = transform.normal_matrix();
+		}
+		if(parent != nullptr){
+			// (P * L)^-T = P^-T * L^-T, so normal matrices compose like the world matrices
+			transform.world_matrix = parent->world_matrix * local_matrix;
+			transform.world_normal_matrix = parent->world_normal_matrix * local_normal_matrix;
+			transform.parent_version = parent->world_version;
+		}else{
+			transform.world_matrix = local_matrix;
+			transform.world_normal_matrix = local_normal_matrix;
+		}
+		transform.world_version++;
+		transform.dirty = false;
+		Entity entity = transforms.entity(slot);
+		moved_entities.push_back(entity);
+		if(entity.index < child_lists.size()){
+			pending_transforms.insert(pending_transforms.end(), child_lists[entity.index].begin(), child_lists[entity.index].end());
+		}
+	}
+
+	void Scene::update_bounds(){
+		const uint64_t versions[3] = {transforms.get_version(), renderables.get_version(), point_lights.get_version()};
+		if(!std::equal(std::begin(versions), std::end(versions), std::begin(synced_versions))){
+			sync_spatial_entries();
+			std::copy(std::begin(versions), std::end(versions), std::begin(synced_versions));
+		}else{
+			for(Entity entity : moved_entities){
+				SpatialEntry* entry = spatial_entries.find(entity);
+				if(entry == nullptr){
+					continue;
+				}
+				const TransformComponent& transform = transforms.get(entity);
+				if(entry->transform_version != transform.world_version){
+					RenderableComponent* renderable = renderables.find(entity);
+					update_spatial_entry(entity, *entry, transform, renderable ? renderable->model.get() : nullptr, point_lights.find(entity));
+				}
+			}
+		}
+		moved_entities.clear();
+		bvh.refit();
+	}
+
+	void Scene::sync_spatial_entries(){
+		// drop entries first, a reused entity index must not find the old entry still in place
+		for(size_t i = 0; i < spatial_entries.size();){
+			Entity entity = spatial_entries.entity(i);
+			RenderableComponent* renderable = renderables.find(entity);
+			bool needed = transforms.has(entity) && ((renderable != nullptr && renderable->model != nullptr) || point_lights.has(entity));
+			if(needed){
+				i++;
+				continue;
+			}
+			if(spatial_entries[i].leaf != Bvh::NULL_NODE){
+				bvh.remove(spatial_entries[i].leaf);
+			}
+			spatial_entries.remove(entity);
+		}
+		for(size_t i = 0; i < renderables.size(); i++){
+			Entity entity = renderables.entity(i);
+			if(renderables[i].model != nullptr && transforms.has(entity) && !spatial_entries.has(entity)){
+				spatial_entries.add(entity);
+			}
+		}
+		for(size_t i = 0; i < point_lights.size(); i++){
+			Entity entity = point_lights.entity(i);
+			if(transforms.has(entity) && !spatial_entries.has(entity)){
+				spatial_entries.add(entity);
+			}
+		}
+		for(size_t i = 0; i < spatial_entries.size(); i++){
+			Entity entity = spatial_entries.entity(i);
+			SpatialEntry& entry = spatial_entries[i];
+			const TransformComponent& transform = transforms.get(entity);
+			RenderableComponent* renderable = renderables.find(entity);
+			const Model* model = renderable ? renderable->model.get() : nullptr;
+			const PointLightComponent* light = point_lights.find(entity);
+			if(entry.leaf == Bvh::NULL_NODE || entry.transform_version != transform.world_version || entry.model != model || entry.light != (light != nullptr)){
+				update_spatial_entry(entity, entry, transform, model, light);
+			}
+		}
+	}
+
+	void Scene::update_spatial_entry(Entity entity, SpatialEntry& entry, const TransformComponent& transform, const Model* model, const PointLightComponent* light){
+		AABB bounds{};
+		if(model != nullptr){
+			bounds = model->get_bounds().transformed(transform.get_world_matrix());
+		}
+		if(light != nullptr){
+			// the billboard, radius is in scale.x
+			glm::vec3 center = transform.get_world_position();
+			glm::vec3 radius{glm::abs(transform.get_scale().x)};
+			bounds.expand(center - radius);
+			bounds.expand(center + radius);
+		}
+		entry.transform_version = transform.world_version;
+		entry.model = model;
+		entry.light = light != nullptr;
+		if(entry.leaf == Bvh::NULL_NODE){
+			entry.leaf = bvh.insert(bounds, entity);
+		}else{
+			bvh.update(entry.leaf, bounds);
+		}
+	}
+
+	Entity Scene::create_point_light(float intensity, float radius, glm::vec3 color, float range){
+		Entity entity = create_entity();
+		TransformComponent transform{};
+		transform.set_scale({radius, 1.f, 1.f});
+		transforms.add(entity, transform);
+		PointLightComponent light{};
+		light.light_intensity = intensity;
+		light.color = color;
+		light.range = range;
+		point_lights.add(entity, light);
+		return entity;
+	}
+}
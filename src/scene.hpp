@@ -0,0 +1,177 @@
+#pragma once
+
+#include "bvh.hpp"
+#include "components.hpp"
+#include "entity.hpp"
+#include "transform_batch.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace blikaengine{
+
+	// Sparse set: components are packed in one contiguous array (in no particular order), the sparse
+	// array maps entity indices to their slot. Iterating visits only entities that have the component,
+	// add / remove / lookup are O(1). Removing moves the last component into the hole, so references
+	// and dense indices are invalidated by add and remove, handles are not.
+	template<typename T>
+	class ComponentPool{
+		public:
+			T& add(Entity entity, T component = T{}){
+				assert(entity.index != Entity::INVALID_INDEX && "invalid entity");
+				assert(!has(entity) && "entity already has this component");
+				if(entity.index >= sparse.size()){
+					sparse.resize(entity.index + 1, Entity::INVALID_INDEX);
+				}
+				sparse[entity.index] = static_cast<uint32_t>(dense.size());
+				dense.push_back(entity);
+				version++;
+				components.push_back(std::move(component));
+				return components.back();
+			}
+
+			void remove(Entity entity){
+				if(!has(entity)){
+					return;
+				}
+				uint32_t slot = sparse[entity.index];
+				uint32_t last = static_cast<uint32_t>(dense.size() - 1);
+				if(slot != last){
+					components[slot] = std::move(components[last]);
+					dense[slot] = dense[last];
+					sparse[dense[slot].index] = slot;
+				}
+				components.pop_back();
+				dense.pop_back();
+				sparse[entity.index] = Entity::INVALID_INDEX;
+				version++;
+			}
+
+			bool has(Entity entity) const{
+				return entity.index < sparse.size() && sparse[entity.index] != Entity::INVALID_INDEX && dense[sparse[entity.index]] == entity;
+			}
+
+			T& get(Entity entity){
+				assert(has(entity) && "entity does not have this component");
+				return components[sparse[entity.index]];
+			}
+
+			// nullptr if the entity does not have the component
+			T* find(Entity entity){
+				return has(entity) ? &components[sparse[entity.index]] : nullptr;
+			}
+
+			// dense index of the entity's component
+			size_t slot(Entity entity) const{
+				assert(has(entity) && "entity does not have this component");
+				return sparse[entity.index];
+			}
+
+			void reserve(size_t count){
+				dense.reserve(count);
+				components.reserve(count);
+			}
+
+			void clear(){
+				sparse.clear();
+				dense.clear();
+				components.clear();
+				version++;
+			}
+
+			// changes whenever a component is added or removed
+			uint64_t get_version() const{ return version; }
+
+			// dense access, for linear iteration: for(size_t i = 0; i < pool.size(); i++) pool[i], pool.entity(i)
+			size_t size() const{ return components.size(); }
+			bool empty() const{ return components.empty(); }
+			T& operator[](size_t slot){ return components[slot]; }
+			Entity entity(size_t slot) const{ return dense[slot]; }
+			T* data(){ return components.data(); }
+
+			typename std::vector<T>::iterator begin(){ return components.begin(); }
+			typename std::vector<T>::iterator end(){ return components.end(); }
+
+		private:
+			std::vector<uint32_t> sparse{};
+			std::vector<Entity> dense{};
+			std::vector<T> components{};
+			uint64_t version = 0;
+	};
+
+	class Scene{
+		public:
+			Scene() = default;
+			Scene(const Scene&) = delete;
+			Scene& operator = (const Scene&) = delete;
+
+			Entity create_entity();
+			// removes all components, the handle (and copies of it) become stale
+			void destroy_entity(Entity entity);
+			bool is_alive(Entity entity) const{
+				return entity.index < generations.size() && generations[entity.index] == entity.generation;
+			}
+			size_t get_entity_count() const{ return generations.size() - free_indices.size(); }
+			void clear();
+
+			// entity with a transform and a point light, radius (of the billboard) is stored in transform.scale.x
+			Entity create_point_light(float intensity = 10.f, float radius = 0.1f, glm::vec3 color = glm::vec3(1.f), float range = 10.f);
+
+			// both need a transform, an invalid parent detaches the child. Children of destroyed entities become roots.
+			void set_parent(Entity child, Entity parent);
+			// recomputes world matrices of dirty transforms and of everything below a changed parent. Costs
+			// what changed, unless transforms were added or removed since the last update, which takes one
+			// pass over all of them to link them to the scene
+			void update_transforms();
+			// Brings the bvh up to date with the world bounds of everything that has a transform and a model
+			// or a point light, run after update_transforms(). Only moved entities are touched unless
+			// components were added or removed. Swapping the model of an existing renderable is not noticed,
+			// remove and re-add the component instead.
+			void update_bounds();
+			const Bvh& get_bvh() const{ return bvh; }
+
+			ComponentPool<TransformComponent> transforms;
+			ComponentPool<RenderableComponent> renderables;
+			ComponentPool<PointLightComponent> point_lights;
+
+		private:
+			// an entity's leaf in the bvh and what its box was built from
+			struct SpatialEntry{
+				int32_t leaf = Bvh::NULL_NODE;
+				uint32_t transform_version = 0;
+				const Model* model = nullptr;
+				bool light = false;
+			};
+
+			// links every transform to dirty_transforms, detaches children of removed parents and rebuilds
+			// child_lists, after transforms were added or removed
+			void link_transforms();
+			void update_transform(size_t slot);
+			// adds / removes spatial entries to match the components, refreshes the ones that changed
+			void sync_spatial_entries();
+			void update_spatial_entry(Entity entity, SpatialEntry& entry, const TransformComponent& transform, const Model* model, const PointLightComponent* light);
+
+			uint32_t update_pass = 0;
+			// local matrices of the dirty transforms, built in one vectorized batch per update
+			TransformBatch local_batch{};
+			std::vector<glm::mat4> local_matrices{};
+			std::vector<glm::mat3> local_normal_matrices{};
+			// reported by the transforms' setters and set_parent() as they turn dirty
+			std::vector<Entity> dirty_transforms{};
+			// dirty transforms and the children of recomputed ones, in one update_transforms() pass
+			std::vector<Entity> pending_transforms{};
+			// children of every parent, by the parent's entity index
+			std::vector<std::vector<Entity>> child_lists{};
+			uint64_t linked_transforms_version = ~0ull;
+			// entities whose world matrix changed since the last update_bounds()
+			std::vector<Entity> moved_entities{};
+
+			Bvh bvh{};
+			ComponentPool<SpatialEntry> spatial_entries{};
+			// component pool versions the spatial entries were last synced with
+			uint64_t synced_versions[3] = {~0ull, ~0ull, ~0ull};
+			std::vector<uint32_t> generations{};
+			std::vector<uint32_t> free_indices{};
+	};
+}
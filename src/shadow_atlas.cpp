@@ -0,0 +1,169 @@
+#include "shadow_atlas.hpp"
+#include "upload_manager.hpp"
+
+#include <array>
+#include <stdexcept>
+
+namespace blikaengine{
+
+	ShadowAtlas::ShadowAtlas(Device& device): device{device}{
+		create_image();
+		create_sampler();
+		create_render_pass();
+		create_framebuffer();
+	}
+
+	ShadowAtlas::~ShadowAtlas(){
+		vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+		vkDestroyRenderPass(device.device(), render_pass, nullptr);
+		vkDestroySampler(device.device(), sampler, nullptr);
+		vkDestroyImageView(device.device(), image_view, nullptr);
+		vkDestroyImage(device.device(), image, nullptr);
+		device.freeMemory(image_memory);
+	}
+
+	void ShadowAtlas::create_image(){
+		VkImageCreateInfo image_info{};
+		image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		image_info.imageType = VK_IMAGE_TYPE_2D;
+		image_info.extent = {SIZE, SIZE, 1};
+		image_info.mipLevels = 1;
+		image_info.arrayLayers = 1;
+		image_info.format = FORMAT;
+		image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+		image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, image_memory);
+
+		VkImageViewCreateInfo view_info{};
+		view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		view_info.image = image;
+		view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		view_info.format = FORMAT;
+		view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		view_info.subresourceRange.baseMipLevel = 0;
+		view_info.subresourceRange.levelCount = 1;
+		view_info.subresourceRange.baseArrayLayer = 0;
+		view_info.subresourceRange.layerCount = 1;
+		if(vkCreateImageView(device.device(), &view_info, nullptr, &image_view) != VK_SUCCESS){
+			throw std::runtime_error("failed to create shadow atlas image view");
+		}
+
+		// into the layout the render pass expects once, ahead of the first frame. Tiles are always
+		// rendered before they are sampled, so the undefined contents are never read
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = view_info.subresourceRange;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(device.uploadManager().graphics_commands(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	void ShadowAtlas::create_sampler(){
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), FORMAT, &properties);
+		// hardware 2x2 pcf where the format can be filtered
+		VkFilter filter = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+		VkSamplerCreateInfo sampler_info{};
+		sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		sampler_info.magFilter = filter;
+		sampler_info.minFilter = filter;
+		sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.compareEnable = VK_TRUE;
+		sampler_info.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		sampler_info.minLod = 0.f;
+		sampler_info.maxLod = 0.f;
+		if(vkCreateSampler(device.device(), &sampler_info, nullptr, &sampler) != VK_SUCCESS){
+			throw std::runtime_error("failed to create shadow atlas sampler");
+		}
+	}
+
+	void ShadowAtlas::create_render_pass(){
+		VkAttachmentDescription depth_attachment{};
+		depth_attachment.format = FORMAT;
+		depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		// tiles not drawn this frame keep their cached depth, drawn ones are cleared per tile
+		depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depth_attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		VkAttachmentReference depth_ref{0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 0;
+		subpass.pDepthStencilAttachment = &depth_ref;
+
+		std::array<VkSubpassDependency, 2> dependencies{};
+		// earlier frames still sampling the tiles about to be redrawn
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].srcAccessMask = 0;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		// the lighting later in the frame samples them
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkRenderPassCreateInfo render_pass_info{};
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		render_pass_info.attachmentCount = 1;
+		render_pass_info.pAttachments = &depth_attachment;
+		render_pass_info.subpassCount = 1;
+		render_pass_info.pSubpasses = &subpass;
+		render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		render_pass_info.pDependencies = dependencies.data();
+		if(vkCreateRenderPass(device.device(), &render_pass_info, nullptr, &render_pass) != VK_SUCCESS){
+			throw std::runtime_error("failed to create shadow atlas render pass");
+		}
+	}
+
+	void ShadowAtlas::create_framebuffer(){
+		VkFramebufferCreateInfo framebuffer_info{};
+		framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebuffer_info.renderPass = render_pass;
+		framebuffer_info.attachmentCount = 1;
+		framebuffer_info.pAttachments = &image_view;
+		framebuffer_info.width = SIZE;
+		framebuffer_info.height = SIZE;
+		framebuffer_info.layers = 1;
+		if(vkCreateFramebuffer(device.device(), &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS){
+			throw std::runtime_error("failed to create shadow atlas framebuffer");
+		}
+	}
+
+	void ShadowAtlas::begin_render_pass(VkCommandBuffer command_buffer){
+		VkRenderPassBeginInfo render_pass_info{};
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		render_pass_info.renderPass = render_pass;
+		render_pass_info.framebuffer = framebuffer;
+		render_pass_info.renderArea.offset = {0, 0};
+		render_pass_info.renderArea.extent = {SIZE, SIZE};
+		vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	void ShadowAtlas::end_render_pass(VkCommandBuffer command_buffer){
+		vkCmdEndRenderPass(command_buffer);
+	}
+
+	VkDescriptorImageInfo ShadowAtlas::descriptor_info() const{
+		return {sampler, image_view, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "device.hpp"
+#include "tile_allocator.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace blikaengine{
+
+	// One depth image all shadow maps are rendered into, tiles handed out by a TileAllocator. Outside of
+	// its render pass the image stays in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, and the pass loads
+	// it, so tiles that aren't re-rendered keep their depth from earlier frames.
+	class ShadowAtlas{
+		public:
+			static constexpr uint32_t SIZE = 4096;
+			static constexpr uint32_t MIN_TILE_SIZE = 64;
+			static constexpr VkFormat FORMAT = VK_FORMAT_D16_UNORM;
+
+			ShadowAtlas(Device& device);
+			~ShadowAtlas();
+			ShadowAtlas(const ShadowAtlas&) = delete;
+			ShadowAtlas& operator = (const ShadowAtlas&) = delete;
+
+			// the whole atlas is the render area, draws are restricted to their tile by viewport and scissor
+			void begin_render_pass(VkCommandBuffer command_buffer);
+			void end_render_pass(VkCommandBuffer command_buffer);
+
+			TileAllocator& get_allocator(){ return allocator; }
+			VkRenderPass get_render_pass() const{ return render_pass; }
+			// with a comparison sampler, for sampler2DShadow
+			VkDescriptorImageInfo descriptor_info() const;
+
+		private:
+			void create_image();
+			void create_sampler();
+			void create_render_pass();
+			void create_framebuffer();
+
+			Device& device;
+			TileAllocator allocator{SIZE, MIN_TILE_SIZE};
+
+			VkImage image = VK_NULL_HANDLE;
+			Allocation image_memory{};
+			VkImageView image_view = VK_NULL_HANDLE;
+			VkSampler sampler = VK_NULL_HANDLE;
+			VkRenderPass render_pass = VK_NULL_HANDLE;
+			VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	};
+}
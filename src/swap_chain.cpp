@@ -20,10 +20,15 @@ namespace blikaengine{
 	}
 
 	void SwapChain::init(){
-		createSwapChain();
+		if(device.isHeadless()){
+			createOffscreenImages();
+		}else{
+			createSwapChain();
+		}
 		createImageViews();
 		createRenderPass();
 		createDepthResources();
+		createTransparencyResources();
 		createFramebuffers();
 		createSyncObjects();
 	}
@@ -39,10 +44,24 @@ namespace blikaengine{
 			swapChain = 0;
 		}
 
+		for(size_t i = 0; i < offscreenImageMemorys.size(); i++){
+			vkDestroyImage(device.device(), swapChainImages[i], nullptr);
+			device.freeMemory(offscreenImageMemorys[i]);
+		}
+
 		for(int i = 0; i < depthImages.size(); i++){
 			vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
 			vkDestroyImage(device.device(), depthImages[i], nullptr);
-			vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+			device.freeMemory(depthImageMemorys[i]);
+		}
+
+		for(size_t i = 0; i < accumImages.size(); i++){
+			vkDestroyImageView(device.device(), accumImageViews[i], nullptr);
+			vkDestroyImage(device.device(), accumImages[i], nullptr);
+			device.freeMemory(accumImageMemorys[i]);
+			vkDestroyImageView(device.device(), revealageImageViews[i], nullptr);
+			vkDestroyImage(device.device(), revealageImages[i], nullptr);
+			device.freeMemory(revealageImageMemorys[i]);
 		}
 
 		for(auto framebuffer : swapChainFramebuffers){
@@ -60,6 +79,11 @@ namespace blikaengine{
 
 	VkResult SwapChain::acquireNextImage(uint32_t *imageIndex){
 		vkWaitForFences(device.device(),1,&inFlightFences[currentFrame],VK_TRUE,std::numeric_limits<uint64_t>::max());
+		if(device.isHeadless()){
+			*imageIndex = nextOffscreenImage;
+			nextOffscreenImage = (nextOffscreenImage + 1) % static_cast<uint32_t>(imageCount());
+			return VK_SUCCESS;
+		}
 		VkResult result = vkAcquireNextImageKHR(device.device(),swapChain,std::numeric_limits<uint64_t>::max(),imageAvailableSemaphores[currentFrame],VK_NULL_HANDLE,imageIndex);
 		return result;
 	}
@@ -73,9 +97,11 @@ namespace blikaengine{
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+		// headless frames are never acquired from or presented to a surface, so there is nothing to wait on or signal
+		const bool headless = device.isHeadless();
 		VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
 		VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.waitSemaphoreCount = headless ? 0 : 1;
 		submitInfo.pWaitSemaphores = waitSemaphores;
 		submitInfo.pWaitDstStageMask = waitStages;
 
@@ -83,7 +109,7 @@ namespace blikaengine{
 		submitInfo.pCommandBuffers = buffers;
 
 		VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.signalSemaphoreCount = headless ? 0 : 1;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
 		vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
@@ -91,6 +117,11 @@ namespace blikaengine{
 			throw std::runtime_error("failed to submit draw command buffer");
 		}
 
+		if(headless){
+			currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+			return VK_SUCCESS;
+		}
+
 		VkPresentInfoKHR presentInfo = {};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -166,6 +197,35 @@ namespace blikaengine{
 		swapChainExtent = extent;
 	}
 
+	void SwapChain::createOffscreenImages(){
+		// stands in for the surface images: one color target per frame in flight, left in
+		// TRANSFER_SRC layout after the render pass so they can be read back if needed
+		swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+		swapChainExtent = windowExtent;
+
+		swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+		offscreenImageMemorys.resize(MAX_FRAMES_IN_FLIGHT);
+		for(size_t i = 0; i < swapChainImages.size(); i++){
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.extent.width = swapChainExtent.width;
+			imageInfo.extent.height = swapChainExtent.height;
+			imageInfo.extent.depth = 1;
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.format = swapChainImageFormat;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.flags = 0;
+
+			device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImageMemorys[i]);
+		}
+	}
+
 	void SwapChain::createImageViews(){
 		swapChainImageViews.resize(swapChainImages.size());
 		for(size_t i = 0; i < swapChainImages.size(); i++){
@@ -191,11 +251,12 @@ namespace blikaengine{
 		depthAttachment.format = findDepthFormat();
 		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		// kept for the depth pyramid, which is reduced from it right after the pass
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
 		VkAttachmentReference depthAttachmentRef{};
 		depthAttachmentRef.attachment = 1;
@@ -209,35 +270,119 @@ namespace blikaengine{
 		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		colorAttachment.finalLayout = device.isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 		VkAttachmentReference colorAttachmentRef = {};
 		colorAttachmentRef.attachment = 0;
 		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-		VkSubpassDescription subpass = {};
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.colorAttachmentCount = 1;
-		subpass.pColorAttachments = &colorAttachmentRef;
-		subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-		VkSubpassDependency dependency = {};
-		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependency.srcAccessMask = 0;
-		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-		dependency.dstSubpass = 0;
-		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-		std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+		// weighted blended transparency targets, only live within the pass
+		VkAttachmentDescription accumAttachment = {};
+		accumAttachment.format = ACCUM_FORMAT;
+		accumAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		accumAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		accumAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		accumAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		accumAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		accumAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		accumAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		VkAttachmentDescription revealageAttachment = accumAttachment;
+		revealageAttachment.format = REVEALAGE_FORMAT;
+
+		std::array<VkAttachmentReference, 2> transparencyRefs{};
+		transparencyRefs[0] = {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+		transparencyRefs[1] = {3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+		VkAttachmentReference depthReadRef{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+		std::array<VkAttachmentReference, 2> resolveInputRefs{};
+		resolveInputRefs[0] = {2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+		resolveInputRefs[1] = {3, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+		uint32_t colorPreserve = 0;
+		uint32_t depthPreserve = 1;
+
+		std::array<VkSubpassDescription, 3> subpasses{};
+		subpasses[OPAQUE_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[OPAQUE_SUBPASS].colorAttachmentCount = 1;
+		subpasses[OPAQUE_SUBPASS].pColorAttachments = &colorAttachmentRef;
+		subpasses[OPAQUE_SUBPASS].pDepthStencilAttachment = &depthAttachmentRef;
+		// depth tested against but not written
+		subpasses[TRANSPARENT_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[TRANSPARENT_SUBPASS].colorAttachmentCount = static_cast<uint32_t>(transparencyRefs.size());
+		subpasses[TRANSPARENT_SUBPASS].pColorAttachments = transparencyRefs.data();
+		subpasses[TRANSPARENT_SUBPASS].pDepthStencilAttachment = &depthReadRef;
+		// the opaque image is not touched here but the resolve blends onto it
+		subpasses[TRANSPARENT_SUBPASS].preserveAttachmentCount = 1;
+		subpasses[TRANSPARENT_SUBPASS].pPreserveAttachments = &colorPreserve;
+		// composites the transparency targets over the color attachment
+		subpasses[RESOLVE_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[RESOLVE_SUBPASS].inputAttachmentCount = static_cast<uint32_t>(resolveInputRefs.size());
+		subpasses[RESOLVE_SUBPASS].pInputAttachments = resolveInputRefs.data();
+		subpasses[RESOLVE_SUBPASS].colorAttachmentCount = 1;
+		subpasses[RESOLVE_SUBPASS].pColorAttachments = &colorAttachmentRef;
+		subpasses[RESOLVE_SUBPASS].preserveAttachmentCount = 1;
+		subpasses[RESOLVE_SUBPASS].pPreserveAttachments = &depthPreserve;
+
+		std::array<VkSubpassDependency, 7> dependencies{};
+		// the compute stage covers the last depth pyramid reduction still reading the depth image
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].srcAccessMask = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		dependencies[0].dstSubpass = OPAQUE_SUBPASS;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		// the last resolve of this image's transparency targets is done reading them before they are cleared
+		dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].srcAccessMask = 0;
+		dependencies[1].dstSubpass = TRANSPARENT_SUBPASS;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		// transparent surfaces test against the opaque depth
+		dependencies[2].srcSubpass = OPAQUE_SUBPASS;
+		dependencies[2].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[2].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[2].dstSubpass = TRANSPARENT_SUBPASS;
+		dependencies[2].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[2].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+		// the resolve blends over the opaque color
+		dependencies[3].srcSubpass = OPAQUE_SUBPASS;
+		dependencies[3].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[3].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[3].dstSubpass = RESOLVE_SUBPASS;
+		dependencies[3].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[3].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[3].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+		// and reads the transparency targets as input attachments
+		dependencies[4].srcSubpass = TRANSPARENT_SUBPASS;
+		dependencies[4].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[4].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[4].dstSubpass = RESOLVE_SUBPASS;
+		dependencies[4].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[4].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+		dependencies[4].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+		// depth written by the pass is read by the depth pyramid reduction
+		dependencies[5].srcSubpass = OPAQUE_SUBPASS;
+		dependencies[5].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[5].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[5].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[5].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		dependencies[5].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		dependencies[6].srcSubpass = TRANSPARENT_SUBPASS;
+		dependencies[6].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[6].srcAccessMask = 0;
+		dependencies[6].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[6].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		dependencies[6].dstAccessMask = 0;
+
+		std::array<VkAttachmentDescription, 4> attachments = {colorAttachment, depthAttachment, accumAttachment, revealageAttachment};
 		VkRenderPassCreateInfo renderPassInfo = {};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
 		renderPassInfo.pAttachments = attachments.data();
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 1;
-		renderPassInfo.pDependencies = &dependency;
+		renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+		renderPassInfo.pSubpasses = subpasses.data();
+		renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		renderPassInfo.pDependencies = dependencies.data();
 
 		if(vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS){
 			throw std::runtime_error("failed to create render pass");
@@ -247,7 +392,7 @@ namespace blikaengine{
 	void SwapChain::createFramebuffers(){
 		swapChainFramebuffers.resize(imageCount());
 		for(size_t i = 0; i < imageCount(); i++){
-			std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthImageViews[i]};
+			std::array<VkImageView, 4> attachments = {swapChainImageViews[i], depthImageViews[i], accumImageViews[i], revealageImageViews[i]};
 
 			VkExtent2D swapChainExtent = getSwapChainExtent();
 			VkFramebufferCreateInfo framebufferInfo = {};
@@ -286,7 +431,7 @@ namespace blikaengine{
 			imageInfo.format = depthFormat;
 			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+			imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 			imageInfo.flags = 0;
@@ -310,6 +455,51 @@ namespace blikaengine{
 		}
 	}
 
+	void SwapChain::createTransparencyResources(){
+		VkExtent2D swapChainExtent = getSwapChainExtent();
+		auto createTarget = [&](VkFormat format, VkImage& image, Allocation& memory, VkImageView& view){
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.extent.width = swapChainExtent.width;
+			imageInfo.extent.height = swapChainExtent.height;
+			imageInfo.extent.depth = 1;
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.format = format;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory);
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = image;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = format;
+			viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			viewInfo.subresourceRange.baseMipLevel = 0;
+			viewInfo.subresourceRange.levelCount = 1;
+			viewInfo.subresourceRange.baseArrayLayer = 0;
+			viewInfo.subresourceRange.layerCount = 1;
+			if(vkCreateImageView(device.device(), &viewInfo, nullptr, &view) != VK_SUCCESS){
+				throw std::runtime_error("failed to create transparency image view");
+			}
+		};
+		accumImages.resize(imageCount());
+		accumImageMemorys.resize(imageCount());
+		accumImageViews.resize(imageCount());
+		revealageImages.resize(imageCount());
+		revealageImageMemorys.resize(imageCount());
+		revealageImageViews.resize(imageCount());
+		for(size_t i = 0; i < imageCount(); i++){
+			createTarget(ACCUM_FORMAT, accumImages[i], accumImageMemorys[i], accumImageViews[i]);
+			createTarget(REVEALAGE_FORMAT, revealageImages[i], revealageImageMemorys[i], revealageImageViews[i]);
+		}
+	}
+
 	void SwapChain::createSyncObjects(){
 		imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -371,6 +561,6 @@ namespace blikaengine{
 	}
 
 	VkFormat SwapChain::findDepthFormat() {
-		return device.findSupportedFormat({VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},VK_IMAGE_TILING_OPTIMAL,VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+		return device.findSupportedFormat({VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},VK_IMAGE_TILING_OPTIMAL,VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 	}
 }
@@ -13,6 +13,13 @@ namespace blikaengine{
 	class SwapChain {
 		public:
 			static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+			// the render pass draws opaque geometry, then transparent geometry into the weighted blended
+			// accumulation / revealage targets, then composites those over the color attachment
+			static constexpr uint32_t OPAQUE_SUBPASS = 0;
+			static constexpr uint32_t TRANSPARENT_SUBPASS = 1;
+			static constexpr uint32_t RESOLVE_SUBPASS = 2;
+			static constexpr VkFormat ACCUM_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+			static constexpr VkFormat REVEALAGE_FORMAT = VK_FORMAT_R16_SFLOAT;
 
 			SwapChain(Device &deviceRef, VkExtent2D windowExtent);
 			SwapChain(Device &deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous);
@@ -24,6 +31,11 @@ namespace blikaengine{
 			VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
 			VkRenderPass getRenderPass() { return renderPass; }
 			VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+			// left in DEPTH_STENCIL_READ_ONLY_OPTIMAL after the render pass
+			VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
+			// input attachments of the resolve subpass
+			VkImageView getAccumImageView(int index) { return accumImageViews[index]; }
+			VkImageView getRevealageImageView(int index) { return revealageImageViews[index]; }
 			size_t imageCount() { return swapChainImages.size(); }
 			VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
 			VkExtent2D getSwapChainExtent() { return swapChainExtent; }
@@ -45,8 +57,10 @@ namespace blikaengine{
 		private:
 			void init();
 			void createSwapChain();
+			void createOffscreenImages();
 			void createImageViews();
 			void createDepthResources();
+			void createTransparencyResources();
 			void createRenderPass();
 			void createFramebuffers();
 			void createSyncObjects();
@@ -63,15 +77,23 @@ namespace blikaengine{
 			VkRenderPass renderPass;
 
 			std::vector<VkImage> depthImages;
-			std::vector<VkDeviceMemory> depthImageMemorys;
+			std::vector<Allocation> depthImageMemorys;
 			std::vector<VkImageView> depthImageViews;
+			std::vector<VkImage> accumImages;
+			std::vector<Allocation> accumImageMemorys;
+			std::vector<VkImageView> accumImageViews;
+			std::vector<VkImage> revealageImages;
+			std::vector<Allocation> revealageImageMemorys;
+			std::vector<VkImageView> revealageImageViews;
 			std::vector<VkImage> swapChainImages;
 			std::vector<VkImageView> swapChainImageViews;
+			// only owned (and allocated) by the swap chain when rendering headless
+			std::vector<Allocation> offscreenImageMemorys;
 
 			Device &device;
 			VkExtent2D windowExtent;
 
-			VkSwapchainKHR swapChain;
+			VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 			std::shared_ptr<SwapChain> old_swap_chain;
 
 			std::vector<VkSemaphore> imageAvailableSemaphores;
@@ -79,5 +101,6 @@ namespace blikaengine{
 			std::vector<VkFence> inFlightFences;
 			std::vector<VkFence> imagesInFlight;
 			size_t currentFrame = 0;
+			uint32_t nextOffscreenImage = 0;
 	};
 }
\ No newline at end of file
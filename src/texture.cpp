@@ -1,7 +1,7 @@
 #include "texture.hpp"
 #include <vulkan/vulkan_core.h>
 #include "device.hpp"
-#include "buffer.hpp"
+#include "upload_manager.hpp"
 #include <stdexcept>
 #include <cmath>
 #include <iostream>
@@ -14,10 +14,6 @@ namespace blikaengine{
         
         mip_levels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
 
-        Buffer buffer{device, 4, static_cast<uint32_t>(width*height), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-        buffer.map();
-        buffer.writeToBuffer(data);
-
         image_format = VK_FORMAT_R8G8B8A8_SRGB;
         VkImageCreateInfo info{};
         info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -32,10 +28,12 @@ namespace blikaengine{
         info.extent = {static_cast<uint32_t>(width),static_cast<uint32_t>(height),1};
         info.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
         device.createImageWithInfo(info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, image_memory);
-        transition_image_layout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        device.copyBufferToImage(buffer.getBuffer(), image, static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1);
 
-        generate_mipmaps();
+        // copy on the transfer queue, mip chain on the graphics queue once the copy has landed
+        UploadManager& uploads = device.uploadManager();
+        transition_image_layout(uploads.transfer_commands(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        uploads.upload_image(data, 4, image, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+        generate_mipmaps(uploads.graphics_commands());
         image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
         VkSamplerCreateInfo sampler_info{};
@@ -73,13 +71,12 @@ namespace blikaengine{
 
     Texture::~Texture(){
         vkDestroyImage(device.device(), image, nullptr);
-        vkFreeMemory(device.device(), image_memory, nullptr);
+        device.freeMemory(image_memory);
         vkDestroyImageView(device.device(), image_view, nullptr);
         vkDestroySampler(device.device(), sampler, nullptr);
     }
 
-    void Texture::transition_image_layout(VkImageLayout old_layout, VkImageLayout new_layout){
-        VkCommandBuffer command_buffer = device.beginSingleTimeCommands();
+    void Texture::transition_image_layout(VkCommandBuffer command_buffer, VkImageLayout old_layout, VkImageLayout new_layout){
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.oldLayout = old_layout;
@@ -111,11 +108,10 @@ namespace blikaengine{
         }
 
         vkCmdPipelineBarrier(command_buffer, source_stage, destination_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-        device.endSingleTimeCommands(command_buffer);
     }
 
     
-    void Texture::generate_mipmaps() {
+    void Texture::generate_mipmaps(VkCommandBuffer commandBuffer) {
         VkFormatProperties formatProperties;
         vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), image_format, &formatProperties);
 
@@ -123,8 +119,6 @@ namespace blikaengine{
             throw std::runtime_error("texture image format does not support linear blitting!");
         }
 
-        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.image = image;
@@ -181,7 +175,5 @@ namespace blikaengine{
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
         vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-        device.endSingleTimeCommands(commandBuffer);
     }
 }
\ No newline at end of file
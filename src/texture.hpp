@@ -31,14 +31,14 @@ namespace blikaengine{
                 return image_layout;
             }
         private:
-            void transition_image_layout(VkImageLayout old_layout, VkImageLayout new_layout);
-            void generate_mipmaps();
+            void transition_image_layout(VkCommandBuffer command_buffer, VkImageLayout old_layout, VkImageLayout new_layout);
+            void generate_mipmaps(VkCommandBuffer command_buffer);
 
             int width, height, mip_levels;
 
             Device& device;
             VkImage image;
-            VkDeviceMemory image_memory;
+            Allocation image_memory;
             VkImageView image_view;
             VkSampler sampler;
             VkFormat image_format;
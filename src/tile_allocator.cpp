@@ -0,0 +1,95 @@
+#include "tile_allocator.hpp"
+
+#include <cassert>
+
+namespace blikaengine{
+
+	TileAllocator::TileAllocator(uint32_t atlas_size, uint32_t min_tile_size): atlas_size{atlas_size}, min_tile_size{min_tile_size}{
+		assert(atlas_size > 0 && (atlas_size & (atlas_size - 1)) == 0 && "atlas size has to be a power of two");
+		assert(min_tile_size > 0 && min_tile_size <= atlas_size && (min_tile_size & (min_tile_size - 1)) == 0 && "min tile size has to be a power of two");
+		free_cells.resize(level_of(min_tile_size) + 1);
+		clear();
+	}
+
+	uint32_t TileAllocator::level_of(uint32_t size) const{
+		uint32_t level = 0;
+		while((atlas_size >> level) > size){
+			level++;
+		}
+		return level;
+	}
+
+	void TileAllocator::clear(){
+		for(auto& cells : free_cells){
+			cells.clear();
+		}
+		free_cells[0].push_back({0, 0});
+	}
+
+	bool TileAllocator::allocate(uint32_t size, Tile& tile){
+		assert(size >= min_tile_size && size <= atlas_size && (size & (size - 1)) == 0 && "tile size has to be a power of two within the atlas limits");
+		const uint32_t level = level_of(size);
+		// smallest free cell that fits, split down to the requested size
+		int32_t source = static_cast<int32_t>(level);
+		while(source >= 0 && free_cells[source].empty()){
+			source--;
+		}
+		if(source < 0){
+			return false;
+		}
+		Cell cell = free_cells[source].back();
+		free_cells[source].pop_back();
+		for(uint32_t l = static_cast<uint32_t>(source); l < level; l++){
+			cell = {cell.x * 2, cell.y * 2};
+			free_cells[l + 1].push_back({cell.x + 1, cell.y});
+			free_cells[l + 1].push_back({cell.x, cell.y + 1});
+			free_cells[l + 1].push_back({cell.x + 1, cell.y + 1});
+		}
+		tile = {cell.x * size, cell.y * size, size};
+		return true;
+	}
+
+	// removes cell from the free list of level, false if it isn't free
+	bool TileAllocator::take(uint32_t level, Cell cell){
+		auto& cells = free_cells[level];
+		for(size_t i = 0; i < cells.size(); i++){
+			if(cells[i].x == cell.x && cells[i].y == cell.y){
+				cells[i] = cells.back();
+				cells.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void TileAllocator::free(const Tile& tile){
+		uint32_t level = level_of(tile.size);
+		Cell cell{tile.x / tile.size, tile.y / tile.size};
+		// merge with the siblings for as long as all of them are free
+		while(level > 0){
+			Cell first{cell.x & ~1u, cell.y & ~1u};
+			Cell siblings[3]{};
+			uint32_t sibling_count = 0;
+			for(uint32_t i = 0; i < 4; i++){
+				Cell other{first.x + (i & 1), first.y + (i >> 1)};
+				if(other.x != cell.x || other.y != cell.y){
+					siblings[sibling_count++] = other;
+				}
+			}
+			uint32_t taken = 0;
+			while(taken < 3 && take(level, siblings[taken])){
+				taken++;
+			}
+			if(taken < 3){
+				// put back what was taken, this level stays split
+				for(uint32_t i = 0; i < taken; i++){
+					free_cells[level].push_back(siblings[i]);
+				}
+				break;
+			}
+			cell = {first.x / 2, first.y / 2};
+			level--;
+		}
+		free_cells[level].push_back(cell);
+	}
+}
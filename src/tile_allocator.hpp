@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace blikaengine{
+
+	// Buddy allocator of square power of two tiles out of a square power of two atlas. Freed tiles
+	// merge back with their three siblings, so the atlas doesn't fragment permanently.
+	class TileAllocator{
+		public:
+			// in texels, from the top left corner of the atlas
+			struct Tile{
+				uint32_t x = 0;
+				uint32_t y = 0;
+				uint32_t size = 0;
+			};
+
+			TileAllocator(uint32_t atlas_size, uint32_t min_tile_size);
+
+			// size has to be a power of two between the min tile size and the atlas size, false if no room
+			bool allocate(uint32_t size, Tile& tile);
+			void free(const Tile& tile);
+			void clear();
+
+			uint32_t get_atlas_size() const{ return atlas_size; }
+			uint32_t get_min_tile_size() const{ return min_tile_size; }
+
+		private:
+			struct Cell{
+				uint32_t x;
+				uint32_t y;
+			};
+
+			uint32_t level_of(uint32_t size) const;
+			bool take(uint32_t level, Cell cell);
+
+			uint32_t atlas_size;
+			uint32_t min_tile_size;
+			// free cells per level, level l cells are atlas_size >> l texels wide
+			std::vector<std::vector<Cell>> free_cells;
+	};
+}
@@ -0,0 +1,311 @@
+#include "transform_batch.hpp"
+
+#include <cassert>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BLIKAENGINE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace blikaengine{
+
+	namespace{
+
+		struct Inputs{
+			const float* t[3];
+			const float* r[3];
+			const float* s[3];
+		};
+
+		// the nine rotation terms of TransformComponent::mat4() before scaling, column major
+		constexpr int ROTATION_TERMS = 9;
+
+		void compute_scalar(const Inputs& in, size_t begin, size_t end, glm::mat4* model, glm::mat3* normal){
+			for(size_t i = begin; i < end; i++){
+				TransformBatch::local_matrices({in.t[0][i], in.t[1][i], in.t[2][i]}, {in.r[0][i], in.r[1][i], in.r[2][i]}, {in.s[0][i], in.s[1][i], in.s[2][i]}, model[i], normal[i]);
+			}
+		}
+
+#ifdef BLIKAENGINE_X86
+		// The vector paths mirror sincos() and local_matrices() in the header operation for operation.
+		// Only plain mul / add / sub / div, no fma, so every lane rounds exactly like the scalar code.
+		// Lanes at or beyond MAX_ARGUMENT (or nan) are redone by the scalar sincos(), like it does itself.
+
+		void sincos_sse(__m128 x, __m128& sin, __m128& cos){
+			const __m128 argument = x;
+			const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+			__m128 sin_sign = _mm_and_ps(x, sign_mask);
+			x = _mm_andnot_ps(sign_mask, x);
+			__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(sincos_constants::FOUR_OVER_PI)));
+			octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+			const __m128 y = _mm_cvtepi32_ps(octant);
+			sin_sign = _mm_xor_ps(sin_sign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29)));
+			const __m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+			const __m128 use_sin = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+			x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(sincos_constants::DP1)));
+			x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(sincos_constants::DP2)));
+			x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(sincos_constants::DP3)));
+			const __m128 z = _mm_mul_ps(x, x);
+
+			__m128 c = _mm_mul_ps(_mm_set1_ps(sincos_constants::COS0), z);
+			c = _mm_mul_ps(_mm_add_ps(c, _mm_set1_ps(sincos_constants::COS1)), z);
+			c = _mm_mul_ps(_mm_add_ps(c, _mm_set1_ps(sincos_constants::COS2)), z);
+			c = _mm_mul_ps(c, z);
+			c = _mm_sub_ps(c, _mm_mul_ps(z, _mm_set1_ps(.5f)));
+			c = _mm_add_ps(c, _mm_set1_ps(1.f));
+			__m128 s = _mm_mul_ps(_mm_set1_ps(sincos_constants::SIN0), z);
+			s = _mm_mul_ps(_mm_add_ps(s, _mm_set1_ps(sincos_constants::SIN1)), z);
+			s = _mm_mul_ps(_mm_add_ps(s, _mm_set1_ps(sincos_constants::SIN2)), z);
+			s = _mm_add_ps(_mm_mul_ps(s, x), x);
+
+			sin = _mm_xor_ps(_mm_or_ps(_mm_and_ps(use_sin, s), _mm_andnot_ps(use_sin, c)), sin_sign);
+			cos = _mm_xor_ps(_mm_or_ps(_mm_and_ps(use_sin, c), _mm_andnot_ps(use_sin, s)), cos_sign);
+
+			const int out_of_range = _mm_movemask_ps(_mm_cmpnlt_ps(_mm_andnot_ps(sign_mask, argument), _mm_set1_ps(sincos_constants::MAX_ARGUMENT)));
+			if(out_of_range != 0){
+				alignas(16) float lanes[4], sins[4], coss[4];
+				_mm_store_ps(lanes, argument);
+				_mm_store_ps(sins, sin);
+				_mm_store_ps(coss, cos);
+				for(int lane = 0; lane < 4; lane++){
+					if(out_of_range & (1 << lane)){
+						sincos(lanes[lane], sins[lane], coss[lane]);
+					}
+				}
+				sin = _mm_load_ps(sins);
+				cos = _mm_load_ps(coss);
+			}
+		}
+
+		void compute_sse(const Inputs& in, size_t count, glm::mat4* model, glm::mat3* normal){
+			alignas(16) float normal_terms[ROTATION_TERMS][4];
+			const __m128 sign = _mm_set1_ps(-0.f);
+			const __m128 one = _mm_set1_ps(1.f);
+			size_t i = 0;
+			for(; i + 4 <= count; i += 4){
+				__m128 s1, c1, s2, c2, s3, c3;
+				sincos_sse(_mm_loadu_ps(in.r[1] + i), s1, c1);
+				sincos_sse(_mm_loadu_ps(in.r[0] + i), s2, c2);
+				sincos_sse(_mm_loadu_ps(in.r[2] + i), s3, c3);
+				const __m128 rotation[ROTATION_TERMS] = {
+					_mm_add_ps(_mm_mul_ps(c1, c3), _mm_mul_ps(_mm_mul_ps(s1, s2), s3)),
+					_mm_mul_ps(c2, s3),
+					_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(c1, s2), s3), _mm_mul_ps(c3, s1)),
+					_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(c3, s1), s2), _mm_mul_ps(c1, s3)),
+					_mm_mul_ps(c2, c3),
+					_mm_add_ps(_mm_mul_ps(_mm_mul_ps(c1, c3), s2), _mm_mul_ps(s1, s3)),
+					_mm_mul_ps(c2, s1),
+					_mm_xor_ps(s2, sign),
+					_mm_mul_ps(c1, c2)
+				};
+				__m128 columns[4][4];
+				for(int column = 0; column < 3; column++){
+					const __m128 scale = _mm_loadu_ps(in.s[column] + i);
+					const __m128 inv_scale = _mm_div_ps(one, scale);
+					for(int row = 0; row < 3; row++){
+						columns[column][row] = _mm_mul_ps(scale, rotation[column * 3 + row]);
+						_mm_store_ps(normal_terms[column * 3 + row], _mm_mul_ps(inv_scale, rotation[column * 3 + row]));
+					}
+					columns[column][3] = _mm_setzero_ps();
+				}
+				columns[3][0] = _mm_loadu_ps(in.t[0] + i);
+				columns[3][1] = _mm_loadu_ps(in.t[1] + i);
+				columns[3][2] = _mm_loadu_ps(in.t[2] + i);
+				columns[3][3] = one;
+				// one row per matrix element -> one column per matrix
+				for(int column = 0; column < 4; column++){
+					_MM_TRANSPOSE4_PS(columns[column][0], columns[column][1], columns[column][2], columns[column][3]);
+					for(int lane = 0; lane < 4; lane++){
+						_mm_storeu_ps(&model[i + lane][column][0], columns[column][lane]);
+					}
+				}
+				for(int lane = 0; lane < 4; lane++){
+					float* out = &normal[i + lane][0][0];
+					for(int term = 0; term < ROTATION_TERMS; term++){
+						out[term] = normal_terms[term][lane];
+					}
+				}
+			}
+			compute_scalar(in, i, count, model, normal);
+		}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BLIKAENGINE_AVX2 1
+		__attribute__((target("avx2")))
+		void sincos_avx2(__m256 x, __m256& sin, __m256& cos){
+			const __m256 argument = x;
+			const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
+			__m256 sin_sign = _mm256_and_ps(x, sign_mask);
+			x = _mm256_andnot_ps(sign_mask, x);
+			__m256i octant = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(sincos_constants::FOUR_OVER_PI)));
+			octant = _mm256_and_si256(_mm256_add_epi32(octant, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+			const __m256 y = _mm256_cvtepi32_ps(octant);
+			sin_sign = _mm256_xor_ps(sin_sign, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(4)), 29)));
+			const __m256 cos_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(octant, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+			const __m256 use_sin = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+
+			x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(sincos_constants::DP1)));
+			x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(sincos_constants::DP2)));
+			x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(sincos_constants::DP3)));
+			const __m256 z = _mm256_mul_ps(x, x);
+
+			__m256 c = _mm256_mul_ps(_mm256_set1_ps(sincos_constants::COS0), z);
+			c = _mm256_mul_ps(_mm256_add_ps(c, _mm256_set1_ps(sincos_constants::COS1)), z);
+			c = _mm256_mul_ps(_mm256_add_ps(c, _mm256_set1_ps(sincos_constants::COS2)), z);
+			c = _mm256_mul_ps(c, z);
+			c = _mm256_sub_ps(c, _mm256_mul_ps(z, _mm256_set1_ps(.5f)));
+			c = _mm256_add_ps(c, _mm256_set1_ps(1.f));
+			__m256 s = _mm256_mul_ps(_mm256_set1_ps(sincos_constants::SIN0), z);
+			s = _mm256_mul_ps(_mm256_add_ps(s, _mm256_set1_ps(sincos_constants::SIN1)), z);
+			s = _mm256_mul_ps(_mm256_add_ps(s, _mm256_set1_ps(sincos_constants::SIN2)), z);
+			s = _mm256_add_ps(_mm256_mul_ps(s, x), x);
+
+			sin = _mm256_xor_ps(_mm256_blendv_ps(c, s, use_sin), sin_sign);
+			cos = _mm256_xor_ps(_mm256_blendv_ps(s, c, use_sin), cos_sign);
+
+			const int out_of_range = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_andnot_ps(sign_mask, argument), _mm256_set1_ps(sincos_constants::MAX_ARGUMENT), _CMP_NLT_UQ));
+			if(out_of_range != 0){
+				alignas(32) float lanes[8], sins[8], coss[8];
+				_mm256_store_ps(lanes, argument);
+				_mm256_store_ps(sins, sin);
+				_mm256_store_ps(coss, cos);
+				for(int lane = 0; lane < 8; lane++){
+					if(out_of_range & (1 << lane)){
+						sincos(lanes[lane], sins[lane], coss[lane]);
+					}
+				}
+				sin = _mm256_load_ps(sins);
+				cos = _mm256_load_ps(coss);
+			}
+		}
+
+		__attribute__((target("avx2")))
+		void compute_avx2(const Inputs& in, size_t count, glm::mat4* model, glm::mat3* normal){
+			alignas(32) float normal_terms[ROTATION_TERMS][8];
+			const __m256 sign = _mm256_set1_ps(-0.f);
+			const __m256 one = _mm256_set1_ps(1.f);
+			size_t i = 0;
+			for(; i + 8 <= count; i += 8){
+				__m256 s1, c1, s2, c2, s3, c3;
+				sincos_avx2(_mm256_loadu_ps(in.r[1] + i), s1, c1);
+				sincos_avx2(_mm256_loadu_ps(in.r[0] + i), s2, c2);
+				sincos_avx2(_mm256_loadu_ps(in.r[2] + i), s3, c3);
+				const __m256 rotation[ROTATION_TERMS] = {
+					_mm256_add_ps(_mm256_mul_ps(c1, c3), _mm256_mul_ps(_mm256_mul_ps(s1, s2), s3)),
+					_mm256_mul_ps(c2, s3),
+					_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(c1, s2), s3), _mm256_mul_ps(c3, s1)),
+					_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(c3, s1), s2), _mm256_mul_ps(c1, s3)),
+					_mm256_mul_ps(c2, c3),
+					_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(c1, c3), s2), _mm256_mul_ps(s1, s3)),
+					_mm256_mul_ps(c2, s1),
+					_mm256_xor_ps(s2, sign),
+					_mm256_mul_ps(c1, c2)
+				};
+				__m256 columns[4][4];
+				for(int column = 0; column < 3; column++){
+					const __m256 scale = _mm256_loadu_ps(in.s[column] + i);
+					const __m256 inv_scale = _mm256_div_ps(one, scale);
+					for(int row = 0; row < 3; row++){
+						columns[column][row] = _mm256_mul_ps(scale, rotation[column * 3 + row]);
+						_mm256_store_ps(normal_terms[column * 3 + row], _mm256_mul_ps(inv_scale, rotation[column * 3 + row]));
+					}
+					columns[column][3] = _mm256_setzero_ps();
+				}
+				columns[3][0] = _mm256_loadu_ps(in.t[0] + i);
+				columns[3][1] = _mm256_loadu_ps(in.t[1] + i);
+				columns[3][2] = _mm256_loadu_ps(in.t[2] + i);
+				columns[3][3] = one;
+				// same transpose as the sse path, once per 128 bit half
+				for(int column = 0; column < 4; column++){
+					for(int half = 0; half < 2; half++){
+						__m128 rows[4];
+						for(int row = 0; row < 4; row++){
+							rows[row] = half == 0 ? _mm256_castps256_ps128(columns[column][row]) : _mm256_extractf128_ps(columns[column][row], 1);
+						}
+						_MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+						for(int lane = 0; lane < 4; lane++){
+							_mm_storeu_ps(&model[i + half * 4 + lane][column][0], rows[lane]);
+						}
+					}
+				}
+				for(int lane = 0; lane < 8; lane++){
+					float* out = &normal[i + lane][0][0];
+					for(int term = 0; term < ROTATION_TERMS; term++){
+						out[term] = normal_terms[term][lane];
+					}
+				}
+			}
+			compute_scalar(in, i, count, model, normal);
+		}
+#endif
+#endif
+	}
+
+	TransformBatch::Path TransformBatch::get_best_path(){
+#ifdef BLIKAENGINE_AVX2
+		static const Path best = __builtin_cpu_supports("avx2") ? Path::AVX2 : Path::SSE;
+		return best;
+#elif defined(BLIKAENGINE_X86)
+		return Path::SSE;
+#else
+		return Path::Scalar;
+#endif
+	}
+
+	const char* TransformBatch::get_path_name(Path path){
+		switch(path){
+			case Path::SSE: return "sse";
+			case Path::AVX2: return "avx2";
+			default: return "scalar";
+		}
+	}
+
+	void TransformBatch::push_back(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale){
+		translation_x.push_back(translation.x);
+		translation_y.push_back(translation.y);
+		translation_z.push_back(translation.z);
+		rotation_x.push_back(rotation.x);
+		rotation_y.push_back(rotation.y);
+		rotation_z.push_back(rotation.z);
+		scale_x.push_back(scale.x);
+		scale_y.push_back(scale.y);
+		scale_z.push_back(scale.z);
+	}
+
+	void TransformBatch::clear(){
+		translation_x.clear(); translation_y.clear(); translation_z.clear();
+		rotation_x.clear(); rotation_y.clear(); rotation_z.clear();
+		scale_x.clear(); scale_y.clear(); scale_z.clear();
+	}
+
+	void TransformBatch::reserve(size_t count){
+		translation_x.reserve(count); translation_y.reserve(count); translation_z.reserve(count);
+		rotation_x.reserve(count); rotation_y.reserve(count); rotation_z.reserve(count);
+		scale_x.reserve(count); scale_y.reserve(count); scale_z.reserve(count);
+	}
+
+	void TransformBatch::compute(glm::mat4* model_matrices, glm::mat3* normal_matrices, Path path) const{
+		Inputs in{
+			{translation_x.data(), translation_y.data(), translation_z.data()},
+			{rotation_x.data(), rotation_y.data(), rotation_z.data()},
+			{scale_x.data(), scale_y.data(), scale_z.data()}
+		};
+		switch(path){
+#ifdef BLIKAENGINE_AVX2
+			case Path::AVX2:
+				compute_avx2(in, size(), model_matrices, normal_matrices);
+				return;
+#endif
+#ifdef BLIKAENGINE_X86
+			case Path::SSE:
+				compute_sse(in, size(), model_matrices, normal_matrices);
+				return;
+#endif
+			default:
+				assert(path == Path::Scalar && "transform batch path not available on this platform");
+				compute_scalar(in, 0, size(), model_matrices, normal_matrices);
+				return;
+		}
+	}
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <vector>
+
+namespace blikaengine{
+
+	namespace sincos_constants{
+		// beyond it the three part reduction below loses the result, and the octant overflows int32 from
+		// about 1.7e9 on
+		constexpr float MAX_ARGUMENT = 8192.f;
+		constexpr float FOUR_OVER_PI = 1.27323954473516f;
+		// pi / 4 split in three parts for an extra precise range reduction
+		constexpr float DP1 = .78515625f;
+		constexpr float DP2 = 2.4187564849853515625e-4f;
+		constexpr float DP3 = 3.77489497744594108e-8f;
+		constexpr float COS0 = 2.443315711809948e-5f;
+		constexpr float COS1 = -1.388731625493765e-3f;
+		constexpr float COS2 = 4.166664568298827e-2f;
+		constexpr float SIN0 = -1.9515295891e-4f;
+		constexpr float SIN1 = 8.3321608736e-3f;
+		constexpr float SIN2 = -1.6666654611e-1f;
+	}
+
+	// Cephes style sin and cos in one go, within a couple of ulp of std::sin / std::cos for |x| below
+	// MAX_ARGUMENT. Larger, infinite and nan arguments are handed to std::sin / std::cos, which reduce
+	// them exactly. Written so the sse / avx2 versions in transform_batch.cpp can repeat it lane for
+	// lane with identical rounding, which is what keeps TransformComponent and TransformBatch bit for
+	// bit equal.
+	inline void sincos(float x, float& sin, float& cos){
+		using namespace sincos_constants;
+		if(!(std::abs(x) < MAX_ARGUMENT)){
+			sin = std::sin(x);
+			cos = std::cos(x);
+			return;
+		}
+		uint32_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+		uint32_t sin_sign = bits & 0x80000000u;
+		bits &= 0x7fffffffu;
+		std::memcpy(&x, &bits, sizeof(bits));
+		int32_t octant = static_cast<int32_t>(x * FOUR_OVER_PI);
+		octant = (octant + 1) & ~1;
+		const float y = static_cast<float>(octant);
+		sin_sign ^= static_cast<uint32_t>(octant & 4) << 29;
+		const uint32_t cos_sign = static_cast<uint32_t>(~(octant - 2) & 4) << 29;
+		const bool use_sin = (octant & 2) == 0;
+
+		x = x - y * DP1;
+		x = x - y * DP2;
+		x = x - y * DP3;
+		const float z = x * x;
+
+		float c = COS0 * z;
+		c = (c + COS1) * z;
+		c = (c + COS2) * z;
+		c = c * z;
+		c = c - z * .5f;
+		c = c + 1.f;
+		float s = SIN0 * z;
+		s = (s + SIN1) * z;
+		s = (s + SIN2) * z;
+		s = s * x + x;
+
+		uint32_t sin_bits, cos_bits;
+		std::memcpy(&sin_bits, use_sin ? &s : &c, sizeof(sin_bits));
+		std::memcpy(&cos_bits, use_sin ? &c : &s, sizeof(cos_bits));
+		sin_bits ^= sin_sign;
+		cos_bits ^= cos_sign;
+		std::memcpy(&sin, &sin_bits, sizeof(sin));
+		std::memcpy(&cos, &cos_bits, sizeof(cos));
+	}
+
+	// Local transforms stored as structure of arrays, so model and normal matrices can be built 4 (SSE)
+	// or 8 (AVX2) at a time. The vector path is picked at runtime; every path gives exactly the matrices
+	// of TransformComponent::mat4() / normal_matrix(), which are built by local_matrices() below.
+	class TransformBatch{
+		public:
+			enum class Path{
+				Scalar,
+				SSE,
+				AVX2
+			};
+
+			// YXZ euler rotation, scale, then translation. The normal matrix is the inverse transpose of the upper 3x3.
+			static void local_matrices(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale, glm::mat4& model, glm::mat3& normal){
+				float s1, c1, s2, c2, s3, c3;
+				sincos(rotation.y, s1, c1);
+				sincos(rotation.x, s2, c2);
+				sincos(rotation.z, s3, c3);
+				const float terms[9] = {
+					c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1,
+					c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3,
+					c2 * s1, -s2, c1 * c2
+				};
+				for(int column = 0; column < 3; column++){
+					const float inv_scale = 1.f / scale[column];
+					for(int row = 0; row < 3; row++){
+						model[column][row] = scale[column] * terms[column * 3 + row];
+						normal[column][row] = inv_scale * terms[column * 3 + row];
+					}
+					model[column][3] = 0.f;
+				}
+				model[3] = glm::vec4{translation, 1.f};
+			}
+
+			// widest path the cpu supports
+			static Path get_best_path();
+			static const char* get_path_name(Path path);
+
+			void push_back(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale);
+			void clear();
+			void reserve(size_t count);
+			size_t size() const{ return translation_x.size(); }
+
+			// writes size() matrices to each output
+			void compute(glm::mat4* model_matrices, glm::mat3* normal_matrices) const{
+				compute(model_matrices, normal_matrices, get_best_path());
+			}
+			// path has to be supported by the cpu, for benchmarks and comparisons
+			void compute(glm::mat4* model_matrices, glm::mat3* normal_matrices, Path path) const;
+
+		private:
+			std::vector<float> translation_x{}, translation_y{}, translation_z{};
+			std::vector<float> rotation_x{}, rotation_y{}, rotation_z{};
+			std::vector<float> scale_x{}, scale_y{}, scale_z{};
+	};
+}
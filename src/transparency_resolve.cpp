@@ -0,0 +1,67 @@
+#include "transparency_resolve.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace blikaengine{
+
+	TransparencyResolve::TransparencyResolve(Device& device, SwapChain& swap_chain): device{device}{
+		create_descriptor_sets(swap_chain);
+		create_pipeline(swap_chain.getRenderPass());
+	}
+
+	TransparencyResolve::~TransparencyResolve(){
+		vkDestroyPipelineLayout(device.device(), pipeline_layout, nullptr);
+	}
+
+	void TransparencyResolve::create_descriptor_sets(SwapChain& swap_chain){
+		uint32_t set_count = static_cast<uint32_t>(swap_chain.imageCount());
+		set_layout = DescriptorSetLayout::Builder(device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build();
+		descriptor_pool = DescriptorPool::Builder(device)
+			.setMaxSets(set_count)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 2 * set_count)
+			.build();
+		input_sets.resize(set_count);
+		for(uint32_t i = 0; i < set_count; i++){
+			VkDescriptorImageInfo accum_info{VK_NULL_HANDLE, swap_chain.getAccumImageView(static_cast<int>(i)), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+			VkDescriptorImageInfo revealage_info{VK_NULL_HANDLE, swap_chain.getRevealageImageView(static_cast<int>(i)), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+			if(!DescriptorWriter(*set_layout, *descriptor_pool).writeImage(0, &accum_info).writeImage(1, &revealage_info).build(input_sets[i])){
+				throw std::runtime_error("failed to allocate transparency resolve descriptor set");
+			}
+		}
+	}
+
+	void TransparencyResolve::create_pipeline(VkRenderPass render_pass){
+		VkDescriptorSetLayout layout = set_layout->getDescriptorSetLayout();
+		VkPipelineLayoutCreateInfo pipeline_layout_info{};
+		pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_info.setLayoutCount = 1;
+		pipeline_layout_info.pSetLayouts = &layout;
+		if(vkCreatePipelineLayout(device.device(), &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS){
+			throw std::runtime_error("failed to create pipeline layout");
+		}
+
+		PipelineConfigInfo pipeline_config{};
+		Pipeline::default_pipeline_config_info(pipeline_config);
+		Pipeline::enable_alpha_blending(pipeline_config);
+		// one full screen triangle, the subpass has no depth attachment
+		pipeline_config.attribute_descriptions.clear();
+		pipeline_config.binding_descriptions.clear();
+		pipeline_config.depth_stencil_info.depthTestEnable = VK_FALSE;
+		pipeline_config.depth_stencil_info.depthWriteEnable = VK_FALSE;
+		pipeline_config.render_pass = render_pass;
+		pipeline_config.subpass = SwapChain::RESOLVE_SUBPASS;
+		pipeline_config.pipeline_layout = pipeline_layout;
+		resolve_pipeline = std::make_unique<Pipeline>(device, "shaders/transparency_resolve.vert.spv", "shaders/transparency_resolve.frag.spv", pipeline_config);
+	}
+
+	void TransparencyResolve::resolve(VkCommandBuffer command_buffer, uint32_t image_index){
+		assert(image_index < input_sets.size() && "no transparency targets with this index");
+		resolve_pipeline->bind(command_buffer);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &input_sets[image_index], 0, nullptr);
+		vkCmdDraw(command_buffer, 3, 1, 0, 0);
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "descriptors.hpp"
+#include "device.hpp"
+#include "pipeline.hpp"
+#include "swap_chain.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace blikaengine{
+
+	// Resolve subpass of weighted blended order independent transparency (McGuire and Bavoil): averages the
+	// accumulated transparent color and blends it over the opaque image by the revealage. Created along with
+	// the swap chain whose transparency targets it reads.
+	class TransparencyResolve{
+		public:
+			TransparencyResolve(Device& device, SwapChain& swap_chain);
+			~TransparencyResolve();
+			TransparencyResolve(const TransparencyResolve&) = delete;
+			TransparencyResolve& operator = (const TransparencyResolve&) = delete;
+
+			// recorded in SwapChain::RESOLVE_SUBPASS of swap chain image image_index
+			void resolve(VkCommandBuffer command_buffer, uint32_t image_index);
+
+		private:
+			void create_descriptor_sets(SwapChain& swap_chain);
+			void create_pipeline(VkRenderPass render_pass);
+
+			Device& device;
+			std::unique_ptr<DescriptorSetLayout> set_layout{};
+			std::unique_ptr<DescriptorPool> descriptor_pool{};
+			// accumulation and revealage of each swap chain image
+			std::vector<VkDescriptorSet> input_sets{};
+			VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+			std::unique_ptr<Pipeline> resolve_pipeline{};
+	};
+}
@@ -0,0 +1,267 @@
+#include "upload_manager.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace blikaengine{
+
+	UploadManager::UploadManager(Device& device, VkDeviceSize staging_size): device{device}, staging_size{staging_size}{
+		QueueFamilyIndices indices = device.queueFamilies();
+		create_command_pool(indices.transferFamily, transfer_pool);
+		create_command_pool(indices.graphicsFamily, graphics_pool);
+		create_timeline();
+		staging_ring = std::make_unique<Buffer>(device, staging_size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if(staging_ring->map() != VK_SUCCESS){
+			throw std::runtime_error("failed to map staging ring!");
+		}
+	}
+
+	UploadManager::~UploadManager(){
+		flush();
+		if(timeline_value > 0){
+			wait(timeline_value);
+		}
+		in_flight.clear();
+		staging_ring.reset();
+		vkDestroySemaphore(device.device(), timeline, nullptr);
+		vkDestroyCommandPool(device.device(), transfer_pool, nullptr);
+		vkDestroyCommandPool(device.device(), graphics_pool, nullptr);
+	}
+
+	void UploadManager::create_command_pool(uint32_t queue_family, VkCommandPool& pool){
+		VkCommandPoolCreateInfo pool_info{};
+		pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		pool_info.queueFamilyIndex = queue_family;
+		pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		if(vkCreateCommandPool(device.device(), &pool_info, nullptr, &pool) != VK_SUCCESS){
+			throw std::runtime_error("failed to create upload command pool!");
+		}
+	}
+
+	void UploadManager::create_timeline(){
+		VkSemaphoreTypeCreateInfo type_info{};
+		type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		type_info.initialValue = 0;
+		VkSemaphoreCreateInfo semaphore_info{};
+		semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphore_info.pNext = &type_info;
+		if(vkCreateSemaphore(device.device(), &semaphore_info, nullptr, &timeline) != VK_SUCCESS){
+			throw std::runtime_error("failed to create upload timeline semaphore!");
+		}
+	}
+
+	VkCommandBuffer UploadManager::begin(VkCommandPool pool, std::vector<VkCommandBuffer>& free_list){
+		VkCommandBuffer command_buffer;
+		if(free_list.empty()){
+			VkCommandBufferAllocateInfo alloc_info{};
+			alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			alloc_info.commandPool = pool;
+			alloc_info.commandBufferCount = 1;
+			if(vkAllocateCommandBuffers(device.device(), &alloc_info, &command_buffer) != VK_SUCCESS){
+				throw std::runtime_error("failed to allocate upload command buffer!");
+			}
+		}else{
+			command_buffer = free_list.back();
+			free_list.pop_back();
+		}
+		VkCommandBufferBeginInfo begin_info{};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if(vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS){
+			throw std::runtime_error("failed to begin recording upload command buffer!");
+		}
+		return command_buffer;
+	}
+
+	VkCommandBuffer UploadManager::transfer_commands(){
+		if(current.transfer_commands == VK_NULL_HANDLE){
+			current.transfer_commands = begin(transfer_pool, free_transfer_commands);
+		}
+		return current.transfer_commands;
+	}
+
+	VkCommandBuffer UploadManager::graphics_commands(){
+		if(current.graphics_commands == VK_NULL_HANDLE){
+			current.graphics_commands = begin(graphics_pool, free_graphics_commands);
+		}
+		return current.graphics_commands;
+	}
+
+	VkDeviceSize UploadManager::reserve(VkDeviceSize size, VkDeviceSize alignment){
+		assert(size <= staging_size && "staging allocation larger than the ring");
+		for(;;){
+			if(ring_head == ring_tail){
+				// nothing in flight, start over at the beginning of the ring
+				ring_head = ring_tail = (ring_head + staging_size - 1) / staging_size * staging_size;
+			}
+			VkDeviceSize offset = ring_head % staging_size;
+			VkDeviceSize aligned = (offset + alignment - 1) / alignment * alignment;
+			// does not fit before the end, the rest of the ring is skipped
+			uint64_t start = aligned + size > staging_size ? ring_head - offset + staging_size : ring_head - offset + aligned;
+			if(start + size <= ring_tail + staging_size){
+				ring_head = start + size;
+				return start % staging_size;
+			}
+			// the placement is redone once space is released, the ring may have emptied and start over
+			if(in_flight.empty()){
+				flush();
+			}
+			if(in_flight.empty()){
+				// nothing recorded or in flight reads the ring
+				ring_tail = ring_head;
+			}else{
+				wait(in_flight.front().ticket);
+				collect();
+			}
+		}
+	}
+
+	void UploadManager::upload_buffer(const void* data, VkDeviceSize size, VkBuffer dst, VkDeviceSize dst_offset){
+		// anything bigger than the ring is streamed in halves so one chunk can be filled while the other is copied
+		VkDeviceSize max_chunk = size <= staging_size ? size : staging_size / 2;
+		VkDeviceSize done = 0;
+		while(done < size){
+			VkDeviceSize chunk = std::min(max_chunk, size - done);
+			VkDeviceSize offset = reserve(chunk, 4);
+			std::memcpy(static_cast<char*>(staging_ring->getMappedMemory()) + offset, static_cast<const char*>(data) + done, chunk);
+
+			VkBufferCopy copy_region{};
+			copy_region.srcOffset = offset;
+			copy_region.dstOffset = dst_offset + done;
+			copy_region.size = chunk;
+			vkCmdCopyBuffer(transfer_commands(), staging_ring->getBuffer(), dst, 1, &copy_region);
+			current.ring_head = ring_head;
+			done += chunk;
+		}
+	}
+
+	void UploadManager::upload_image(const void* data, uint32_t texel_size, VkImage image, uint32_t width, uint32_t height){
+		VkDeviceSize row_size = static_cast<VkDeviceSize>(texel_size) * width;
+		VkDeviceSize size = row_size * height;
+		if(row_size > staging_size / 2 && size > staging_size){
+			throw std::runtime_error("staging ring too small for a single image row!");
+		}
+		// buffer offsets of image copies must be multiples of the texel size and of 4 (all powers of two here)
+		VkDeviceSize alignment = std::max<VkDeviceSize>({device.properties.limits.optimalBufferCopyOffsetAlignment, texel_size, 4});
+		uint32_t max_rows = size <= staging_size ? height : static_cast<uint32_t>((staging_size / 2) / row_size);
+		uint32_t row = 0;
+		while(row < height){
+			uint32_t rows = std::min(max_rows, height - row);
+			VkDeviceSize chunk = row_size * rows;
+			VkDeviceSize offset = reserve(chunk, alignment);
+			std::memcpy(static_cast<char*>(staging_ring->getMappedMemory()) + offset, static_cast<const char*>(data) + row_size * row, chunk);
+
+			VkBufferImageCopy region{};
+			region.bufferOffset = offset;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = 0;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = {0, static_cast<int32_t>(row), 0};
+			region.imageExtent = {width, rows, 1};
+			vkCmdCopyBufferToImage(transfer_commands(), staging_ring->getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+			current.ring_head = ring_head;
+			row += rows;
+		}
+	}
+
+	UploadManager::Ticket UploadManager::flush(){
+		if(current.transfer_commands == VK_NULL_HANDLE && current.graphics_commands == VK_NULL_HANDLE && !current.forced){
+			return timeline_value;
+		}
+		uint64_t transfer_done = ++timeline_value;
+		uint64_t graphics_done = ++timeline_value;
+		bool has_transfer = current.transfer_commands != VK_NULL_HANDLE;
+
+		if(has_transfer){
+			vkEndCommandBuffer(current.transfer_commands);
+			VkTimelineSemaphoreSubmitInfo timeline_info{};
+			timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			timeline_info.signalSemaphoreValueCount = 1;
+			timeline_info.pSignalSemaphoreValues = &transfer_done;
+			VkSubmitInfo submit_info{};
+			submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submit_info.pNext = &timeline_info;
+			submit_info.commandBufferCount = 1;
+			submit_info.pCommandBuffers = &current.transfer_commands;
+			submit_info.signalSemaphoreCount = 1;
+			submit_info.pSignalSemaphores = &timeline;
+			if(vkQueueSubmit(device.transferQueue(), 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS){
+				throw std::runtime_error("failed to submit upload transfer batch!");
+			}
+		}
+
+		// submitted even without graphics work: the wait is what orders the following frames after the copies
+		if(current.graphics_commands != VK_NULL_HANDLE){
+			vkEndCommandBuffer(current.graphics_commands);
+		}
+		VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkTimelineSemaphoreSubmitInfo timeline_info{};
+		timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_info.waitSemaphoreValueCount = has_transfer ? 1 : 0;
+		timeline_info.pWaitSemaphoreValues = &transfer_done;
+		timeline_info.signalSemaphoreValueCount = 1;
+		timeline_info.pSignalSemaphoreValues = &graphics_done;
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.pNext = &timeline_info;
+		submit_info.waitSemaphoreCount = has_transfer ? 1 : 0;
+		submit_info.pWaitSemaphores = &timeline;
+		submit_info.pWaitDstStageMask = &wait_stage;
+		submit_info.commandBufferCount = current.graphics_commands != VK_NULL_HANDLE ? 1 : 0;
+		submit_info.pCommandBuffers = &current.graphics_commands;
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = &timeline;
+		if(vkQueueSubmit(device.graphicsQueue(), 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS){
+			throw std::runtime_error("failed to submit upload graphics batch!");
+		}
+
+		current.ticket = graphics_done;
+		in_flight.push_back(std::move(current));
+		current = Batch{};
+		return graphics_done;
+	}
+
+	bool UploadManager::is_complete(Ticket ticket){
+		uint64_t value = 0;
+		vkGetSemaphoreCounterValue(device.device(), timeline, &value);
+		return value >= ticket;
+	}
+
+	void UploadManager::wait(Ticket ticket){
+		VkSemaphoreWaitInfo wait_info{};
+		wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		wait_info.semaphoreCount = 1;
+		wait_info.pSemaphores = &timeline;
+		wait_info.pValues = &ticket;
+		vkWaitSemaphores(device.device(), &wait_info, UINT64_MAX);
+	}
+
+	void UploadManager::collect(){
+		if(in_flight.empty()){
+			return;
+		}
+		uint64_t value = 0;
+		vkGetSemaphoreCounterValue(device.device(), timeline, &value);
+		while(!in_flight.empty() && in_flight.front().ticket <= value){
+			Batch& batch = in_flight.front();
+			ring_tail = std::max(ring_tail, batch.ring_head);
+			if(batch.transfer_commands != VK_NULL_HANDLE){
+				vkResetCommandBuffer(batch.transfer_commands, 0);
+				free_transfer_commands.push_back(batch.transfer_commands);
+			}
+			if(batch.graphics_commands != VK_NULL_HANDLE){
+				vkResetCommandBuffer(batch.graphics_commands, 0);
+				free_graphics_commands.push_back(batch.graphics_commands);
+			}
+			in_flight.pop_front();
+		}
+	}
+}
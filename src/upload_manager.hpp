@@ -0,0 +1,93 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "device.hpp"
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace blikaengine{
+
+	// Collects asset uploads into one batch per frame instead of a queue submit + vkQueueWaitIdle per
+	// copy. Copies go to the dedicated transfer queue when the device has one; work that needs the
+	// graphics queue (mipmap blits, transitions into shader read layouts) goes into the batch's
+	// graphics command buffer, which waits on the copies through a timeline semaphore. Every later
+	// submission to the graphics queue is ordered after that wait, so an asset can be drawn in the
+	// frame its batch is flushed in without the cpu ever blocking.
+	//
+	// Source data is staged in one persistently mapped ring buffer. Space is handed back when the
+	// batch that used it completes; uploads larger than the ring are streamed through it in chunks.
+	// Not thread safe, record and flush from the main thread.
+	class UploadManager{
+		public:
+			using Ticket = uint64_t;
+
+			UploadManager(Device& device, VkDeviceSize staging_size = Device::DEFAULT_STAGING_SIZE);
+			~UploadManager();
+			UploadManager(const UploadManager&) = delete;
+			UploadManager& operator = (const UploadManager&) = delete;
+
+			// data only has to stay valid for the duration of the call
+			void upload_buffer(const void* data, VkDeviceSize size, VkBuffer dst, VkDeviceSize dst_offset = 0);
+			// tightly packed rows into mip 0, layer 0. The image has to be in TRANSFER_DST_OPTIMAL, see transfer_commands()
+			void upload_image(const void* data, uint32_t texel_size, VkImage image, uint32_t width, uint32_t height);
+
+			// command buffers of the batch being recorded, for barriers and anything beyond plain copies
+			VkCommandBuffer transfer_commands();
+			VkCommandBuffer graphics_commands();
+
+			// submits the batch being recorded, returns the ticket that completes with it.
+			// Cheap if nothing was recorded.
+			Ticket flush();
+			// ticket of the batch being recorded, for callers that want to know when their upload lands.
+			// The batch is submitted on the next flush even if it stays empty, so the ticket also tells
+			// when all graphics work submitted before that flush has finished.
+			Ticket pending_ticket(){
+				current.forced = true;
+				return timeline_value + 2;
+			}
+			bool is_complete(Ticket ticket);
+			void wait(Ticket ticket);
+			// recycles staging space and command buffers of completed batches
+			void collect();
+
+			VkDeviceSize get_staging_size() const{ return staging_size; }
+			VkDeviceSize get_staging_in_use() const{ return ring_head - ring_tail; }
+
+		private:
+			struct Batch{
+				VkCommandBuffer transfer_commands = VK_NULL_HANDLE;
+				VkCommandBuffer graphics_commands = VK_NULL_HANDLE;
+				// ring position after the batch's last staging allocation
+				uint64_t ring_head = 0;
+				Ticket ticket = 0;
+				bool forced = false;
+			};
+
+			VkCommandBuffer begin(VkCommandPool pool, std::vector<VkCommandBuffer>& free_list);
+			void create_command_pool(uint32_t queue_family, VkCommandPool& pool);
+			void create_timeline();
+			// offset of size free bytes in the ring, retires older batches if it is full
+			VkDeviceSize reserve(VkDeviceSize size, VkDeviceSize alignment);
+
+			Device& device;
+			VkCommandPool transfer_pool;
+			VkCommandPool graphics_pool;
+			std::vector<VkCommandBuffer> free_transfer_commands{};
+			std::vector<VkCommandBuffer> free_graphics_commands{};
+
+			// transfer half of batch n signals 2n - 1, graphics half signals 2n which is its ticket
+			VkSemaphore timeline;
+			uint64_t timeline_value = 0;
+
+			// head and tail count bytes ever allocated / released, position in the ring is modulo staging_size
+			VkDeviceSize staging_size;
+			std::unique_ptr<Buffer> staging_ring;
+			uint64_t ring_head = 0;
+			uint64_t ring_tail = 0;
+
+			Batch current{};
+			std::deque<Batch> in_flight{};
+	};
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace blikaengine{
+
+	// How model vertices are stored in the mesh pool. Every mesh shares the pool's one vertex buffer and
+	// is drawn by the same pipelines, so the format is picked once for the whole engine, see
+	// EngineConfig::vertex_format and Model::get_vertex_layout().
+	enum class VertexFormat : uint32_t{
+		// Model::Vertex as imported, 44 bytes of floats
+		Full = 0,
+		// Model::PackedVertex, 20 bytes: 16 bit positions within the model's bounds, octahedral normals,
+		// half float uvs and 8 bit colors
+		Packed = 1,
+		// Packed without its colors, 16 bytes, everything is white
+		PackedUncolored = 2,
+	};
+
+	// full, packed or packed-uncolored, as the engine's --vertex-format and mesh_cook take them
+	inline VertexFormat parse_vertex_format(const std::string& name){
+		if(name == "full"){
+			return VertexFormat::Full;
+		}else if(name == "packed"){
+			return VertexFormat::Packed;
+		}else if(name == "packed-uncolored"){
+			return VertexFormat::PackedUncolored;
+		}
+		throw std::runtime_error("unknown vertex format: " + name);
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace blikaengine{
+
+	// 64 bit hash of raw bytes, xxHash64 style rounds over 8 byte words
+	inline uint64_t hash_bytes(const void* data, size_t size){
+		constexpr uint64_t PRIME1 = 0x9e3779b185ebca87ull;
+		constexpr uint64_t PRIME2 = 0xc2b2ae3d27d4eb4full;
+		constexpr uint64_t PRIME3 = 0x165667b19e3779f9ull;
+		auto rotate = [](uint64_t x, int bits){ return (x << bits) | (x >> (64 - bits)); };
+		const auto* bytes = static_cast<const unsigned char*>(data);
+		uint64_t hash = PRIME3 + size;
+		for(; size >= 8; bytes += 8, size -= 8){
+			uint64_t word;
+			std::memcpy(&word, bytes, 8);
+			hash ^= rotate(word * PRIME2, 31) * PRIME1;
+			hash = rotate(hash, 27) * PRIME1 + PRIME2;
+		}
+		if(size >= 4){
+			uint32_t word;
+			std::memcpy(&word, bytes, 4);
+			hash ^= word * PRIME1;
+			hash = rotate(hash, 23) * PRIME2 + PRIME3;
+			bytes += 4;
+			size -= 4;
+		}
+		for(; size > 0; bytes++, size--){
+			hash ^= *bytes * PRIME3;
+			hash = rotate(hash, 11) * PRIME1;
+		}
+		hash ^= hash >> 33;
+		hash *= PRIME2;
+		hash ^= hash >> 29;
+		hash *= PRIME3;
+		return hash ^ (hash >> 32);
+	}
+
+	// Deduplicates vertices while a mesh is imported: weld() returns the index of a bit identical vertex
+	// already in vertices, or appends the vertex and returns its new index. The lookup is a flat open
+	// addressing table of (hash, index) pairs probed linearly, sized up front from the number of
+	// indices so that typical meshes never rehash. Vertices are compared as raw bytes, so they must not
+	// have padding; +0 and -0 count as different values.
+	template<typename Vertex>
+	class VertexWelder{
+		static_assert(std::is_trivially_copyable<Vertex>::value && sizeof(Vertex) % sizeof(float) == 0, "vertices are hashed and compared as raw bytes");
+
+		public:
+			// vertices receives the unique vertices and has to outlive the welder, index_count is how
+			// many weld() calls to expect
+			VertexWelder(std::vector<Vertex>& vertices, size_t index_count): vertices{vertices}{
+				// closed meshes share each vertex between about six triangle corners, leave room for a
+				// quarter of the indices at half load
+				size_t capacity = MIN_CAPACITY;
+				while(capacity < index_count / 2){
+					capacity *= 2;
+				}
+				slots.assign(capacity, Slot{});
+				vertices.reserve(vertices.size() + index_count / 4);
+			}
+
+			uint32_t weld(const Vertex& vertex){
+				const uint32_t hash = static_cast<uint32_t>(hash_bytes(&vertex, sizeof(Vertex)));
+				const size_t mask = slots.size() - 1;
+				for(size_t slot = hash & mask;; slot = (slot + 1) & mask){
+					Slot& entry = slots[slot];
+					if(entry.index == EMPTY){
+						entry = {hash, static_cast<uint32_t>(vertices.size())};
+						vertices.push_back(vertex);
+						if(++count * 2 > slots.size()){
+							grow();
+						}
+						return static_cast<uint32_t>(vertices.size() - 1);
+					}
+					if(entry.hash == hash && std::memcmp(&vertices[entry.index], &vertex, sizeof(Vertex)) == 0){
+						return entry.index;
+					}
+				}
+			}
+
+		private:
+			static constexpr uint32_t EMPTY = UINT32_MAX;
+			static constexpr size_t MIN_CAPACITY = 64;
+
+			struct Slot{
+				uint32_t hash = 0;
+				uint32_t index = EMPTY;
+			};
+
+			// doubles the table, the stored hashes spare hashing the vertices again
+			void grow(){
+				std::vector<Slot> old_slots(slots.size() * 2, Slot{});
+				old_slots.swap(slots);
+				const size_t mask = slots.size() - 1;
+				for(const Slot& entry : old_slots){
+					if(entry.index == EMPTY){
+						continue;
+					}
+					size_t slot = entry.hash & mask;
+					while(slots[slot].index != EMPTY){
+						slot = (slot + 1) & mask;
+					}
+					slots[slot] = entry;
+				}
+			}
+
+			std::vector<Vertex>& vertices;
+			std::vector<Slot> slots{};
+			size_t count = 0;
+	};
+}
@@ -5,16 +5,24 @@
 
 namespace blikaengine{
 
-	Window::Window(int w, int h, std::string n): width{w}, height{h}, window_name{n}{
-		init_window();
+	Window::Window(int w, int h, std::string n, bool headless): width{w}, height{h}, headless{headless}, window_name{n}{
+		if(!headless){
+			init_window();
+		}
 	}
 
 	Window::~Window(){
+		if(headless){
+			return;
+		}
 		glfwDestroyWindow(window);
 		glfwTerminate();
 	}
 	
 	void Window::create_window_surface(VkInstance instance, VkSurfaceKHR *surface){
+		if(headless){
+			throw std::runtime_error("cannot create a surface for a headless window");
+		}
 		if(glfwCreateWindowSurface(instance, window, nullptr, surface) != VK_SUCCESS){
 			throw std::runtime_error("failed to create window surface");
 		}
@@ -8,14 +8,19 @@ namespace blikaengine{
 
 	class Window{
 		public:
-			Window(int w, int h, std::string n);
+			Window(int w, int h, std::string n, bool headless = false);
 			~Window();
 
 			Window(const Window&) = delete;
 			Window& operator = (const Window&) = delete;
 
 			bool should_close(){
-				return glfwWindowShouldClose(window);
+				return !headless && glfwWindowShouldClose(window);
+			}
+
+			// headless windows never create a GLFW window or surface, the swap chain renders offscreen instead
+			bool is_headless() const{
+				return headless;
 			}
 
 			void create_window_surface(VkInstance instance, VkSurfaceKHR *surface);
@@ -41,8 +46,9 @@ namespace blikaengine{
 			int width;
 			int height;
 			bool framebuffer_resized = false;
+			bool headless = false;
 			std::string window_name;
-			GLFWwindow* window;
+			GLFWwindow* window = nullptr;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+// Offline half of the cooked mesh path: imports an obj exactly like the engine would (welding, bounds,
+// levels of detail, triangle and vertex order, meshlets) and writes the result as a CookedMesh the engine maps at startup.
+//
+// usage: mesh_cook [--vertex-format full|packed|packed-uncolored] <model.obj> [model.bmesh]
+// the output defaults to the input with its extension replaced. The vertices are stored packed for the
+// vertex format, the engine has to run with the same --vertex-format to use them as they are
+
+#include "cooked_mesh.hpp"
+#include "model_import.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]){
+	int first = 1;
+	const char* format_name = "full";
+	if(argc > 2 && std::strcmp(argv[1], "--vertex-format") == 0){
+		format_name = argv[2];
+		first = 3;
+	}
+	if(argc - first < 1 || argc - first > 2){
+		std::cerr << "usage: mesh_cook [--vertex-format full|packed|packed-uncolored] <model.obj> [model" << blikaengine::CookedMesh::EXTENSION << "]\n";
+		return EXIT_FAILURE;
+	}
+	const std::string input = argv[first];
+	std::string output = argc - first == 2 ? argv[first + 1] : std::filesystem::path{input}.replace_extension(blikaengine::CookedMesh::EXTENSION).string();
+	try{
+		const blikaengine::VertexFormat format = blikaengine::parse_vertex_format(format_name);
+		auto start = std::chrono::steady_clock::now();
+		blikaengine::ModelImport::Data data{};
+		data.load_model(input);
+		data.pack_vertices(format);
+		blikaengine::CookedMesh::write(output, data);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << input << " -> " << output << ": " << data.vertices.size() << " vertices, " << data.indices.size() << " indices, "
+			<< data.lods.size() << " levels, " << data.meshlets.size() << " meshlets" << (data.single_sided ? ", single sided" : "") << ", " << format_name << " vertices in " << ms << " ms\n"
+			<< "  vertex cache acmr " << data.source_cache.acmr << " -> " << data.imported_cache.acmr << ", atvr " << data.source_cache.atvr << " -> " << data.imported_cache.atvr << '\n';
+	}catch(const std::exception& e){
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}